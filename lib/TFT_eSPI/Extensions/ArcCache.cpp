@@ -0,0 +1,284 @@
+/**************************************************************************************
+// The following class caches the pixel coverage of a smooth arc so angle spans of the
+// arc can be drawn quickly, for example to animate a gauge.
+***************************************************************************************/
+
+/***************************************************************************************
+** Function name:           TFT_eArcCache
+** Description:             Class constructor
+***************************************************************************************/
+TFT_eArcCache::TFT_eArcCache(void)
+{
+  _pix    = nullptr;
+  _count  = 0;
+  _r      = 0;
+  _w      = 0;
+
+  _gValid = false;
+}
+
+
+/***************************************************************************************
+** Function name:           ~TFT_eArcCache
+** Description:             Class destructor
+***************************************************************************************/
+TFT_eArcCache::~TFT_eArcCache(void)
+{
+  deleteCache();
+}
+
+
+/***************************************************************************************
+** Function name:           createCache
+** Description:             Build the quadrant coverage table for radii r and ir
+***************************************************************************************/
+// The scan and alpha calculations are the same as drawArc() so the pixels match
+bool TFT_eArcCache::createCache(int32_t r, int32_t ir)
+{
+  deleteCache();
+
+  if (r < ir) transpose(r, ir);  // Required that r > ir
+  if (r <= 0 || ir < 0 || r >= 255) return false;
+
+  int32_t r2 = r * r;   // Outer arc radius^2
+  r++;                  // Outer AA zone radius
+  int32_t r1 = r * r;   // Outer AA radius^2
+  int32_t w  = r - ir;  // Width of arc (r - ir + 1)
+  int32_t r3 = ir * ir; // Inner arc radius^2
+  ir--;                 // Inner AA zone radius
+  int32_t r4 = ir * ir; // Inner AA radius^2
+
+  // First pass counts the pixels, second pass fills in the table
+  for (uint8_t pass = 0; pass < 2; pass++) {
+    uint32_t n  = 0;
+    int32_t  xs = 0;
+
+    for (int32_t cy = r - 1; cy > 0; cy--)
+    {
+      int32_t dy2 = (r - cy) * (r - cy);
+
+      // Find and track arc zone start point
+      while ((r - xs) * (r - xs) + dy2 >= r1) xs++;
+
+      for (int32_t cx = xs; cx < r; cx++)
+      {
+        int32_t hyp   = (r - cx) * (r - cx) + dy2;
+        uint8_t alpha = 255;
+        bool    fill  = false;
+
+        if (hyp > r2) alpha = ~TFT_eSPI::sqrt_fraction(hyp); // Outer AA zone
+        else if (hyp >= r3) fill = true;                     // Arc fill zone
+        else {
+          if (hyp <= r4) break;                              // Skip inner pixels
+          alpha = TFT_eSPI::sqrt_fraction(hyp);              // Inner AA zone
+        }
+
+        if (alpha < 16) continue;  // Skip low alpha pixels
+
+        if (pass) {
+          _pix[n].slope = ((r - cy) << 16)/(r - cx);
+          _pix[n].dx    = r - cx;
+          _pix[n].dy    = r - cy;
+          _pix[n].alpha = alpha;
+          _pix[n].fill  = fill;
+        }
+        n++;
+      }
+    }
+
+    if (pass == 0) {
+      _pix = (arc_pixel_t*)malloc(n * sizeof(arc_pixel_t));
+      if (!_pix) return false;
+    }
+    _count = n;
+  }
+
+  // Sort by slope so each quadrant angle span is a single run of the table
+  qsort(_pix, _count, sizeof(arc_pixel_t), [](const void *a, const void *b) -> int {
+    uint32_t sa = ((const arc_pixel_t*)a)->slope, sb = ((const arc_pixel_t*)b)->slope;
+    return (sa > sb) - (sa < sb);
+  });
+
+  _r = r;
+  _w = w;
+
+  return true;
+}
+
+
+/***************************************************************************************
+** Function name:           deleteCache
+** Description:             Free the coverage table
+***************************************************************************************/
+void TFT_eArcCache::deleteCache(void)
+{
+  free(_pix);
+
+  _pix    = nullptr;
+  _count  = 0;
+  _r      = 0;
+  _w      = 0;
+
+  _gValid = false;
+}
+
+
+/***************************************************************************************
+** Function name:           created
+** Description:             Returns true if a coverage table exists
+***************************************************************************************/
+bool TFT_eArcCache::created(void)
+{
+  return _pix != nullptr;
+}
+
+
+/***************************************************************************************
+** Function name:           drawArc
+** Description:             Draw the arc between start and end angles
+***************************************************************************************/
+void TFT_eArcCache::drawArc(TFT_eSPI *tft, int32_t x, int32_t y, int32_t startAngle, int32_t endAngle,
+                            uint32_t fg_color, uint32_t bg_color)
+{
+  if (!_pix || tft->_vpOoB) return;
+  if (endAngle < startAngle) transpose(startAngle, endAngle);
+  if (startAngle < 0) startAngle = 0;
+  if (endAngle > 360) endAngle = 360;
+
+  tft->inTransaction = true;
+
+  drawSpan(tft, x, y, startAngle, endAngle, fg_color, bg_color);
+
+  tft->inTransaction = tft->lockTransaction;
+  tft->end_tft_write();
+}
+
+
+/***************************************************************************************
+** Function name:           drawGauge
+** Description:             Draw a gauge arc, only the changed pixels are drawn
+***************************************************************************************/
+// The result is the same as drawing the arc from startAngle to endAngle in track_color
+// then the arc from startAngle to angle in fg_color (if angle > startAngle).
+void TFT_eArcCache::drawGauge(TFT_eSPI *tft, int32_t x, int32_t y, int32_t startAngle, int32_t endAngle,
+                              int32_t angle, uint32_t fg_color, uint32_t track_color, uint32_t bg_color)
+{
+  if (!_pix || tft->_vpOoB) return;
+  if (endAngle < startAngle) transpose(startAngle, endAngle);
+  if (startAngle < 0) startAngle = 0;
+  if (endAngle > 360) endAngle = 360;
+  if (angle < startAngle) angle = startAngle;
+  if (angle > endAngle) angle = endAngle;
+
+  tft->inTransaction = true;
+
+  if (!_gValid || x != _gx || y != _gy || startAngle != _gStart || endAngle != _gEnd ||
+      fg_color != _gFg || track_color != _gTrack || bg_color != _gBg) {
+    // Draw the whole gauge, pixels on the joining angle belong to the fg_color arc
+    if (angle < endAngle) drawSpan(tft, x, y, angle, endAngle, track_color, bg_color);
+    if (angle > startAngle) drawSpan(tft, x, y, startAngle, angle, fg_color, bg_color);
+  }
+  else if (angle > _gAngle) {
+    // Extend the fg_color arc
+    drawSpan(tft, x, y, _gAngle, angle, fg_color, bg_color);
+  }
+  else if (angle < _gAngle) {
+    // Restore the track then redraw the pixels on the new joining angle
+    drawSpan(tft, x, y, angle, _gAngle, track_color, bg_color);
+    if (angle > startAngle) drawSpan(tft, x, y, angle, angle, fg_color, bg_color);
+
+    // For a sector (ir = 0) the centre lines meet at the centre pixel, so restore it
+    if (_r == _w) {
+      if (angle > startAngle && axisSpan(startAngle, angle)) tft->drawPixel(x, y, fg_color);
+      else if (axisSpan(startAngle, endAngle)) tft->drawPixel(x, y, track_color);
+    }
+  }
+
+  _gValid = true;
+  _gx = x; _gy = y;
+  _gStart = startAngle; _gEnd = endAngle; _gAngle = angle;
+  _gFg = fg_color; _gTrack = track_color; _gBg = bg_color;
+
+  tft->inTransaction = tft->lockTransaction;
+  tft->end_tft_write();
+}
+
+
+/***************************************************************************************
+** Function name:           invalidate
+** Description:             Make the next drawGauge() call draw the whole gauge
+***************************************************************************************/
+void TFT_eArcCache::invalidate(void)
+{
+  _gValid = false;
+}
+
+
+/***************************************************************************************
+** Function name:           drawSpan
+** Description:             Draw the table pixels between the angles in each quadrant
+***************************************************************************************/
+// Angles are in range 0-360 and startAngle <= endAngle
+void TFT_eArcCache::drawSpan(TFT_eSPI *tft, int32_t x, int32_t y, int32_t startAngle, int32_t endAngle,
+                             uint32_t fg_color, uint32_t bg_color)
+{
+  //     1 | 2
+  //    ---¦---    Arc quadrant index
+  //     0 | 3
+  uint32_t startSlope[4], endSlope[4];
+  TFT_eSPI::arcSlopes(startAngle, endAngle, startSlope, endSlope);
+
+  for (uint8_t q = 0; q < 4; q++) {
+    // Slope decreases with angle in quadrants 0 and 2, increases in 1 and 3
+    uint32_t lo = (q & 1) ? startSlope[q] :   endSlope[q];
+    uint32_t hi = (q & 1) ?   endSlope[q] : startSlope[q];
+    if (lo > hi) continue;
+
+    int32_t sx = (q < 2) ? -1 : 1;
+    int32_t sy = (q == 0 || q == 3) ? 1 : -1;
+
+    arc_pixel_t *p   = _pix + findSlope(lo, false);
+    arc_pixel_t *end = _pix + findSlope(hi, true);
+    for (; p < end; p++) {
+      uint16_t pcol = p->fill ? fg_color : tft->alphaBlend(p->alpha, fg_color, bg_color);
+      tft->drawPixel(x + sx * p->dx, y + sy * p->dy, pcol);
+    }
+  }
+
+  // Fill in centre lines
+  int32_t r = _r, w = _w;
+  if (startAngle ==   0 || endAngle == 360) tft->drawFastVLine(x, y + r - w, w, fg_color); // Bottom
+  if (startAngle <=  90 && endAngle >=  90) tft->drawFastHLine(x - r + 1, y, w, fg_color); // Left
+  if (startAngle <= 180 && endAngle >= 180) tft->drawFastVLine(x, y - r + 1, w, fg_color); // Top
+  if (startAngle <= 270 && endAngle >= 270) tft->drawFastHLine(x + r - w, y, w, fg_color); // Right
+}
+
+
+/***************************************************************************************
+** Function name:           axisSpan
+** Description:             Returns true if drawSpan() draws a centre line for the angles
+***************************************************************************************/
+bool TFT_eArcCache::axisSpan(int32_t startAngle, int32_t endAngle)
+{
+  return startAngle == 0 || endAngle == 360 || (startAngle <=  90 && endAngle >=  90) ||
+        (startAngle <= 180 && endAngle >= 180) || (startAngle <= 270 && endAngle >= 270);
+}
+
+
+/***************************************************************************************
+** Function name:           findSlope
+** Description:             Binary search of the table for a slope
+***************************************************************************************/
+// Returns the index of the first pixel with slope >= value, or > value if above is true
+uint32_t TFT_eArcCache::findSlope(uint32_t slope, bool above)
+{
+  uint32_t lo = 0, hi = _count;
+
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) >> 1;
+    if (_pix[mid].slope < slope || (above && _pix[mid].slope == slope)) lo = mid + 1;
+    else hi = mid;
+  }
+
+  return lo;
+}
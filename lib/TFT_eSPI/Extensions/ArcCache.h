@@ -0,0 +1,69 @@
+/***************************************************************************************
+// The following class holds the anti-aliased pixel coverage of one quadrant of a smooth
+// arc with a fixed outer and inner radius. The table is built once, sorted by angle, so
+// any angle span of the arc can be drawn without the per pixel square root and blend
+// calculations of drawArc(), and only the pixels inside the span are visited.
+//
+// Pixels drawn for an angle span are the same as those drawn by drawArc() for the radii
+// and angles. This makes the class suitable for animated gauges where the arc is redrawn
+// at the same radii with only the end angle changing. The drawGauge() function keeps
+// the last angle drawn and only draws the pixels between the old and new angle.
+***************************************************************************************/
+
+class TFT_eArcCache {
+
+ public:
+
+  TFT_eArcCache(void);
+  ~TFT_eArcCache(void);
+
+           // Build the coverage table for outer radius r and inner radius ir, as for
+           // drawArc(). Returns false if the radii are invalid or there is no memory.
+           // Radius must be less than 255.
+  bool     createCache(int32_t r, int32_t ir);
+           // Release the table memory
+  void     deleteCache(void);
+           // True if a table has been created
+  bool     created(void);
+
+           // Draw the arc centred at x,y between the angles, as for drawArc() with smoothing.
+           // Angles are in range 0-360 with 0 at 6 o'clock, the end angle must be greater
+           // than the start angle (angles will be swapped otherwise).
+           // The target can be the TFT or a Sprite.
+  void     drawArc(TFT_eSPI *tft, int32_t x, int32_t y, int32_t startAngle, int32_t endAngle,
+                   uint32_t fg_color, uint32_t bg_color);
+
+           // Draw a gauge arc between startAngle and endAngle. The part up to angle is drawn in
+           // fg_color and the rest in track_color. After the first call only the pixels that
+           // change are drawn, unless the position, angles or colours change.
+  void     drawGauge(TFT_eSPI *tft, int32_t x, int32_t y, int32_t startAngle, int32_t endAngle,
+                     int32_t angle, uint32_t fg_color, uint32_t track_color, uint32_t bg_color);
+           // Force the next drawGauge() call to draw the whole gauge (e.g. after a screen clear)
+  void     invalidate(void);
+
+ private:
+
+  // Pixel offset from the arc centre in quadrant 0 (bottom left), with the U16.16 slope
+  // dy/dx used by drawArc() to test which quadrant angle spans the pixel is in.
+  // Fill is set for pixels in the fully covered part of the arc, otherwise the pixel
+  // colour is blended using alpha.
+  typedef struct {
+    uint32_t slope;
+    uint8_t  dx, dy;
+    uint8_t  alpha, fill;
+  } arc_pixel_t;
+
+  arc_pixel_t *_pix;          // Coverage table sorted by slope
+  uint32_t _count;            // Pixels in the table
+  int32_t  _r, _w;            // Outer anti-alias zone radius (r + 1) and arc thickness
+
+  // Last gauge drawn
+  bool     _gValid;
+  int32_t  _gx, _gy, _gStart, _gEnd, _gAngle;
+  uint32_t _gFg, _gTrack, _gBg;
+
+  void     drawSpan(TFT_eSPI *tft, int32_t x, int32_t y, int32_t startAngle, int32_t endAngle,
+                    uint32_t fg_color, uint32_t bg_color);
+  bool     axisSpan(int32_t startAngle, int32_t endAngle);
+  uint32_t findSlope(uint32_t slope, bool above);
+};
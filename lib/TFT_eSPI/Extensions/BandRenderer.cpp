@@ -0,0 +1,246 @@
+/**************************************************************************************
+// The following class replays display lists into horizontal bands of a Sprite with a
+// worker per band.
+***************************************************************************************/
+
+/***************************************************************************************
+** Function name:           TFT_eBandRenderer
+** Description:             Class constructor
+***************************************************************************************/
+TFT_eBandRenderer::TFT_eBandRenderer(void)
+{
+  _bands = 0;
+  _lists = 0;
+  _stop  = false;
+
+#if defined (ESP32)
+  _done = nullptr;
+#else
+  _frame   = 0;
+  _pending = 0;
+#endif
+
+  for (uint8_t i = 0; i < BR_MAX_BANDS; i++) {
+    _band[i].renderer = this;
+    _band[i].spr  = nullptr;
+    _band[i].ys   = 0;
+    _band[i].ye   = -1;
+    _band[i].time = 0;
+  }
+}
+
+
+/***************************************************************************************
+** Function name:           ~TFT_eBandRenderer
+** Description:             Class destructor
+***************************************************************************************/
+TFT_eBandRenderer::~TFT_eBandRenderer(void)
+{
+  end();
+}
+
+
+/***************************************************************************************
+** Function name:           begin
+** Description:             Create the band Sprites and start a worker per band
+***************************************************************************************/
+bool TFT_eBandRenderer::begin(uint8_t bands)
+{
+  if (_bands) return true;
+  if (bands < 1) bands = 1;
+  if (bands > BR_MAX_BANDS) bands = BR_MAX_BANDS;
+
+  _stop = false;
+
+#if defined (ESP32)
+  _done = xSemaphoreCreateCounting(BR_MAX_BANDS, 0);
+  if (_done == nullptr) return false;
+  // Workers run at the priority of the task that renders
+  UBaseType_t priority = uxTaskPriorityGet(nullptr);
+#endif
+
+  for (uint8_t i = 0; i < bands; i++) {
+    br_band_t* band = &_band[i];
+    // The Sprite never pushes, so it needs no TFT
+    band->spr = new TFT_eSprite(nullptr);
+#if defined (ESP32)
+    if (xTaskCreatePinnedToCore(worker, "band", BR_STACK, band, priority, &band->task,
+                                i % portNUM_PROCESSORS) != pdPASS) {
+      delete band->spr;
+      band->spr = nullptr;
+      end();
+      return false;
+    }
+#else
+    band->thread = std::thread(worker, band);
+#endif
+    _bands++;
+  }
+
+  return true;
+}
+
+
+/***************************************************************************************
+** Function name:           end
+** Description:             Stop the workers and delete the band Sprites
+***************************************************************************************/
+void TFT_eBandRenderer::end(void)
+{
+  if (_bands == 0) return;
+
+  _stop = true;
+
+#if defined (ESP32)
+  for (uint8_t i = 0; i < _bands; i++) xTaskNotifyGive(_band[i].task);
+  // Each worker gives the semaphore once more before it deletes itself
+  for (uint8_t i = 0; i < _bands; i++) xSemaphoreTake(_done, portMAX_DELAY);
+  vSemaphoreDelete(_done);
+  _done = nullptr;
+#else
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _frame++;
+  }
+  _start.notify_all();
+  for (uint8_t i = 0; i < _bands; i++) _band[i].thread.join();
+#endif
+
+  for (uint8_t i = 0; i < _bands; i++) {
+    delete _band[i].spr;
+    _band[i].spr = nullptr;
+  }
+  _bands = 0;
+}
+
+
+/***************************************************************************************
+** Function name:           clear
+** Description:             Discard the lists to replay
+***************************************************************************************/
+void TFT_eBandRenderer::clear(void)
+{
+  _lists = 0;
+}
+
+
+/***************************************************************************************
+** Function name:           add
+** Description:             Add a display list to replay
+***************************************************************************************/
+void TFT_eBandRenderer::add(TFT_eDisplayList *list)
+{
+  if (list == nullptr || _lists >= BR_MAX_LISTS) return;
+  _list[_lists++] = list;
+}
+
+
+/***************************************************************************************
+** Function name:           render
+** Description:             Replay the lists into the Sprite, a band per worker
+***************************************************************************************/
+void TFT_eBandRenderer::render(TFT_eSprite *spr)
+{
+  if (spr == nullptr || !spr->created()) return;
+
+  // Without workers the lists are replayed on the calling task
+  if (_bands == 0) {
+    for (uint8_t i = 0; i < _lists; i++) _list[i]->replay(spr);
+    return;
+  }
+
+  // Split the rows evenly, the viewport of each band Sprite clips drawing to its band
+  int32_t h = spr->height();
+  for (uint8_t i = 0; i < _bands; i++) {
+    br_band_t* band = &_band[i];
+    band->ys = h * i / _bands;
+    band->ye = h * (i + 1) / _bands - 1;
+    band->spr->shareSprite(spr);
+    band->spr->setViewport(0, band->ys, spr->width(), band->ye - band->ys + 1, false);
+  }
+
+#if defined (ESP32)
+  for (uint8_t i = 0; i < _bands; i++) xTaskNotifyGive(_band[i].task);
+  for (uint8_t i = 0; i < _bands; i++) xSemaphoreTake(_done, portMAX_DELAY);
+#else
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _pending = _bands;
+    _frame++;
+    _start.notify_all();
+    _finished.wait(lock, [this] { return _pending == 0; });
+  }
+#endif
+
+  for (uint8_t i = 0; i < _bands; i++) _band[i].spr->deleteSprite();
+}
+
+
+/***************************************************************************************
+** Function name:           bands
+** Description:             Return the number of bands
+***************************************************************************************/
+uint8_t TFT_eBandRenderer::bands(void)
+{
+  return _bands;
+}
+
+
+/***************************************************************************************
+** Function name:           bandTime
+** Description:             Return the microseconds a band took in the last render
+***************************************************************************************/
+uint32_t TFT_eBandRenderer::bandTime(uint8_t band)
+{
+  if (band >= _bands) return 0;
+  return _band[band].time;
+}
+
+
+/***************************************************************************************
+** Function name:           renderBand
+** Description:             Replay the lists into one band
+***************************************************************************************/
+void TFT_eBandRenderer::renderBand(br_band_t *band)
+{
+  uint32_t start = micros();
+  for (uint8_t i = 0; i < _lists; i++) _list[i]->replay(band->spr, band->ys, band->ye);
+  band->time = micros() - start;
+}
+
+
+/***************************************************************************************
+** Function name:           worker
+** Description:             Render the band each time a frame is started
+***************************************************************************************/
+void TFT_eBandRenderer::worker(void *param)
+{
+  br_band_t* band = (br_band_t*)param;
+  TFT_eBandRenderer* renderer = band->renderer;
+
+#if defined (ESP32)
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (renderer->_stop) break;
+    renderer->renderBand(band);
+    xSemaphoreGive(renderer->_done);
+  }
+  xSemaphoreGive(renderer->_done);
+  vTaskDelete(nullptr);
+#else
+  uint32_t frame = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(renderer->_mutex);
+      renderer->_start.wait(lock, [&] { return renderer->_frame != frame; });
+      frame = renderer->_frame;
+      if (renderer->_stop) return;
+    }
+    renderer->renderBand(band);
+    {
+      std::lock_guard<std::mutex> lock(renderer->_mutex);
+      if (--renderer->_pending == 0) renderer->_finished.notify_one();
+    }
+  }
+#endif
+}
@@ -0,0 +1,78 @@
+/***************************************************************************************
+// The following class renders display lists into a Sprite in parallel. The Sprite
+// frame buffer is split into horizontal bands and a worker per band replays the lists
+// into it, clipped to the rows of its band. render() returns when every band is done,
+// so the Sprite can then be pushed as usual.
+//
+// On ESP32 the workers are tasks pinned to alternate cores, elsewhere they are
+// std::threads so the scaling can be measured on a host.
+***************************************************************************************/
+
+#define BR_MAX_BANDS 2 // One band per core
+#define BR_MAX_LISTS 8 // Display lists replayed per frame
+#define BR_STACK  6144 // Worker task stack, smooth fonts are rendered by the workers
+
+#if !defined (ESP32)
+  #include <condition_variable>
+  #include <mutex>
+  #include <thread>
+#endif
+
+class TFT_eBandRenderer {
+
+ public:
+
+  TFT_eBandRenderer(void);
+  ~TFT_eBandRenderer(void);
+
+           // Start a worker for each band, returns false if they could not be started
+  bool     begin(uint8_t bands = BR_MAX_BANDS);
+           // Stop the workers
+  void     end(void);
+
+           // Discard the lists to replay
+  void     clear(void);
+           // Add a list to replay, lists are replayed in the order they are added
+  void     add(TFT_eDisplayList *list);
+
+           // Replay the lists into a created Sprite, returns when all bands are done
+  void     render(TFT_eSprite *spr);
+
+           // Number of bands and the microseconds each took in the last render()
+  uint8_t  bands(void);
+  uint32_t bandTime(uint8_t band);
+
+ private:
+
+  typedef struct {
+    TFT_eBandRenderer *renderer;
+    TFT_eSprite       *spr;    // Shares the target frame buffer, clipped to the band
+    int32_t            ys, ye; // Rows of the band
+    uint32_t           time;
+#if defined (ESP32)
+    TaskHandle_t       task;
+#else
+    std::thread        thread;
+#endif
+  } br_band_t;
+
+  br_band_t         _band[BR_MAX_BANDS];
+  uint8_t           _bands;
+
+  TFT_eDisplayList *_list[BR_MAX_LISTS];
+  uint8_t           _lists;
+
+  bool              _stop;
+
+#if defined (ESP32)
+  SemaphoreHandle_t _done;   // Given by each worker when its band is done
+#else
+  std::mutex              _mutex;
+  std::condition_variable _start, _finished;
+  uint32_t                _frame;   // Incremented to start the workers
+  uint8_t                 _pending; // Bands not yet done
+#endif
+
+  void     renderBand(br_band_t *band);
+  static void worker(void *param);
+};
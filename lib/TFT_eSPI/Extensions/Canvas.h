@@ -0,0 +1,121 @@
+/***************************************************************************************
+// The following class template is a Sprite whose width, height and colour depth are
+// fixed at compile time, for example:
+//
+//   TFT_eCanvas<320, 170, TFT_Rgb565> canvas = TFT_eCanvas<320, 170, TFT_Rgb565>(&tft);
+//
+// The most used primitives (drawPixel, drawFastHLine, drawFastVLine and fillRect, and
+// so drawLine, drawRect, circles, triangles and fonts which are built on them) clip
+// against constant bounds, index the frame buffer with a constant stride and write the
+// pixel format directly without the run time colour depth checks of TFT_eSprite.
+//
+// All other TFT_eSprite functions are inherited unchanged. If a viewport or origin is
+// set the primitives fall back to the TFT_eSprite versions so the result is the same.
+***************************************************************************************/
+
+// Pixel formats for TFT_eCanvas, pack() converts a 565 colour to the frame buffer format
+struct TFT_Rgb565 {
+  typedef uint16_t pixel_t;
+  static const int8_t bpp = 16;
+  static inline pixel_t pack(uint32_t color) { return (pixel_t)((color >> 8) | (color << 8)); }
+};
+
+struct TFT_Rgb332 {
+  typedef uint8_t pixel_t;
+  static const int8_t bpp = 8;
+  static inline pixel_t pack(uint32_t color) {
+    return (pixel_t)((color & 0xE000)>>8 | (color & 0x0700)>>6 | (color & 0x0018)>>3);
+  }
+};
+
+template <int32_t W, int32_t H, typename FMT = TFT_Rgb565>
+class TFT_eCanvas : public TFT_eSprite {
+
+  static_assert(W > 0 && W <= 0x7FFF && H > 0 && H <= 0x7FFF, "Canvas size out of range");
+
+ public:
+
+  typedef typename FMT::pixel_t pixel_t;
+
+  explicit TFT_eCanvas(TFT_eSPI *tft) : TFT_eSprite(tft) { TFT_eSprite::setColorDepth(FMT::bpp); }
+
+           // Create the canvas frame buffer, the size is set by the template parameters
+  void*    createSprite(uint8_t frames = 1) { return TFT_eSprite::createSprite(W, H, frames); }
+
+           // Return a typed pointer to the frame buffer
+  pixel_t* getBuffer(void) { return (pixel_t*)_img8; }
+
+           // Fixed geometry primitives, these override the TFT_eSprite versions
+  void     drawPixel(int32_t x, int32_t y, uint32_t color)
+  {
+    if (!fullView()) { TFT_eSprite::drawPixel(x, y, color); return; }
+
+    if ((uint32_t)x >= (uint32_t)W || (uint32_t)y >= (uint32_t)H) return;
+
+    ((pixel_t*)_img8)[x + y * W] = FMT::pack(color);
+  }
+
+  void     drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color)
+  {
+    if (!fullView()) { TFT_eSprite::drawFastHLine(x, y, w, color); return; }
+
+    if ((uint32_t)y >= (uint32_t)H || x >= W) return;
+    if (x < 0) { w += x; x = 0; }
+    if (x + w > W) w = W - x;
+    if (w < 1) return;
+
+    fillSpan((pixel_t*)_img8 + x + y * W, FMT::pack(color), w);
+  }
+
+  void     drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color)
+  {
+    if (!fullView()) { TFT_eSprite::drawFastVLine(x, y, h, color); return; }
+
+    if ((uint32_t)x >= (uint32_t)W || y >= H) return;
+    if (y < 0) { h += y; y = 0; }
+    if (y + h > H) h = H - y;
+    if (h < 1) return;
+
+    pixel_t  c = FMT::pack(color);
+    pixel_t* p = (pixel_t*)_img8 + x + y * W;
+    while (h--) { *p = c; p += W; }
+  }
+
+  void     fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+  {
+    if (!fullView()) { TFT_eSprite::fillRect(x, y, w, h, color); return; }
+
+    if (x >= W || y >= H) return;
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > W) w = W - x;
+    if (y + h > H) h = H - y;
+    if (w < 1 || h < 1) return;
+
+    pixel_t* p = (pixel_t*)_img8 + x + y * W;
+    fillSpan(p, FMT::pack(color), w);
+    // Copy the first row to the remaining rows
+    pixel_t* row = p;
+    while (--h) {
+      row += W;
+      memcpy(row, p, w * sizeof(pixel_t));
+    }
+  }
+
+ private:
+
+           // The colour depth is set by the template parameters
+  using    TFT_eSprite::setColorDepth;
+
+           // True if the whole canvas is the drawing area, i.e. no viewport or origin is set
+  inline bool fullView(void)
+  {
+    return _created && ((_vpX | _vpY | _xDatum | _yDatum | (_vpW ^ W) | (_vpH ^ H)) == 0);
+  }
+
+  static inline void fillSpan(pixel_t *p, pixel_t c, int32_t n)
+  {
+    if (sizeof(pixel_t) == 1) { memset(p, c, n); return; }
+    while (n--) *p++ = c;
+  }
+};
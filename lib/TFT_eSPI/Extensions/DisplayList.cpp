@@ -0,0 +1,622 @@
+/**************************************************************************************
+// The following class records graphics primitives into a display list that can be
+// optimised and then replayed to the TFT in one transaction, or into a Sprite.
+***************************************************************************************/
+
+/***************************************************************************************
+** Function name:           TFT_eDisplayList
+** Description:             Class constructor
+***************************************************************************************/
+TFT_eDisplayList::TFT_eDisplayList(void)
+{
+  _cmd      = nullptr;
+  _count    = 0;
+  _cmdCap   = 0;
+
+  _pool     = nullptr;
+  _poolLen  = 0;
+  _poolCap  = 0;
+
+  _ptr      = nullptr;
+  _ptrCount = 0;
+  _ptrCap   = 0;
+
+  for (uint8_t i = 0; i < DL_MAX_PARAMS; i++) {
+    _colorParam[i] = TFT_BLACK;
+    _textParam[i]  = nullptr;
+  }
+}
+
+
+/***************************************************************************************
+** Function name:           ~TFT_eDisplayList
+** Description:             Class destructor
+***************************************************************************************/
+TFT_eDisplayList::~TFT_eDisplayList(void)
+{
+  deleteList();
+}
+
+
+/***************************************************************************************
+** Function name:           clear
+** Description:             Discard all commands but keep the allocated memory
+***************************************************************************************/
+void TFT_eDisplayList::clear(void)
+{
+  _count    = 0;
+  _poolLen  = 0;
+  _ptrCount = 0;
+}
+
+
+/***************************************************************************************
+** Function name:           deleteList
+** Description:             Discard all commands and free the memory
+***************************************************************************************/
+void TFT_eDisplayList::deleteList(void)
+{
+  free(_cmd);
+  free(_pool);
+  free(_ptr);
+
+  _cmd  = nullptr;
+  _pool = nullptr;
+  _ptr  = nullptr;
+
+  _cmdCap = 0;
+  _poolCap = 0;
+  _ptrCap = 0;
+
+  for (uint8_t i = 0; i < DL_MAX_PARAMS; i++) {
+    free(_textParam[i]);
+    _textParam[i] = nullptr;
+  }
+
+  clear();
+}
+
+
+/***************************************************************************************
+** Function name:           size
+** Description:             Return the number of commands in the list
+***************************************************************************************/
+uint16_t TFT_eDisplayList::size(void)
+{
+  return _count;
+}
+
+
+/***************************************************************************************
+** Function name:           addCommand
+** Description:             Append a command, grow the buffer when full
+***************************************************************************************/
+TFT_eDisplayList::dl_cmd_t* TFT_eDisplayList::addCommand(uint8_t op, uint32_t color)
+{
+  if (_count >= _cmdCap) {
+    if (_cmdCap >= 0x8000) return nullptr;
+    uint16_t cap = _cmdCap ? _cmdCap * 2 : 32;
+    dl_cmd_t* cmd = (dl_cmd_t*) realloc(_cmd, cap * sizeof(dl_cmd_t));
+    if (cmd == nullptr) return nullptr;
+    _cmd = cmd;
+    _cmdCap = cap;
+  }
+
+  dl_cmd_t* c = &_cmd[_count++];
+  c->op    = op;
+  c->flags = 0;
+  c->arg   = 0;
+  c->x = c->y = c->w = c->h = 0;
+
+  if ((color & 0xFFFFFF00) == DL_PARAM_TAG) {
+    c->flags |= DL_COLOR_PARAM;
+    c->color  = color & 0xFF;
+  }
+  else c->color = color;
+
+  return c;
+}
+
+
+/***************************************************************************************
+** Function name:           addPointer
+** Description:             Store an image or font pointer, return the table index
+***************************************************************************************/
+uint16_t TFT_eDisplayList::addPointer(const void *p)
+{
+  for (uint16_t i = 0; i < _ptrCount; i++) if (_ptr[i] == p) return i;
+
+  if (_ptrCount >= _ptrCap) {
+    uint16_t cap = _ptrCap ? _ptrCap * 2 : 4;
+    const void** ptr = (const void**) realloc(_ptr, cap * sizeof(void*));
+    if (ptr == nullptr) return 0xFFFF;
+    _ptr = ptr;
+    _ptrCap = cap;
+  }
+
+  _ptr[_ptrCount] = p;
+  return _ptrCount++;
+}
+
+
+/***************************************************************************************
+** Function name:           fillScreen
+** Description:             Record a fill of the whole target area
+***************************************************************************************/
+void TFT_eDisplayList::fillScreen(uint32_t color)
+{
+  addCommand(DL_FILL_SCREEN, color);
+}
+
+
+/***************************************************************************************
+** Function name:           drawPixel
+** Description:             Record a single pixel
+***************************************************************************************/
+void TFT_eDisplayList::drawPixel(int32_t x, int32_t y, uint32_t color)
+{
+  dl_cmd_t* c = addCommand(DL_PIXEL, color);
+  if (c == nullptr) return;
+  c->x = x; c->y = y; c->w = 1; c->h = 1;
+}
+
+
+/***************************************************************************************
+** Function name:           drawFastHLine
+** Description:             Record a horizontal line, stored as a filled rectangle
+***************************************************************************************/
+void TFT_eDisplayList::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color)
+{
+  fillRect(x, y, w, 1, color);
+}
+
+
+/***************************************************************************************
+** Function name:           drawFastVLine
+** Description:             Record a vertical line, stored as a filled rectangle
+***************************************************************************************/
+void TFT_eDisplayList::drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color)
+{
+  fillRect(x, y, 1, h, color);
+}
+
+
+/***************************************************************************************
+** Function name:           drawLine
+** Description:             Record a line between two points
+***************************************************************************************/
+void TFT_eDisplayList::drawLine(int32_t xs, int32_t ys, int32_t xe, int32_t ye, uint32_t color)
+{
+  dl_cmd_t* c = addCommand(DL_LINE, color);
+  if (c == nullptr) return;
+  c->x = xs; c->y = ys; c->w = xe; c->h = ye;
+}
+
+
+/***************************************************************************************
+** Function name:           drawRect
+** Description:             Record a rectangle outline as four lines, as drawn by TFT_eSPI
+***************************************************************************************/
+void TFT_eDisplayList::drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+  drawFastHLine(x, y, w, color);
+  drawFastHLine(x, y + h - 1, w, color);
+  // Avoid drawing corner pixels twice
+  drawFastVLine(x, y+1, h-2, color);
+  drawFastVLine(x + w - 1, y+1, h-2, color);
+}
+
+
+/***************************************************************************************
+** Function name:           fillRect
+** Description:             Record a filled rectangle
+***************************************************************************************/
+void TFT_eDisplayList::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+  if (w < 1 || h < 1) return;
+  dl_cmd_t* c = addCommand(DL_FILL_RECT, color);
+  if (c == nullptr) return;
+  c->x = x; c->y = y; c->w = w; c->h = h;
+}
+
+
+/***************************************************************************************
+** Function name:           drawCircle
+** Description:             Record a circle outline
+***************************************************************************************/
+void TFT_eDisplayList::drawCircle(int32_t x, int32_t y, int32_t r, uint32_t color)
+{
+  if (r < 0) return;
+  dl_cmd_t* c = addCommand(DL_DRAW_CIRCLE, color);
+  if (c == nullptr) return;
+  c->x = x - r; c->y = y - r; c->w = 2 * r + 1; c->h = 2 * r + 1; c->arg = r;
+}
+
+
+/***************************************************************************************
+** Function name:           fillCircle
+** Description:             Record a filled circle
+***************************************************************************************/
+void TFT_eDisplayList::fillCircle(int32_t x, int32_t y, int32_t r, uint32_t color)
+{
+  if (r < 0) return;
+  dl_cmd_t* c = addCommand(DL_FILL_CIRCLE, color);
+  if (c == nullptr) return;
+  c->x = x - r; c->y = y - r; c->w = 2 * r + 1; c->h = 2 * r + 1; c->arg = r;
+}
+
+
+/***************************************************************************************
+** Function name:           pushImage
+** Description:             Record a 16 bit image held in FLASH or in RAM that
+**                          remains valid until the list is replayed
+***************************************************************************************/
+void TFT_eDisplayList::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data)
+{
+  if (w < 1 || h < 1 || data == nullptr) return;
+  uint16_t index = addPointer(data);
+  if (index == 0xFFFF) return;
+  dl_cmd_t* c = addCommand(DL_IMAGE, 0);
+  if (c == nullptr) return;
+  c->x = x; c->y = y; c->w = w; c->h = h; c->arg = index;
+}
+
+
+/***************************************************************************************
+** Function name:           setTextColor
+** Description:             Record the text colour, background is not over-written
+***************************************************************************************/
+void TFT_eDisplayList::setTextColor(uint32_t color)
+{
+  dl_cmd_t* c = addCommand(DL_TEXT_COLOR, color);
+  if (c == nullptr) return;
+  c->flags |= DL_FG_ONLY;
+}
+
+
+/***************************************************************************************
+** Function name:           setTextColor
+** Description:             Record the text foreground and background colours
+***************************************************************************************/
+void TFT_eDisplayList::setTextColor(uint32_t fgcolor, uint32_t bgcolor, bool bgfill)
+{
+  dl_cmd_t* c = addCommand(DL_TEXT_COLOR, fgcolor);
+  if (c == nullptr) return;
+  if (bgfill) c->flags |= DL_BG_FILL;
+
+  // The background is kept at full width in a command of its own so that it can also
+  // refer to a parameter slot, the pair is never split as neither has an extent
+  if (addCommand(DL_TEXT_BG, bgcolor) == nullptr) _count--;
+}
+
+
+/***************************************************************************************
+** Function name:           setTextDatum
+** Description:             Record the text datum
+***************************************************************************************/
+void TFT_eDisplayList::setTextDatum(uint8_t datum)
+{
+  dl_cmd_t* c = addCommand(DL_TEXT_DATUM, 0);
+  if (c == nullptr) return;
+  c->arg = datum;
+}
+
+
+/***************************************************************************************
+** Function name:           loadFont
+** Description:             Record the selection of an anti-aliased font array
+***************************************************************************************/
+void TFT_eDisplayList::loadFont(const uint8_t array[])
+{
+  if (array == nullptr) return;
+  uint16_t index = addPointer(array);
+  if (index == 0xFFFF) return;
+  dl_cmd_t* c = addCommand(DL_FONT, 0);
+  if (c == nullptr) return;
+  c->arg = index;
+}
+
+
+/***************************************************************************************
+** Function name:           drawString
+** Description:             Record a string, the characters are copied to the pool
+***************************************************************************************/
+void TFT_eDisplayList::drawString(const char *string, int32_t x, int32_t y)
+{
+  uint32_t len = strlen(string) + 1;
+
+  if (_poolLen + len > 0xFFFF) return;
+
+  if (_poolLen + len > _poolCap) {
+    uint32_t cap = _poolCap ? _poolCap : 128;
+    while (cap < _poolLen + len) cap *= 2;
+    char* pool = (char*) realloc(_pool, cap);
+    if (pool == nullptr) return;
+    _pool = pool;
+    _poolCap = cap;
+  }
+
+  dl_cmd_t* c = addCommand(DL_TEXT, 0);
+  if (c == nullptr) return;
+  c->x = x; c->y = y; c->arg = _poolLen;
+
+  memcpy(_pool + _poolLen, string, len);
+  _poolLen += len;
+}
+
+void TFT_eDisplayList::drawString(const String& string, int32_t x, int32_t y)
+{
+  drawString(string.c_str(), x, y);
+}
+
+void TFT_eDisplayList::drawString(const TFT_eText& text, int32_t x, int32_t y)
+{
+  drawString(text.c_str(), x, y);
+}
+
+
+/***************************************************************************************
+** Function name:           drawTextParam
+** Description:             Record a string held in a text parameter slot
+***************************************************************************************/
+void TFT_eDisplayList::drawTextParam(uint8_t slot, int32_t x, int32_t y)
+{
+  if (slot >= DL_MAX_PARAMS) return;
+  dl_cmd_t* c = addCommand(DL_TEXT_PARAM, 0);
+  if (c == nullptr) return;
+  c->x = x; c->y = y; c->arg = slot;
+}
+
+
+/***************************************************************************************
+** Function name:           colorParam
+** Description:             Return the tagged colour value for a parameter slot
+***************************************************************************************/
+uint32_t TFT_eDisplayList::colorParam(uint8_t slot)
+{
+  if (slot >= DL_MAX_PARAMS) slot = DL_MAX_PARAMS - 1;
+  return DL_PARAM_TAG | slot;
+}
+
+
+/***************************************************************************************
+** Function name:           setColorParam
+** Description:             Set the colour for a parameter slot
+***************************************************************************************/
+void TFT_eDisplayList::setColorParam(uint8_t slot, uint32_t color)
+{
+  if (slot >= DL_MAX_PARAMS) return;
+  _colorParam[slot] = color;
+}
+
+
+/***************************************************************************************
+** Function name:           setTextParam
+** Description:             Set the string for a text parameter slot
+***************************************************************************************/
+void TFT_eDisplayList::setTextParam(uint8_t slot, const char *string)
+{
+  if (slot >= DL_MAX_PARAMS) return;
+
+  uint32_t len = strlen(string) + 1;
+  char* text = (char*) realloc(_textParam[slot], len);
+  if (text == nullptr) return;
+
+  memcpy(text, string, len);
+  _textParam[slot] = text;
+}
+
+
+/***************************************************************************************
+** Function name:           colorOf
+** Description:             Return the colour for a command, resolving parameters
+***************************************************************************************/
+uint32_t TFT_eDisplayList::colorOf(const dl_cmd_t *c)
+{
+  if (c->flags & DL_COLOR_PARAM) return _colorParam[c->color];
+  return c->color;
+}
+
+
+/***************************************************************************************
+** Function name:           boundsOf
+** Description:             Get the inclusive bounding box of a command, returns
+**                          false if the command has no known extent (text, state)
+***************************************************************************************/
+bool TFT_eDisplayList::boundsOf(const dl_cmd_t *c, int32_t *xs, int32_t *ys, int32_t *xe, int32_t *ye)
+{
+  switch (c->op) {
+    case DL_PIXEL:
+    case DL_FILL_RECT:
+    case DL_DRAW_CIRCLE:
+    case DL_FILL_CIRCLE:
+    case DL_IMAGE:
+      *xs = c->x; *ys = c->y; *xe = c->x + c->w - 1; *ye = c->y + c->h - 1;
+      return true;
+    case DL_LINE:
+      *xs = min(c->x, c->w); *xe = max(c->x, c->w);
+      *ys = min(c->y, c->h); *ye = max(c->y, c->h);
+      return true;
+    default:
+      return false;
+  }
+}
+
+
+/***************************************************************************************
+** Function name:           optimise
+** Description:             Remove hidden commands, sort by region and merge fills
+***************************************************************************************/
+// Commands without a known extent (text, text state, font changes, screen fills) are
+// treated as barriers, commands are never moved across them.
+#define DL_BAND_SHIFT 4 // Sort bands are 16 pixels high
+
+void TFT_eDisplayList::optimise(void)
+{
+  int32_t axs, ays, axe, aye, bxs, bys, bxe, bye;
+
+  // 1. Drop commands that a later screen fill or filled rectangle completely covers
+  for (int32_t j = _count - 1; j > 0; j--) {
+    dl_cmd_t* r = &_cmd[j];
+    if (r->op == DL_FILL_SCREEN) {
+      for (int32_t i = j - 1; i >= 0; i--) {
+        if (boundsOf(&_cmd[i], &axs, &ays, &axe, &aye) || _cmd[i].op == DL_FILL_SCREEN) _cmd[i].op = DL_NOP;
+      }
+      break; // Nothing earlier can be visible
+    }
+    if (r->op != DL_FILL_RECT) continue;
+    boundsOf(r, &bxs, &bys, &bxe, &bye);
+    for (int32_t i = j - 1; i >= 0; i--) {
+      dl_cmd_t* c = &_cmd[i];
+      if (!boundsOf(c, &axs, &ays, &axe, &aye)) continue;
+      if (axs >= bxs && axe <= bxe && ays >= bys && aye <= bye) c->op = DL_NOP;
+    }
+  }
+
+  // Compact the list
+  uint16_t n = 0;
+  for (uint16_t i = 0; i < _count; i++) if (_cmd[i].op != DL_NOP) _cmd[n++] = _cmd[i];
+  _count = n;
+
+  // 2. Stable insertion sort into raster order by band then x. A command only moves
+  //    ahead of another if their bounding boxes do not overlap, so the result of
+  //    drawing is unchanged.
+  for (uint16_t i = 1; i < _count; i++) {
+    if (!boundsOf(&_cmd[i], &axs, &ays, &axe, &aye)) continue;
+    dl_cmd_t cmd = _cmd[i];
+    int32_t  key = ((ays >> DL_BAND_SHIFT) << 16) + axs;
+    int32_t  j = i;
+    while (j > 0) {
+      dl_cmd_t* p = &_cmd[j - 1];
+      if (!boundsOf(p, &bxs, &bys, &bxe, &bye)) break;
+      if (((bys >> DL_BAND_SHIFT) << 16) + bxs <= key) break;
+      if (axs <= bxe && bxs <= axe && ays <= bye && bys <= aye) break;
+      _cmd[j] = *p;
+      j--;
+    }
+    _cmd[j] = cmd;
+  }
+
+  // 3. Merge neighbouring filled rectangles of the same colour whose union is a rectangle
+  n = 0;
+  for (uint16_t i = 0; i < _count; i++) {
+    dl_cmd_t* c = &_cmd[i];
+    if (n > 0) {
+      dl_cmd_t* p = &_cmd[n - 1];
+      if (p->op == DL_FILL_RECT && c->op == DL_FILL_RECT &&
+          p->color == c->color && p->flags == c->flags) {
+        // Side by side with the same rows
+        if (p->y == c->y && p->h == c->h && p->x + p->w == c->x && p->w + c->w <= 0x7FFF) {
+          p->w += c->w;
+          continue;
+        }
+        // Stacked with the same columns
+        if (p->x == c->x && p->w == c->w && p->y + p->h == c->y && p->h + c->h <= 0x7FFF) {
+          p->h += c->h;
+          continue;
+        }
+      }
+    }
+    _cmd[n++] = *c;
+  }
+  _count = n;
+}
+
+
+/***************************************************************************************
+** Function name:           replay
+** Description:             Replay the list to the TFT in one transaction
+***************************************************************************************/
+void TFT_eDisplayList::replay(TFT_eSPI *tft)
+{
+  tft->startWrite();
+  execute(tft, false, -0x8000, 0x7FFF);
+  tft->endWrite();
+}
+
+
+/***************************************************************************************
+** Function name:           replay
+** Description:             Replay the list into a Sprite
+***************************************************************************************/
+void TFT_eDisplayList::replay(TFT_eSprite *spr)
+{
+  execute(spr, true, -0x8000, 0x7FFF);
+}
+
+
+/***************************************************************************************
+** Function name:           replay
+** Description:             Replay the commands touching a band of rows into a Sprite
+***************************************************************************************/
+void TFT_eDisplayList::replay(TFT_eSprite *spr, int32_t ys, int32_t ye)
+{
+  execute(spr, true, ys, ye);
+}
+
+
+/***************************************************************************************
+** Function name:           execute
+** Description:             Run the commands touching rows ys to ye against a TFT or
+**                          Sprite, state and text commands are always run
+***************************************************************************************/
+void TFT_eDisplayList::execute(TFT_eSPI *tft, bool sprite, int32_t ys, int32_t ye)
+{
+  // A band covers part of the full coordinate range
+  bool band = ys > -0x8000 || ye < 0x7FFF;
+  int32_t bxs, bys, bxe, bye;
+
+  for (uint16_t i = 0; i < _count; i++) {
+    const dl_cmd_t* c = &_cmd[i];
+    if (band && boundsOf(c, &bxs, &bys, &bxe, &bye) && (bye < ys || bys > ye)) continue;
+    switch (c->op) {
+      case DL_FILL_SCREEN:
+        // A sprite fill ignores a viewport without a datum, so a band fills its rows
+        if (band) tft->fillRect(0, ys, tft->width(), ye - ys + 1, colorOf(c));
+        else if (sprite) ((TFT_eSprite*)tft)->fillSprite(colorOf(c));
+        else tft->fillScreen(colorOf(c));
+        break;
+      case DL_PIXEL:
+        tft->drawPixel(c->x, c->y, colorOf(c));
+        break;
+      case DL_FILL_RECT:
+        if (c->h == 1) tft->drawFastHLine(c->x, c->y, c->w, colorOf(c));
+        else if (c->w == 1) tft->drawFastVLine(c->x, c->y, c->h, colorOf(c));
+        else tft->fillRect(c->x, c->y, c->w, c->h, colorOf(c));
+        break;
+      case DL_LINE:
+        tft->drawLine(c->x, c->y, c->w, c->h, colorOf(c));
+        break;
+      case DL_DRAW_CIRCLE:
+        tft->drawCircle(c->x + c->arg, c->y + c->arg, c->arg, colorOf(c));
+        break;
+      case DL_FILL_CIRCLE:
+        tft->fillCircle(c->x + c->arg, c->y + c->arg, c->arg, colorOf(c));
+        break;
+      case DL_IMAGE:
+        if (sprite) ((TFT_eSprite*)tft)->pushImage(c->x, c->y, c->w, c->h, (const uint16_t*)_ptr[c->arg]);
+        else tft->pushImage(c->x, c->y, c->w, c->h, (const uint16_t*)_ptr[c->arg]);
+        break;
+      case DL_TEXT_COLOR:
+        if (c->flags & DL_FG_ONLY) tft->setTextColor(colorOf(c));
+        else tft->setTextColor(colorOf(c), colorOf(c + 1), c->flags & DL_BG_FILL);
+        break;
+      case DL_TEXT_DATUM:
+        tft->setTextDatum(c->arg);
+        break;
+      case DL_FONT:
+#ifdef SMOOTH_FONT
+        tft->loadFont((const uint8_t*)_ptr[c->arg]);
+#endif
+        break;
+      case DL_TEXT:
+        tft->drawString(_pool + c->arg, c->x, c->y);
+        break;
+      case DL_TEXT_PARAM:
+        if (_textParam[c->arg]) tft->drawString(_textParam[c->arg], c->x, c->y);
+        break;
+      default:
+        break;
+    }
+  }
+}
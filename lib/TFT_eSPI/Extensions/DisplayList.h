@@ -0,0 +1,118 @@
+/***************************************************************************************
+// The following class records graphics primitives into a compact command buffer
+// (a "display list") instead of drawing them immediately. The list can then be
+// optimised (overdraw removal, merging of abutting fills and sorting by screen
+// region) and replayed to the TFT in a single SPI transaction, or into a Sprite.
+//
+// A recorded list can be replayed any number of times. Colours and strings may
+// be bound to numbered parameter slots so a cached list can be re-executed after
+// only those parameters have changed, without recording it again.
+***************************************************************************************/
+
+#define DL_MAX_PARAMS 8 // Number of colour and text parameter slots
+
+// Tag bit used to mark a colour value as a reference to a colour parameter slot
+#define DL_PARAM_TAG  0x40000000
+
+class TFT_eDisplayList {
+
+ public:
+
+  TFT_eDisplayList(void);
+  ~TFT_eDisplayList(void);
+
+           // Discard all recorded commands, the allocated memory is retained for re-use
+  void     clear(void);
+           // Discard all recorded commands and release the memory
+  void     deleteList(void);
+           // Number of commands in the list
+  uint16_t size(void);
+
+  // Recording, the parameters are as for the TFT_eSPI functions of the same name
+  void     fillScreen(uint32_t color), // Fills the whole target, TFT or Sprite
+           drawPixel(int32_t x, int32_t y, uint32_t color),
+           drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color),
+           drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color),
+           drawLine(int32_t xs, int32_t ys, int32_t xe, int32_t ye, uint32_t color),
+           drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color),
+           fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color),
+           drawCircle(int32_t x, int32_t y, int32_t r, uint32_t color),
+           fillCircle(int32_t x, int32_t y, int32_t r, uint32_t color),
+           pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data);
+
+           // Text state is applied to the target when the list is replayed
+  void     setTextColor(uint32_t color),
+           setTextColor(uint32_t fgcolor, uint32_t bgcolor, bool bgfill = false),
+           setTextDatum(uint8_t datum),
+           loadFont(const uint8_t array[]); // Anti-aliased font in a FLASH array
+
+           // The string is copied into the list so it can be a temporary
+  void     drawString(const char *string, int32_t x, int32_t y),
+           drawString(const String& string, int32_t x, int32_t y),
+           drawString(const TFT_eText& text, int32_t x, int32_t y),
+           // Draw the string held in a text parameter slot at replay time
+           drawTextParam(uint8_t slot, int32_t x, int32_t y);
+
+  // Parameters
+           // Return a colour value that refers to a colour parameter slot, the value can
+           // be passed as the colour to any recording function
+  uint32_t colorParam(uint8_t slot);
+           // Set the colour used at replay for commands that refer to the slot
+  void     setColorParam(uint8_t slot, uint32_t color);
+           // Set the string drawn at replay by drawTextParam() commands for the slot
+  void     setTextParam(uint8_t slot, const char *string);
+
+           // Remove commands that are completely over-drawn by later filled rectangles,
+           // move geometric commands into raster order by screen band where they do not
+           // overlap other commands and merge abutting fills of the same colour.
+           // The rendered result is identical to that of the un-optimised list.
+  void     optimise(void);
+
+           // Replay the list to the TFT inside a single transaction
+  void     replay(TFT_eSPI *tft);
+           // Replay the list into a Sprite
+  void     replay(TFT_eSprite *spr);
+           // Replay only the commands that touch rows ys to ye into a Sprite, screen fills
+           // cover just those rows. Drawing is not clipped to the rows, set a viewport for that.
+  void     replay(TFT_eSprite *spr, int32_t ys, int32_t ye);
+
+ private:
+
+  // Command codes
+  enum : uint8_t { DL_NOP, DL_FILL_SCREEN, DL_PIXEL, DL_FILL_RECT, DL_LINE,
+                   DL_DRAW_CIRCLE, DL_FILL_CIRCLE, DL_IMAGE, DL_TEXT_COLOR, DL_TEXT_DATUM,
+                   DL_FONT, DL_TEXT, DL_TEXT_PARAM, DL_TEXT_BG };
+
+  // Command flags
+  enum : uint8_t { DL_COLOR_PARAM = 0x01, DL_BG_FILL = 0x02, DL_FG_ONLY = 0x04 };
+
+  // A command is 16 bytes. x, y, w, h hold the bounding rectangle except for lines where
+  // they hold the end point coordinates. arg is a radius, datum, string pool offset,
+  // parameter slot or pointer table index depending on the command. A text colour with
+  // a background is followed by a DL_TEXT_BG command that holds the background colour.
+  typedef struct {
+    uint8_t  op;
+    uint8_t  flags;
+    uint16_t arg;
+    int16_t  x, y, w, h;
+    uint32_t color;
+  } dl_cmd_t;
+
+  dl_cmd_t *_cmd;           // Command buffer
+  uint16_t _count, _cmdCap; // Commands recorded and buffer capacity
+
+  char     *_pool;            // String pool for text commands
+  uint32_t _poolLen, _poolCap;
+
+  const void **_ptr;          // Pointer table for images and fonts
+  uint16_t _ptrCount, _ptrCap;
+
+  uint32_t _colorParam[DL_MAX_PARAMS];
+  char     *_textParam[DL_MAX_PARAMS];
+
+  dl_cmd_t* addCommand(uint8_t op, uint32_t color);
+  uint16_t addPointer(const void *p);
+  bool     boundsOf(const dl_cmd_t *c, int32_t *xs, int32_t *ys, int32_t *xe, int32_t *ye);
+  uint32_t colorOf(const dl_cmd_t *c);
+  void     execute(TFT_eSPI *tft, bool sprite, int32_t ys, int32_t ye);
+};
@@ -0,0 +1,261 @@
+/**************************************************************************************
+// The following class holds a 1, 2, 4 or 8 bit alpha mask that is tinted and blended
+// onto a Sprite or the TFT.
+***************************************************************************************/
+
+/***************************************************************************************
+** Function name:           TFT_eMask
+** Description:             Class constructor
+***************************************************************************************/
+TFT_eMask::TFT_eMask(void)
+{
+  _buf = nullptr;
+  setMask(nullptr, 0, 0, 1);
+}
+
+
+/***************************************************************************************
+** Function name:           TFT_eMask
+** Description:             Class constructor for a mask in FLASH or RAM
+***************************************************************************************/
+TFT_eMask::TFT_eMask(const uint8_t *data, int16_t width, int16_t height, uint8_t bpp)
+{
+  _buf = nullptr;
+  setMask(data, width, height, bpp);
+}
+
+
+/***************************************************************************************
+** Function name:           ~TFT_eMask
+** Description:             Class destructor
+***************************************************************************************/
+TFT_eMask::~TFT_eMask(void)
+{
+  deleteMask();
+}
+
+
+/***************************************************************************************
+** Function name:           setMask
+** Description:             Use an existing mask array, the data is not copied
+***************************************************************************************/
+void TFT_eMask::setMask(const uint8_t *data, int16_t width, int16_t height, uint8_t bpp)
+{
+  if (_buf && data != _buf) deleteMask();
+
+  if (bpp != 1 && bpp != 2 && bpp != 4 && bpp != 8) data = nullptr;
+  if (width < 1 || height < 1) data = nullptr;
+
+  _data   = data;
+  _w      = data ? width  : 0;
+  _h      = data ? height : 0;
+  _bpp    = data ? bpp : 1;
+  _stride = (_w * _bpp + 7) >> 3;
+  _scale  = 255 / ((1 << _bpp) - 1);
+}
+
+
+/***************************************************************************************
+** Function name:           createMask
+** Description:             Create a clear mask in RAM
+***************************************************************************************/
+void* TFT_eMask::createMask(int16_t width, int16_t height, uint8_t bpp)
+{
+  deleteMask();
+
+  if (width < 1 || height < 1) return nullptr;
+
+  _buf = (uint8_t*)calloc(((width * bpp + 7) >> 3) * height, 1);
+  setMask(_buf, width, height, bpp);
+
+  if (!_data) deleteMask();
+
+  return _buf;
+}
+
+
+/***************************************************************************************
+** Function name:           deleteMask
+** Description:             Free the memory of a created mask
+***************************************************************************************/
+void TFT_eMask::deleteMask(void)
+{
+  uint8_t *buf = _buf;
+
+  _buf = nullptr;
+  setMask(nullptr, 0, 0, 1);
+
+  free(buf);
+}
+
+
+/***************************************************************************************
+** Function name:           setAlpha
+** Description:             Set the coverage of a pixel in a created mask
+***************************************************************************************/
+void TFT_eMask::setAlpha(int32_t x, int32_t y, uint8_t alpha)
+{
+  if (!_buf || (x < 0) || (y < 0) || (x >= _w) || (y >= _h)) return;
+
+  uint8_t  max   = (1 << _bpp) - 1;
+  uint8_t  v     = (alpha * max + 127) / 255;
+  uint32_t bit   = x * _bpp;
+  uint8_t  shift = 8 - _bpp - (bit & 7);
+  uint8_t *p     = _buf + y * _stride + (bit >> 3);
+
+  *p = (*p & ~(max << shift)) | (v << shift);
+}
+
+
+/***************************************************************************************
+** Function name:           getAlpha
+** Description:             Get the coverage of a pixel in range 0-255
+***************************************************************************************/
+uint8_t TFT_eMask::getAlpha(int32_t x, int32_t y)
+{
+  if (!_data || (x < 0) || (y < 0) || (x >= _w) || (y >= _h)) return 0;
+
+  uint32_t bit = x * _bpp;
+  uint8_t  b   = pgm_read_byte(_data + y * _stride + (bit >> 3));
+
+  return ((b >> (8 - _bpp - (bit & 7))) & ((1 << _bpp) - 1)) * _scale;
+}
+
+
+/***************************************************************************************
+** Function name:           width, height, getDepth
+** Description:             Mask size and bits per pixel
+***************************************************************************************/
+int16_t TFT_eMask::width(void)
+{
+  return _w;
+}
+
+int16_t TFT_eMask::height(void)
+{
+  return _h;
+}
+
+uint8_t TFT_eMask::getDepth(void)
+{
+  return _bpp;
+}
+
+
+/***************************************************************************************
+** Function name:           pushMask
+** Description:             Tint and blend the mask onto a 16 bit Sprite
+***************************************************************************************/
+void TFT_eMask::pushMask(TFT_eSprite *spr, int32_t x, int32_t y, uint32_t color)
+{
+  if (!_data || !spr->_created || spr->_vpOoB) return;
+
+  if (spr->_bpp != 16) { pushMask((TFT_eSPI*)spr, x, y, color); return; }
+
+  x += spr->_xDatum;
+  y += spr->_yDatum;
+
+  // Find the area of the mask inside the viewport
+  int32_t i0 = 0, i1 = _w, j0 = 0, j1 = _h;
+  if (x < spr->_vpX) i0 = spr->_vpX - x;
+  if (y < spr->_vpY) j0 = spr->_vpY - y;
+  if (x + i1 > spr->_vpW) i1 = spr->_vpW - x;
+  if (y + j1 > spr->_vpH) j1 = spr->_vpH - y;
+  if ((i0 >= i1) || (j0 >= j1)) return;
+
+  uint16_t fg  = (uint16_t)((color >> 8) | (color << 8)); // Sprite colours are byte swapped
+  uint8_t  max = (1 << _bpp) - 1;
+  int32_t  ppw = 32 / _bpp; // Pixels per 32 bit word
+
+  // Icons are usually drawn on a plain background so keep the last blend for each mask
+  // value (up to 4 bpp), it is re-used while the background pixel is the same
+  uint16_t memoBg[16], memoColor[16];
+  uint16_t memoValid = 0;
+
+  for (int32_t j = j0; j < j1; j++) {
+    const uint8_t *row = _data + j * _stride;
+    uint16_t *dst = spr->_img + (y + j) * spr->_iwidth;
+
+    for (int32_t i = i0 - i0 % ppw; i < i1; i += ppw) {
+      uint32_t word = readWord(row, (i * _bpp) >> 3);
+      if (word == 0) continue; // All pixels clear
+
+      int32_t k  = (i < i0) ? i0 : i;
+      int32_t ke = (i + ppw > i1) ? i1 : i + ppw;
+
+      if (word == 0xFFFFFFFF) { // All pixels set
+        while (k < ke) dst[x + k++] = fg;
+        continue;
+      }
+
+      word <<= (k - i) * _bpp;
+      for (; k < ke; k++, word <<= _bpp) {
+        uint8_t v = word >> (32 - _bpp);
+        if (v == 0) continue;
+        if (v == max) { dst[x + k] = fg; continue; }
+        uint16_t bg = dst[x + k];
+        if (v < 16) {
+          if (!(memoValid & (1 << v)) || memoBg[v] != bg) {
+            uint16_t c = spr->alphaBlend(v * _scale, color, (bg >> 8) | (bg << 8));
+            memoBg[v]    = bg;
+            memoColor[v] = (c >> 8) | (c << 8);
+            memoValid   |= 1 << v;
+          }
+          dst[x + k] = memoColor[v];
+        }
+        else {
+          uint16_t c = spr->alphaBlend(v, color, (bg >> 8) | (bg << 8));
+          dst[x + k] = (c >> 8) | (c << 8);
+        }
+      }
+    }
+  }
+}
+
+
+/***************************************************************************************
+** Function name:           pushMask
+** Description:             Tint and blend the mask onto the TFT or a Sprite
+***************************************************************************************/
+void TFT_eMask::pushMask(TFT_eSPI *tft, int32_t x, int32_t y, uint32_t color, uint32_t bg_color)
+{
+  if (!_data) return;
+
+  uint8_t max = (1 << _bpp) - 1;
+
+  for (int32_t j = 0; j < _h; j++) {
+    const uint8_t *row = _data + j * _stride;
+    for (int32_t i = 0; i < _w; i++) {
+      uint32_t bit = i * _bpp;
+      uint8_t  v   = (pgm_read_byte(row + (bit >> 3)) >> (8 - _bpp - (bit & 7))) & max;
+      if (v == 0) continue;
+      if (v == max) tft->drawPixel(x + i, y + j, color);
+      else tft->drawPixel(x + i, y + j, color, v * _scale, bg_color);
+    }
+  }
+}
+
+
+/***************************************************************************************
+** Function name:           readWord
+** Description:             Read 32 bits of a mask row, MS byte first
+***************************************************************************************/
+// Bytes beyond the end of the row read as zero
+uint32_t TFT_eMask::readWord(const uint8_t *row, int32_t byte)
+{
+  row += byte;
+
+  if (byte + 4 <= _stride) {
+    return (uint32_t)pgm_read_byte(row) << 24 | (uint32_t)pgm_read_byte(row + 1) << 16 |
+           (uint32_t)pgm_read_byte(row + 2) << 8 | pgm_read_byte(row + 3);
+  }
+
+  uint32_t word = 0;
+
+  for (int32_t n = byte; n < byte + 4; n++, row++) {
+    word <<= 8;
+    if (n < _stride) word |= pgm_read_byte(row);
+  }
+
+  return word;
+}
@@ -0,0 +1,55 @@
+/***************************************************************************************
+// The following class holds an alpha mask, an image where each pixel is a coverage
+// (opacity) value of 1, 2, 4 or 8 bits. The mask is tinted with a colour and blended
+// onto the background when it is pushed, so one mask can be used for icons drawn in
+// any colour on any background. The mask can be a const array in FLASH (see the
+// bmp2array4bit tool -m option) or created in RAM and drawn with setAlpha().
+//
+// Rows are packed with the left pixel in the most significant bits of the first byte
+// and each row starts on a byte boundary (as for 1 bit Sprites).
+***************************************************************************************/
+
+class TFT_eMask {
+
+ public:
+
+  TFT_eMask(void);
+           // Use a mask in FLASH or RAM, the data is not copied
+  TFT_eMask(const uint8_t *data, int16_t width, int16_t height, uint8_t bpp);
+  ~TFT_eMask(void);
+
+           // Use a mask in FLASH or RAM, the data is not copied, bpp is 1, 2, 4 or 8
+  void     setMask(const uint8_t *data, int16_t width, int16_t height, uint8_t bpp);
+           // Create a clear mask in RAM, returns a pointer to the data or nullptr
+  void*    createMask(int16_t width, int16_t height, uint8_t bpp);
+           // Release the memory of a created mask
+  void     deleteMask(void);
+
+           // Set and get the coverage of a pixel in RAM, alpha is in range 0-255 and is
+           // reduced to the mask bits per pixel
+  void     setAlpha(int32_t x, int32_t y, uint8_t alpha);
+  uint8_t  getAlpha(int32_t x, int32_t y);
+
+  int16_t  width(void),
+           height(void);
+  uint8_t  getDepth(void);
+
+           // Tint the mask with color and blend it onto a 16 bit Sprite at x, y. The mask
+           // is read 32 bits at a time, all clear words are skipped and all set words are
+           // filled without blending. Sprites with other colour depths use drawPixel().
+  void     pushMask(TFT_eSprite *spr, int32_t x, int32_t y, uint32_t color);
+           // Tint the mask and blend it onto the TFT (or a Sprite) at x, y. If bg_color is
+           // not specified the background is read from the TFT
+  void     pushMask(TFT_eSPI *tft, int32_t x, int32_t y, uint32_t color, uint32_t bg_color = 0x00FFFFFF);
+
+ private:
+
+  const uint8_t *_data;     // Mask data
+  uint8_t  *_buf;           // Mask data in RAM if created
+  int16_t  _w, _h;          // Size in pixels
+  uint16_t _stride;         // Bytes per row
+  uint8_t  _bpp;            // Bits per pixel
+  uint8_t  _scale;          // Multiplier to convert mask values to 0-255 alpha
+
+  uint32_t readWord(const uint8_t *row, int32_t byte);
+};
@@ -13,6 +13,9 @@
 void TFT_eSPI::loadFont(const uint8_t array[])
 {
   if (array == nullptr) return;
+  // The metrics of the loaded array are still valid, display lists replayed every
+  // frame load the same font again
+  if (fontLoaded && gFont.gArray == array) return;
   fontPtr = (uint8_t*) array;
   loadFont("", false);
 }
@@ -356,8 +359,24 @@ bool TFT_eSPI::getUnicodeIndex(uint16_t unicode, uint16_t *index)
 ** Function name:           drawGlyph
 ** Description:             Write a character to the TFT cursor position
 *************************************************************************************x*/
-// Expects file to be open
 void TFT_eSPI::drawGlyph(uint16_t code)
+{
+  uint16_t gNum = 0;
+  bool found = false;
+
+  // Space and new line are handled without a glyph
+  if (code != 0x20 && code != '\n') found = getUnicodeIndex(code, &gNum);
+
+  drawGlyphIndex(code, found ? gNum : -1);
+}
+
+
+/***************************************************************************************
+** Function name:           drawGlyphIndex
+** Description:             Write a glyph found by getUnicodeIndex() to the cursor position
+*************************************************************************************x*/
+// Expects file to be open. gNum is -1 if the character is not in the font.
+void TFT_eSPI::drawGlyphIndex(uint16_t code, int32_t gNum)
 {
   uint16_t fg = textcolor;
   uint16_t bg = textbgcolor;
@@ -389,10 +408,7 @@ void TFT_eSPI::drawGlyph(uint16_t code)
     }
   }
 
-  uint16_t gNum = 0;
-  bool found = getUnicodeIndex(code, &gNum);
-  
-  if (found)
+  if (gNum >= 0)
   {
 
     if (textwrapX && (cursor_x + gWidth[gNum] + gdX[gNum] > width()))
@@ -13,6 +13,8 @@
   bool     getUnicodeIndex(uint16_t unicode, uint16_t *index);
 
   virtual void drawGlyph(uint16_t code);
+  // Draw glyph gNum (from getUnicodeIndex(), -1 if not in font), code is needed for space and new line
+  virtual void drawGlyphIndex(uint16_t code, int32_t gNum);
 
   void     showFont(uint32_t td);
 
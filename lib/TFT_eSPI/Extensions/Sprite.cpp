@@ -24,6 +24,7 @@ TFT_eSprite::TFT_eSprite(TFT_eSPI *tft)
   _swapBytes = false;   // Do not swap pushImage colour bytes by default
 
   _created = false;
+  _shared  = false;
   _vpOoB   = true;
 
   _xs = 0;  // window bounds for pushColor
@@ -111,6 +112,47 @@ void* TFT_eSprite::createSprite(int16_t w, int16_t h, uint8_t frames)
 }
 
 
+/***************************************************************************************
+** Function name:           shareSprite
+** Description:             Use the frame buffer of another Sprite without owning it
+***************************************************************************************/
+void* TFT_eSprite::shareSprite(TFT_eSprite *spr)
+{
+  if ( _created || spr == nullptr || !spr->_created ) return nullptr;
+
+  _bpp      = spr->_bpp;
+  _iwidth   = spr->_iwidth;
+  _iheight  = spr->_iheight;
+  _dwidth   = spr->_dwidth;
+  _dheight  = spr->_dheight;
+  _bitwidth = spr->_bitwidth;
+  _swapBytes = spr->_swapBytes;
+
+  cursor_x = 0;
+  cursor_y = 0;
+
+  _sx = 0;
+  _sy = 0;
+  _sw = _dwidth;
+  _sh = _dheight;
+  _scolor = TFT_BLACK;
+
+  _img8     = spr->_img8;
+  _img8_1   = spr->_img8_1;
+  _img8_2   = spr->_img8_2;
+  _img      = spr->_img;
+  _img4     = spr->_img4;
+  _colorMap = spr->_colorMap;
+
+  _created = true;
+  _shared  = true;
+  rotation = spr->rotation;
+  setViewport(0, 0, _dwidth, _dheight);
+  setPivot(_iwidth/2, _iheight/2);
+  return _img8_1;
+}
+
+
 /***************************************************************************************
 ** Function name:           getPointer
 ** Description:             Returns pointer to start of sprite memory area
@@ -143,6 +185,10 @@ TFT_eSprite::~TFT_eSprite(void)
 #ifdef SMOOTH_FONT
   if(fontLoaded) unloadFont();
 #endif
+
+#if defined (LOAD_GFXFF) && defined (GFXFF_GLYPH_CACHE)
+  gfxCacheFree();
+#endif
 }
 
 
@@ -377,6 +423,17 @@ uint16_t TFT_eSprite::getPaletteColor(uint8_t index)
 ***************************************************************************************/
 void TFT_eSprite::deleteSprite(void)
 {
+  if (_shared)
+  {
+    // The buffer and palette belong to the Sprite they were shared from
+    _colorMap = nullptr;
+    _img8 = nullptr;
+    _created = false;
+    _shared  = false;
+    _vpOoB   = true;
+    return;
+  }
+
   if (_colorMap != nullptr)
   {
     free(_colorMap);
@@ -1348,6 +1405,24 @@ void TFT_eSprite::pushColor(uint16_t color, uint32_t len)
 
   else pixelColor = (uint16_t) color; // for 1bpp or 4bpp
 
+  if (_bpp == 16) {
+    // Fill to the end of each window row without the per pixel wrap checks
+    while (len) {
+      uint32_t n = _xe - _xptr + 1;
+      if (n > len) n = len;
+      uint16_t *ptr = _img + _xptr + _yptr * _iwidth;
+      len -= n;
+      _xptr += n;
+      while (n--) *ptr++ = pixelColor;
+      if (_xptr > _xe) {
+        _xptr = _xs;
+        _yptr++;
+        if (_yptr > _ye) _yptr = _ys;
+      }
+    }
+    return;
+  }
+
   while(len--) writeColor(pixelColor);
 }
 
@@ -2083,40 +2158,56 @@ void TFT_eSprite::drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uin
           ((y + yo + h * size - 1) < (_vpY - _yDatum)))   // Clip top
         return;
 
-      uint8_t  *bitmap = (uint8_t *)pgm_read_dword(&gfxFont->bitmap);
-      uint32_t bo = pgm_read_word(&glyph->bitmapOffset);
-
-      uint8_t  xx, yy, bits=0, bit=0;
       //uint8_t  xa = pgm_read_byte(&glyph->xAdvance);
-      int16_t  xo16 = 0, yo16 = 0;
-
-      if(size > 1) {
-        xo16 = xo;
-        yo16 = yo;
-      }
-
-      uint16_t hpc = 0; // Horizontal foreground pixel count
-      for(yy=0; yy<h; yy++) {
-        for(xx=0; xx<w; xx++) {
-          if(bit == 0) {
-            bits = pgm_read_byte(&bitmap[bo++]);
-            bit  = 0x80;
-          }
-          if(bits & bit) hpc++;
-          else {
-            if (hpc) {
-              if(size == 1) drawFastHLine(x+xo+xx-hpc, y+yo+yy, hpc, color);
-              else fillRect(x+(xo16+xx-hpc)*size, y+(yo16+yy)*size, size*hpc, size, color);
-              hpc=0;
+      uint8_t  wpr = (w + 31) >> 5; // 32 bit words per glyph row
+      uint32_t row[8];
+      uint8_t  start, len;
+
+      gfx_bits_t bits;
+      const uint32_t *rows = gfxGlyphRows(glyph, c, &bits);
+
+      // 16 bit colour swapped for the sprite buffer
+      uint16_t color16 = (color >> 8) | (color << 8);
+
+      for (int32_t yy = 0; yy < h; yy++) {
+        const uint32_t *r = row;
+        if (rows) r = rows + yy * wpr;
+        else gfxRowBits(&bits, w, row);
+
+        if (_bpp == 16) {
+          // Write the runs straight into the buffer, clipped to the viewport
+          int32_t y0 = y + _yDatum + (yo + yy) * size;
+          int32_t y1 = y0 + size;
+          if (y0 >= _vpH) break;
+          if (y0 < _vpY) y0 = _vpY;
+          if (y1 > _vpH) y1 = _vpH;
+          if (y0 >= y1) continue;
+
+          for (int32_t k = 0; k < wpr; k++) {
+            uint32_t mask = r[k];
+            while (gfxNextSpan(&mask, &start, &len)) {
+              int32_t x0 = x + _xDatum + (xo + (k << 5) + start) * size;
+              int32_t x1 = x0 + len * size;
+              if (x0 < _vpX) x0 = _vpX;
+              if (x1 > _vpW) x1 = _vpW;
+              if (x0 >= x1) continue;
+
+              uint16_t *p = _img + _iwidth * y0 + x0;
+              for (int32_t i = 0; i < x1 - x0; i++) p[i] = color16;
+              // Scaled rows are copies of the first
+              for (int32_t ys = y0 + 1; ys < y1; ys++) memcpy(_img + _iwidth * ys + x0, p, (x1 - x0) << 1);
             }
           }
-          bit >>= 1;
+          continue;
         }
-        // Draw pixels for this line as we are about to increment yy
-        if (hpc) {
-          if(size == 1) drawFastHLine(x+xo+xx-hpc, y+yo+yy, hpc, color);
-          else fillRect(x+(xo16+xx-hpc)*size, y+(yo16+yy)*size, size*hpc, size, color);
-          hpc=0;
+
+        for (int32_t k = 0; k < wpr; k++) {
+          uint32_t mask = r[k];
+          while (gfxNextSpan(&mask, &start, &len)) {
+            int32_t xx = (k << 5) + start;
+            if(size == 1) drawFastHLine(x + xo + xx, y + yo + yy, len, color);
+            else fillRect(x + (xo + xx) * size, y + (yo + yy) * size, len * size, size, color);
+          }
         }
       }
     }
@@ -2275,6 +2366,8 @@ int16_t TFT_eSprite::drawChar(uint16_t uniCode, int32_t x, int32_t y, uint8_t fo
 
 #ifdef LOAD_RLE  //674 bytes of code
   // Font is not 2 and hence is RLE encoded
+  if (_bpp == 16) drawRleSpans(flash_address, xd, yd, width, height);
+  else
   {
     w *= height; // Now w is total number of pixels in the character
     int16_t color = textcolor;
@@ -2407,13 +2500,76 @@ int16_t TFT_eSprite::drawChar(uint16_t uniCode, int32_t x, int32_t y, uint8_t fo
 }
 
 
+#ifdef LOAD_RLE
+/***************************************************************************************
+** Function name:           drawRleSpans
+** Description:             Write an RLE font character to a 16 bit sprite as row spans
+***************************************************************************************/
+// Each run is split at the character row ends, scaled by textsize and clipped to the
+// viewport, then written straight into the sprite buffer. Background runs are skipped
+// if the text and background colours are the same. Decoding stops at the viewport end.
+void TFT_eSprite::drawRleSpans(uint32_t flash_address, int32_t xd, int32_t yd, int32_t width, int32_t height)
+{
+  if (!_created || width <= 0) return;
+
+  int32_t ts = textsize;
+  bool transparent = (textcolor == textbgcolor);
+  uint16_t color   = (textcolor >> 8) | (textcolor << 8);
+  uint16_t bgcolor = (textbgcolor >> 8) | (textbgcolor << 8);
+
+  // Rows of the character inside the viewport
+  int32_t rowStart = 0, rowEnd = height;
+  if (yd < _vpY) rowStart = (_vpY - yd) / ts;
+  if (yd + height * ts > _vpH) rowEnd = (_vpH - yd + ts - 1) / ts;
+  if (rowStart >= rowEnd || xd >= _vpW || xd + width * ts <= _vpX) return;
+
+  const uint8_t *ptr = (const uint8_t *)flash_address;
+  int32_t row = 0, col = 0;
+
+  while (row < rowEnd) {
+    uint8_t line = pgm_read_byte(ptr++);
+    bool fg = line & 0x80;
+    int32_t len = (line & 0x7F) + 1;
+
+    while (len && row < rowEnd) {
+      int32_t n = width - col;
+      if (n > len) n = len;
+
+      if ((fg || !transparent) && row >= rowStart) {
+        int32_t x0 = xd + col * ts;
+        int32_t x1 = x0 + n * ts;
+        int32_t y0 = yd + row * ts;
+        int32_t y1 = y0 + ts;
+        if (x0 < _vpX) x0 = _vpX;
+        if (x1 > _vpW) x1 = _vpW;
+        if (y0 < _vpY) y0 = _vpY;
+        if (y1 > _vpH) y1 = _vpH;
+
+        if (x0 < x1) {
+          uint16_t  c = fg ? color : bgcolor;
+          uint16_t *p = _img + _iwidth * y0 + x0;
+          for (int32_t i = 0; i < x1 - x0; i++) p[i] = c;
+          // Scaled rows are copies of the first
+          for (int32_t y = y0 + 1; y < y1; y++) memcpy(_img + _iwidth * y + x0, p, (x1 - x0) << 1);
+        }
+      }
+
+      col += n;
+      len -= n;
+      if (col >= width) { col = 0; row++; }
+    }
+  }
+}
+#endif
+
+
 #ifdef SMOOTH_FONT
 /***************************************************************************************
-** Function name:           drawGlyph
-** Description:             Write a character to the sprite cursor position
+** Function name:           drawGlyphIndex
+** Description:             Write a glyph to the sprite cursor position
 ***************************************************************************************/
-//
-void TFT_eSprite::drawGlyph(uint16_t code)
+// gNum is -1 if the character is not in the font
+void TFT_eSprite::drawGlyphIndex(uint16_t code, int32_t gNum)
 {
   uint16_t fg = textcolor;
   uint16_t bg = textbgcolor;
@@ -2447,10 +2603,7 @@ void TFT_eSprite::drawGlyph(uint16_t code)
     }
   }
 
-  uint16_t gNum = 0;
-  bool found = getUnicodeIndex(code, &gNum);
-
-  if (found)
+  if (gNum >= 0)
   {
 
     bool newSprite = !_created;
@@ -5,7 +5,7 @@
 // graphics are written to the Sprite rather than the TFT.
 ***************************************************************************************/
 
-class TFT_eSprite : public TFT_eSPI {
+class TFT_eSprite : public TFT_eSPI { friend class TFT_eMask; // Mask class blends into the Sprite buffer
 
  public:
 
@@ -21,6 +21,11 @@ class TFT_eSprite : public TFT_eSPI {
            //  - 2 bytes per pixel for 16 bit color depth (565 RGB format)
   void*    createSprite(int16_t width, int16_t height, uint8_t frames = 1);
 
+           // Draw into the frame buffer of another created Sprite, for example to render bands of
+           // it from several tasks with a viewport each. The buffer stays owned by that Sprite and
+           // must outlive this one, returns nullptr if this Sprite is already created
+  void*    shareSprite(TFT_eSprite *spr);
+
            // Returns a pointer to the sprite or nullptr if not created, user must cast to pointer type
   void*    getPointer(void);
 
@@ -139,8 +144,9 @@ class TFT_eSprite : public TFT_eSPI {
            height(void);
 
            // Functions associated with anti-aliased fonts
-           // Draw a single unicode character using the loaded font
-  void     drawGlyph(uint16_t code);
+           // Draw a glyph of the loaded font, gNum is from getUnicodeIndex() or -1 if the
+           // character is not in the font (drawGlyph() looks this up then calls this)
+  void     drawGlyphIndex(uint16_t code, int32_t gNum);
            // Print string to sprite using loaded font at cursor position
   void     printToSprite(String string);
            // Print char array to sprite using loaded font at cursor position
@@ -159,6 +165,11 @@ class TFT_eSprite : public TFT_eSPI {
   void     begin_nin_write(void) { ; }
   void     end_nin_write(void) { ; }
 
+#ifdef LOAD_RLE
+           // Write an RLE font character to a 16 bit sprite as clipped row spans
+  void     drawRleSpans(uint32_t flash_address, int32_t xd, int32_t yd, int32_t width, int32_t height);
+#endif
+
  protected:
 
   uint8_t  _bpp;     // bits per pixel (1, 4, 8 or 16)
@@ -174,6 +185,7 @@ class TFT_eSprite : public TFT_eSPI {
   int32_t  _cosra;   // Cosine of rotation angle in fixed point
 
   bool     _created; // A Sprite has been created and memory reserved
+  bool     _shared;  // The frame buffer belongs to another Sprite
   bool     _gFont = false; 
 
   int32_t  _xs, _ys, _xe, _ye, _xptr, _yptr; // for setWindow
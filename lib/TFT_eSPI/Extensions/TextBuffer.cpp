@@ -0,0 +1,142 @@
+/**************************************************************************************
+// The following classes hold text in a fixed size buffer and format numbers into it
+// without using the heap.
+***************************************************************************************/
+
+#include <charconv>
+#include <ctime>
+
+/***************************************************************************************
+** Function name:           TFT_eText
+** Description:             Class constructor, buf holds capacity characters and the
+**                          terminator
+***************************************************************************************/
+TFT_eText::TFT_eText(char *buf, uint16_t capacity)
+{
+  _buf = buf;
+  _capacity = capacity;
+  clear();
+}
+
+
+/***************************************************************************************
+** Function name:           clear
+** Description:             Empty the text
+***************************************************************************************/
+TFT_eText& TFT_eText::clear(void)
+{
+  _length = 0;
+  _truncated = false;
+  _buf[0] = 0;
+  return *this;
+}
+
+
+/***************************************************************************************
+** Function name:           append
+** Description:             Append len characters, cut at a UTF-8 character boundary if
+**                          they do not fit
+***************************************************************************************/
+void TFT_eText::append(const char *string, uint16_t len)
+{
+  if (len > _capacity - _length) {
+    len = _capacity - _length;
+    // Drop the start of a character cut by the end of the buffer
+    while (len > 0 && (string[len] & 0xC0) == 0x80) len--;
+    _truncated = true;
+  }
+  memcpy(_buf + _length, string, len);
+  _length += len;
+  _buf[_length] = 0;
+}
+
+
+/***************************************************************************************
+** Function name:           add
+** Description:             Append a string
+***************************************************************************************/
+TFT_eText& TFT_eText::add(const char *string)
+{
+  if (string) append(string, strnlen(string, 0xFFFF));
+  return *this;
+}
+
+
+/***************************************************************************************
+** Function name:           addInt, addUInt
+** Description:             Append a decimal integer and the unit
+***************************************************************************************/
+TFT_eText& TFT_eText::addInt(int32_t value, const char *unit)
+{
+  char digits[12];
+  std::to_chars_result end = std::to_chars(digits, digits + sizeof(digits), value);
+  append(digits, end.ptr - digits);
+  return add(unit);
+}
+
+TFT_eText& TFT_eText::addUInt(uint32_t value, const char *unit)
+{
+  char digits[12];
+  std::to_chars_result end = std::to_chars(digits, digits + sizeof(digits), value);
+  append(digits, end.ptr - digits);
+  return add(unit);
+}
+
+
+/***************************************************************************************
+** Function name:           addFixed
+** Description:             Append a float with a fixed number of decimals and the unit
+***************************************************************************************/
+TFT_eText& TFT_eText::addFixed(float value, uint8_t decimals, const char *unit)
+{
+  static const uint32_t scale[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+  if (decimals > 6) decimals = 6;
+
+  if (isnan(value)) { append("nan", 3); return add(unit); }
+
+  // Scaled in double so the rounding matches the decimal value of the float
+  double scaled = fabs((double)value) * scale[decimals] + 0.5;
+
+  // Out of range is shown as ... like drawFloat()
+  if (isinf(value) || scaled >= 4294967296.0) { append("...", 3); return add(unit); }
+
+  uint32_t fixed = (uint32_t)scaled;
+  uint32_t whole = fixed / scale[decimals];
+  uint32_t fraction = fixed - whole * scale[decimals];
+
+  // Zero has no sign, as -0.04 shown with one decimal
+  char digits[20];
+  char *p = digits;
+  if (value < 0 && fixed != 0) *p++ = '-';
+  p = std::to_chars(p, digits + sizeof(digits), whole).ptr;
+  if (decimals) {
+    *p++ = '.';
+    // Leading zeros of the fraction
+    char *end = p + decimals;
+    char *f = std::to_chars(p, end, fraction).ptr;
+    uint8_t len = f - p;
+    memmove(end - len, p, len);
+    memset(p, '0', decimals - len);
+    p = end;
+  }
+  append(digits, p - digits);
+  return add(unit);
+}
+
+
+/***************************************************************************************
+** Function name:           addTime
+** Description:             Append a time formatted by strftime(), nothing is appended
+**                          if it does not fit
+***************************************************************************************/
+TFT_eText& TFT_eText::addTime(const char *format, const struct tm *time)
+{
+  size_t len = strftime(_buf + _length, _capacity - _length + 1, format, time);
+  if (len == 0 && format[0]) {
+    _buf[_length] = 0;
+    _truncated = true;
+  }
+  _length += len;
+  return *this;
+}
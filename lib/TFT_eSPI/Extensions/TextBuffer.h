@@ -0,0 +1,80 @@
+/***************************************************************************************
+// The following classes hold text in a fixed size buffer and format numbers into it
+// without using the heap, for labels that are rebuilt every frame, for example:
+//
+//   TFT_eTextBuffer<24> label;
+//   label.addFixed(temperature, 1, "°C");
+//   tft.drawString(label, x, y);
+//
+// Text that does not fit is cut at a UTF-8 character boundary and truncated() is set.
+// TFT_eText is the buffer independent part, functions take it so they work with any
+// buffer size.
+***************************************************************************************/
+
+class TFT_eText {
+
+ public:
+
+           // Text so far, always zero terminated
+  const char* c_str(void) const { return _buf; }
+  uint16_t length(void) const { return _length; }
+  uint16_t capacity(void) const { return _capacity; }
+           // True if text was cut since created or cleared
+  bool     truncated(void) const { return _truncated; }
+
+  TFT_eText& clear(void);
+
+           // Append a string
+  TFT_eText& add(const char *string);
+  TFT_eText& add(const TFT_eText& text) { return add(text.c_str()); }
+
+           // Append a decimal integer, followed by the unit if not nullptr
+  TFT_eText& addInt(int32_t value, const char *unit = nullptr);
+  TFT_eText& addUInt(uint32_t value, const char *unit = nullptr);
+
+           // Append a float rounded to decimals places (0 to 6), followed by the unit
+           // if not nullptr. Halves round away from zero as in drawFloat().
+  TFT_eText& addFixed(float value, uint8_t decimals, const char *unit = nullptr);
+
+           // Append a time formatted as strftime()
+  TFT_eText& addTime(const char *format, const struct tm *time);
+
+ protected:
+
+  TFT_eText(char *buf, uint16_t capacity);
+
+           // Not copyable, the buffer belongs to the derived class
+  TFT_eText(const TFT_eText&) = delete;
+  TFT_eText& operator=(const TFT_eText&) = delete;
+
+ private:
+
+  void     append(const char *string, uint16_t len);
+
+  char    *_buf;
+  uint16_t _capacity;  // Characters excluding the terminator
+  uint16_t _length;
+  bool     _truncated;
+};
+
+
+// A TFT_eText holding up to N bytes of text in the object, so it can live on the stack
+template <uint16_t N>
+class TFT_eTextBuffer : public TFT_eText {
+
+ public:
+
+  TFT_eTextBuffer(void) : TFT_eText(_text, N) {}
+  TFT_eTextBuffer(const char *string) : TFT_eText(_text, N) { add(string); }
+  TFT_eTextBuffer(const TFT_eTextBuffer& other) : TFT_eText(_text, N) { add(other); }
+
+  TFT_eTextBuffer& operator=(const TFT_eTextBuffer& other)
+  {
+    if (&other != this) { clear(); add(other); }
+    return *this;
+  }
+
+ private:
+
+  char     _text[N + 1];
+};
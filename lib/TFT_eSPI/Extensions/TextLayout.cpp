@@ -0,0 +1,471 @@
+/**************************************************************************************
+// The following classes shape strings in a smooth font once so they can be measured
+// and drawn many times, see TextLayout.h
+***************************************************************************************/
+
+/***************************************************************************************
+** Function name:           TFT_eTextLayout
+** Description:             Class constructor
+***************************************************************************************/
+TFT_eTextLayout::TFT_eTextLayout(void)
+{
+  _glyph    = nullptr;
+  _text     = nullptr;
+  _count    = 0;
+  _width    = 0;
+  _height   = 0;
+  _baseline = 0;
+
+  _fArray   = nullptr;
+  _fCount   = 0;
+  _fAdvance = 0;
+  _fSpace   = 0;
+}
+
+
+/***************************************************************************************
+** Function name:           ~TFT_eTextLayout
+** Description:             Class destructor
+***************************************************************************************/
+TFT_eTextLayout::~TFT_eTextLayout(void)
+{
+  clear();
+}
+
+
+/***************************************************************************************
+** Function name:           setText
+** Description:             Shape a string in the smooth font loaded in tft
+***************************************************************************************/
+bool TFT_eTextLayout::setText(TFT_eSPI *tft, const char *string)
+{
+  if (_text && !strcmp(_text, string) && sameFont(tft)) return true;
+
+  clear();
+  if (!tft->fontLoaded) return false;
+
+  _text = strdup(string);
+  if (!_text) return false;
+
+  if (!shape(tft)) {
+    clear();
+    return false;
+  }
+
+  return true;
+}
+
+
+/***************************************************************************************
+** Function name:           clear
+** Description:             Release the layout memory
+***************************************************************************************/
+void TFT_eTextLayout::clear(void)
+{
+  free(_glyph);
+  free(_text);
+
+  _glyph    = nullptr;
+  _text     = nullptr;
+  _count    = 0;
+  _width    = 0;
+  _height   = 0;
+  _baseline = 0;
+  _fArray   = nullptr;
+}
+
+
+/***************************************************************************************
+** Function name:           text
+** Description:             Return the string shaped
+***************************************************************************************/
+const char* TFT_eTextLayout::text(void)
+{
+  return _text;
+}
+
+
+/***************************************************************************************
+** Function name:           sameFont
+** Description:             Returns true if the layout was shaped in the tft font
+***************************************************************************************/
+// Fonts loaded from a file have no array pointer so the metrics are also compared
+bool TFT_eTextLayout::sameFont(TFT_eSPI *tft)
+{
+  return tft->fontLoaded && _fArray == tft->gFont.gArray && _fCount == tft->gFont.gCount &&
+         _fAdvance == tft->gFont.yAdvance && _fSpace == tft->gFont.spaceWidth;
+}
+
+
+/***************************************************************************************
+** Function name:           width, height, baseline
+** Description:             Return the layout metrics
+***************************************************************************************/
+int16_t TFT_eTextLayout::width(void)
+{
+  return _width;
+}
+
+int16_t TFT_eTextLayout::height(void)
+{
+  return _height;
+}
+
+int16_t TFT_eTextLayout::baseline(void)
+{
+  return _baseline;
+}
+
+
+/***************************************************************************************
+** Function name:           getBounds
+** Description:             Return the area drawn for x,y and datum
+***************************************************************************************/
+void TFT_eTextLayout::getBounds(int32_t x, int32_t y, uint8_t datum, int32_t *bx, int32_t *by, int16_t *bw, int16_t *bh)
+{
+  datumOffset(datum, &x, &y);
+
+  *bx = x;
+  *by = y;
+  *bw = _width;
+  *bh = _height;
+}
+
+
+/***************************************************************************************
+** Function name:           glyphCount, glyphCode, glyphIndex, glyphX
+** Description:             Return the shaped characters
+***************************************************************************************/
+uint16_t TFT_eTextLayout::glyphCount(void)
+{
+  return _count;
+}
+
+uint16_t TFT_eTextLayout::glyphCode(uint16_t n)
+{
+  return (n < _count) ? _glyph[n].code : 0;
+}
+
+int32_t TFT_eTextLayout::glyphIndex(uint16_t n)
+{
+  return (n < _count) ? _glyph[n].index : -1;
+}
+
+int16_t TFT_eTextLayout::glyphX(uint16_t n)
+{
+  return (n < _count) ? _glyph[n].x : _width;
+}
+
+
+/***************************************************************************************
+** Function name:           drawString
+** Description:             Draw the layout at x,y using the tft text datum
+***************************************************************************************/
+int16_t TFT_eTextLayout::drawString(TFT_eSPI *tft, int32_t x, int32_t y)
+{
+  return drawString(tft, x, y, tft->textdatum);
+}
+
+
+/***************************************************************************************
+** Function name:           drawString
+** Description:             Draw the layout at x,y using a datum
+***************************************************************************************/
+// Follows the smooth font path of TFT_eSPI::drawString() so the same pixels are drawn
+int16_t TFT_eTextLayout::drawString(TFT_eSPI *tft, int32_t x, int32_t y, uint8_t datum)
+{
+  if (!_text || !tft->fontLoaded) return 0;
+  if (!sameFont(tft) && !shape(tft)) {
+    clear();
+    return 0;
+  }
+
+  int32_t cwidth = _width;
+  uint8_t padding = 1;
+
+  datumOffset(datum, &x, &y);
+  if (datum <= R_BASELINE) padding += datum % 3;
+
+  tft->setCursor(x, y);
+
+  bool fillbg = tft->_fillbg;
+  // If padding is requested then fill the text background
+  if (tft->padX && !tft->_fillbg) tft->_fillbg = true;
+
+  for (uint16_t n = 0; n < _count; n++) tft->drawGlyphIndex(_glyph[n].code, _glyph[n].index);
+
+  tft->_fillbg = fillbg; // restore state
+
+  int32_t padX = tft->padX;
+  if ((padX > cwidth) && (tft->textcolor != tft->textbgcolor)) {
+    int16_t padXc = x + cwidth;
+    switch(padding) {
+      case 1:
+        tft->fillRect(padXc, y, padX - cwidth, _height, tft->textbgcolor);
+        break;
+      case 2:
+        tft->fillRect(padXc, y, (padX - cwidth)>>1, _height, tft->textbgcolor);
+        padXc = x - ((padX - cwidth)>>1);
+        tft->fillRect(padXc, y, (padX - cwidth)>>1, _height, tft->textbgcolor);
+        break;
+      case 3:
+        if (padXc > padX) padXc = padX;
+        tft->fillRect(x + cwidth - padXc, y, padXc - cwidth, _height, tft->textbgcolor);
+        break;
+    }
+  }
+
+  return cwidth;
+}
+
+
+/***************************************************************************************
+** Function name:           shape
+** Description:             Decode the string and look up the glyphs in the tft font
+***************************************************************************************/
+// The width is found the same way as textWidth() so datum positions match drawString()
+bool TFT_eTextLayout::shape(TFT_eSPI *tft)
+{
+  uint16_t len = strlen(_text);
+  uint16_t n = 0;
+
+  free(_glyph);
+  _glyph = nullptr;
+  _count = 0;
+
+  // There can not be more characters than bytes
+  if (len) {
+    _glyph = (layout_glyph_t*)malloc(len * sizeof(layout_glyph_t));
+    if (!_glyph) return false;
+  }
+
+  int32_t str_width = 0;
+  int32_t cursor = 0;
+
+  while (n < len) {
+    uint16_t uniCode = tft->decodeUTF8((uint8_t*)_text, &n, len - n);
+    layout_glyph_t *g = _glyph + _count++;
+
+    g->code  = uniCode;
+    g->index = -1;
+    g->x     = cursor;
+
+    if (uniCode == 0x20) {
+      str_width += tft->gFont.spaceWidth;
+      cursor    += tft->gFont.spaceWidth;
+    }
+    else {
+      uint16_t gNum = 0;
+      if (tft->getUnicodeIndex(uniCode, &gNum)) {
+        // drawGlyph() moves the cursor to the next line for a new line, without a glyph
+        if (uniCode != '\n') g->index = gNum;
+        if (str_width == 0 && tft->gdX[gNum] < 0) str_width -= tft->gdX[gNum];
+        if (n < len) str_width += tft->gxAdvance[gNum];
+        else str_width += (tft->gdX[gNum] + tft->gWidth[gNum]);
+        cursor += tft->gxAdvance[gNum];
+      }
+      else {
+        str_width += tft->gFont.spaceWidth + 1;
+        cursor    += tft->gFont.spaceWidth + 1;
+      }
+    }
+  }
+
+  _width    = str_width;
+  _height   = tft->gFont.yAdvance;
+  _baseline = tft->gFont.maxAscent;
+
+  _fArray   = tft->gFont.gArray;
+  _fCount   = tft->gFont.gCount;
+  _fAdvance = tft->gFont.yAdvance;
+  _fSpace   = tft->gFont.spaceWidth;
+
+  return true;
+}
+
+
+/***************************************************************************************
+** Function name:           datumOffset
+** Description:             Move x,y from the datum point to the top left of the layout
+***************************************************************************************/
+void TFT_eTextLayout::datumOffset(uint8_t datum, int32_t *x, int32_t *y)
+{
+  if (datum > R_BASELINE) return;
+
+  // Datums are in rows of left, centre and right
+  switch (datum % 3) {
+    case 1: *x -= _width/2; break;
+    case 2: *x -= _width;   break;
+  }
+
+  switch (datum / 3) {
+    case 1: *y -= _height/2; break;  // Middle
+    case 2: *y -= _height;   break;  // Bottom
+    case 3: *y -= _baseline; break;  // Baseline
+  }
+}
+
+
+/***************************************************************************************
+** Function name:           TFT_eTextCache
+** Description:             Class constructor
+***************************************************************************************/
+TFT_eTextCache::TFT_eTextCache(uint8_t size)
+{
+  if (size == 0) size = 1;
+
+  _entry  = new cache_entry_t[size];
+  _size   = size;
+  _clock  = 0;
+  _hits   = 0;
+  _misses = 0;
+
+  for (uint8_t i = 0; i < _size; i++) {
+    _entry[i].hash = 0;
+    _entry[i].used = 0;
+  }
+}
+
+
+/***************************************************************************************
+** Function name:           ~TFT_eTextCache
+** Description:             Class destructor
+***************************************************************************************/
+TFT_eTextCache::~TFT_eTextCache(void)
+{
+  delete[] _entry;
+}
+
+
+/***************************************************************************************
+** Function name:           getLayout
+** Description:             Return the cached layout of a string, shaping it if needed
+***************************************************************************************/
+TFT_eTextLayout* TFT_eTextCache::getLayout(TFT_eSPI *tft, const char *string)
+{
+  if (!tft->fontLoaded) return nullptr;
+
+  uint32_t h = hash(tft, string);
+  cache_entry_t *lru = _entry;
+
+  _clock++;
+
+  for (uint8_t i = 0; i < _size; i++) {
+    cache_entry_t *e = _entry + i;
+    if (e->hash == h && e->layout.sameFont(tft) && !strcmp(e->layout.text(), string)) {
+      e->used = _clock;
+      _hits++;
+      return &e->layout;
+    }
+    if (e->used < lru->used) lru = e;
+  }
+
+  _misses++;
+
+  if (!lru->layout.setText(tft, string)) {
+    lru->hash = 0;
+    lru->used = 0;
+    return nullptr;
+  }
+
+  lru->hash = h;
+  lru->used = _clock;
+
+  return &lru->layout;
+}
+
+
+/***************************************************************************************
+** Function name:           drawString
+** Description:             Draw a string using its cached layout
+***************************************************************************************/
+int16_t TFT_eTextCache::drawString(TFT_eSPI *tft, const char *string, int32_t x, int32_t y)
+{
+  TFT_eTextLayout *layout = getLayout(tft, string);
+
+  if (!layout) return tft->drawString(string, x, y);
+
+  return layout->drawString(tft, x, y);
+}
+
+int16_t TFT_eTextCache::drawString(TFT_eSPI *tft, const String& string, int32_t x, int32_t y)
+{
+  return drawString(tft, string.c_str(), x, y);
+}
+
+int16_t TFT_eTextCache::drawString(TFT_eSPI *tft, const TFT_eText& text, int32_t x, int32_t y)
+{
+  return drawString(tft, text.c_str(), x, y);
+}
+
+
+/***************************************************************************************
+** Function name:           textWidth
+** Description:             Return the width of a string using its cached layout
+***************************************************************************************/
+int16_t TFT_eTextCache::textWidth(TFT_eSPI *tft, const char *string)
+{
+  TFT_eTextLayout *layout = getLayout(tft, string);
+
+  if (!layout) return tft->textWidth(string);
+
+  return layout->width();
+}
+
+
+/***************************************************************************************
+** Function name:           clear
+** Description:             Empty the cache
+***************************************************************************************/
+void TFT_eTextCache::clear(void)
+{
+  for (uint8_t i = 0; i < _size; i++) {
+    _entry[i].layout.clear();
+    _entry[i].hash = 0;
+    _entry[i].used = 0;
+  }
+
+  _clock  = 0;
+  _hits   = 0;
+  _misses = 0;
+}
+
+
+/***************************************************************************************
+** Function name:           hits, misses
+** Description:             Return the cache lookup counts
+***************************************************************************************/
+uint32_t TFT_eTextCache::hits(void)
+{
+  return _hits;
+}
+
+uint32_t TFT_eTextCache::misses(void)
+{
+  return _misses;
+}
+
+
+/***************************************************************************************
+** Function name:           hash
+** Description:             FNV-1a hash of the string and the font metrics
+***************************************************************************************/
+uint32_t TFT_eTextCache::hash(TFT_eSPI *tft, const char *string)
+{
+  uint32_t h = 2166136261UL;
+
+  while (*string) {
+    h ^= (uint8_t)*string++;
+    h *= 16777619UL;
+  }
+
+  uint32_t font[] = { (uint32_t)(uintptr_t)tft->gFont.gArray, tft->gFont.gCount,
+                      tft->gFont.yAdvance, tft->gFont.spaceWidth };
+  for (uint8_t i = 0; i < 4; i++) {
+    h ^= font[i];
+    h *= 16777619UL;
+  }
+
+  // Zero marks an empty entry
+  return h ? h : 1;
+}
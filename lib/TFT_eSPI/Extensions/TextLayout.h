@@ -0,0 +1,123 @@
+/***************************************************************************************
+// The following classes hold strings shaped in the loaded anti-aliased (smooth) font.
+//
+// drawString() walks a string twice, once in textWidth() to find the width needed for
+// the datum and again to draw it, decoding the UTF-8 and searching the font for every
+// character both times. A TFT_eTextLayout decodes the string and looks up the glyphs
+// once, keeping the glyph indices and x offsets, so it can be measured and then drawn
+// any number of times at any position and datum. The pixels drawn are the same as
+// drawString() with the same font, colours and padding.
+//
+// TFT_eTextCache keeps the layouts of recently drawn strings, found by a hash of the
+// string and font, so labels redrawn every frame are only shaped once.
+//
+// Layouts are for single line strings in a smooth font, the font used must be loaded
+// in the target when a layout is drawn.
+***************************************************************************************/
+
+class TFT_eTextLayout {
+
+ public:
+
+  TFT_eTextLayout(void);
+  ~TFT_eTextLayout(void);
+
+           // Shape the string in the smooth font loaded in tft. Returns false if a smooth
+           // font is not loaded or there is no memory.
+  bool     setText(TFT_eSPI *tft, const char *string);
+           // Release the layout memory
+  void     clear(void);
+
+           // The string shaped, or nullptr if none
+  const char* text(void);
+           // True if the layout was shaped in the font loaded in tft
+  bool     sameFont(TFT_eSPI *tft);
+
+           // Layout width and height in pixels, as textWidth() and fontHeight()
+  int16_t  width(void),
+           height(void),
+           // Baseline offset from the top of the layout
+           baseline(void);
+
+           // Top left corner and size of the area drawn for x,y and datum
+  void     getBounds(int32_t x, int32_t y, uint8_t datum, int32_t *bx, int32_t *by, int16_t *bw, int16_t *bh);
+
+           // Number of characters in the layout
+  uint16_t glyphCount(void);
+           // Unicode point, font glyph index (-1 for space, new line or not in font)
+           // and x offset from the start of the layout of character n
+  uint16_t glyphCode(uint16_t n);
+  int32_t  glyphIndex(uint16_t n);
+  int16_t  glyphX(uint16_t n);
+
+           // Draw the layout at x,y using the text datum, colours and padding of tft, as for
+           // drawString(). The layout is shaped again if the font in tft has changed.
+           // Returns the width drawn.
+  int16_t  drawString(TFT_eSPI *tft, int32_t x, int32_t y),
+           // As above but using datum in place of the tft text datum
+           drawString(TFT_eSPI *tft, int32_t x, int32_t y, uint8_t datum);
+
+ private:
+
+  typedef struct {
+    int32_t  index;           // Font glyph index, -1 if drawn without a glyph
+    uint16_t code;            // Unicode point
+    int16_t  x;               // Cursor offset from the layout start
+  } layout_glyph_t;
+
+  layout_glyph_t *_glyph;     // Shaped characters
+  char     *_text;            // Copy of the string so the layout can be reshaped
+  uint16_t _count;            // Characters in the layout
+  int16_t  _width, _height, _baseline;
+
+  // Font the layout was shaped in
+  const uint8_t *_fArray;
+  uint16_t _fCount, _fAdvance, _fSpace;
+
+  bool     shape(TFT_eSPI *tft);
+  void     datumOffset(uint8_t datum, int32_t *x, int32_t *y);
+};
+
+
+class TFT_eTextCache {
+
+ public:
+
+           // Cache holding up to size layouts, the least recently used is replaced
+  TFT_eTextCache(uint8_t size = 16);
+  ~TFT_eTextCache(void);
+
+           // Returns the layout of the string in the smooth font loaded in tft, shaping
+           // it if not cached. Returns nullptr if a smooth font is not loaded.
+  TFT_eTextLayout* getLayout(TFT_eSPI *tft, const char *string);
+
+           // Draw the string as drawString() using the cached layout. If a smooth font is
+           // not loaded the tft drawString() is used.
+  int16_t  drawString(TFT_eSPI *tft, const char *string, int32_t x, int32_t y),
+           drawString(TFT_eSPI *tft, const String& string, int32_t x, int32_t y),
+           drawString(TFT_eSPI *tft, const TFT_eText& text, int32_t x, int32_t y),
+           // Width of the string as textWidth() using the cached layout
+           textWidth(TFT_eSPI *tft, const char *string);
+
+           // Empty the cache
+  void     clear(void);
+
+           // Cache lookups found and shaped since created or cleared
+  uint32_t hits(void),
+           misses(void);
+
+ private:
+
+  typedef struct {
+    uint32_t hash;            // Hash of the string and font, 0 if the entry is empty
+    uint32_t used;            // Lookup count when last used
+    TFT_eTextLayout layout;
+  } cache_entry_t;
+
+  cache_entry_t *_entry;
+  uint8_t  _size;
+  uint32_t _clock;            // Lookup counter used to find the least recently used entry
+  uint32_t _hits, _misses;
+
+  uint32_t hash(TFT_eSPI *tft, const char *string);
+};
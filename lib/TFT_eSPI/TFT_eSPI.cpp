@@ -3218,45 +3218,32 @@ void TFT_eSPI::drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32
 
       c -= pgm_read_word(&gfxFont->first);
       GFXglyph *glyph  = &(((GFXglyph *)pgm_read_dword(&gfxFont->glyph))[c]);
-      uint8_t  *bitmap = (uint8_t *)pgm_read_dword(&gfxFont->bitmap);
 
-      uint32_t bo = pgm_read_word(&glyph->bitmapOffset);
       uint8_t  w  = pgm_read_byte(&glyph->width),
                h  = pgm_read_byte(&glyph->height);
                //xa = pgm_read_byte(&glyph->xAdvance);
       int8_t   xo = pgm_read_byte(&glyph->xOffset),
                yo = pgm_read_byte(&glyph->yOffset);
-      uint8_t  xx, yy, bits=0, bit=0;
-      int16_t  xo16 = 0, yo16 = 0;
-
-      if(size > 1) {
-        xo16 = xo;
-        yo16 = yo;
-      }
-
-      // GFXFF rendering speed up
-      uint16_t hpc = 0; // Horizontal foreground pixel count
-      for(yy=0; yy<h; yy++) {
-        for(xx=0; xx<w; xx++) {
-          if(bit == 0) {
-            bits = pgm_read_byte(&bitmap[bo++]);
-            bit  = 0x80;
-          }
-          if(bits & bit) hpc++;
-          else {
-           if (hpc) {
-              if(size == 1) drawFastHLine(x+xo+xx-hpc, y+yo+yy, hpc, color);
-              else fillRect(x+(xo16+xx-hpc)*size, y+(yo16+yy)*size, size*hpc, size, color);
-              hpc=0;
-            }
+      uint8_t  wpr = (w + 31) >> 5; // 32 bit words per glyph row
+      uint32_t row[8];
+      uint8_t  start, len;
+
+      // GFXFF rendering speed up, each glyph row is unpacked then drawn as runs of pixels
+      gfx_bits_t bits;
+      const uint32_t *rows = gfxGlyphRows(glyph, c, &bits);
+
+      for (int32_t yy = 0; yy < h; yy++) {
+        const uint32_t *r = row;
+        if (rows) r = rows + yy * wpr;
+        else gfxRowBits(&bits, w, row);
+
+        for (int32_t k = 0; k < wpr; k++) {
+          uint32_t mask = r[k];
+          while (gfxNextSpan(&mask, &start, &len)) {
+            int32_t xx = (k << 5) + start;
+            if(size == 1) drawFastHLine(x + xo + xx, y + yo + yy, len, color);
+            else fillRect(x + (xo + xx) * size, y + (yo + yy) * size, len * size, size, color);
           }
-          bit >>= 1;
-        }
-        // Draw pixels for this line as we are about to increment yy
-        if (hpc) {
-          if(size == 1) drawFastHLine(x+xo+xx-hpc, y+yo+yy, hpc, color);
-          else fillRect(x+(xo16+xx-hpc)*size, y+(yo16+yy)*size, size*hpc, size, color);
-          hpc=0;
         }
       }
 
@@ -3283,6 +3270,123 @@ void TFT_eSPI::drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32
 }
 
 
+#ifdef LOAD_GFXFF
+/***************************************************************************************
+** Function name:           gfxGlyphRows
+** Description:             Start reading a free font glyph, return rows if cached
+***************************************************************************************/
+// If GFXFF_GLYPH_CACHE is defined as a number of glyphs then the most recently used
+// glyphs are kept unpacked and the least recently used is replaced on a miss. The
+// cache belongs to this instance, the rows returned stay valid until its next call.
+const uint32_t* TFT_eSPI::gfxGlyphRows(GFXglyph *glyph, uint16_t index, gfx_bits_t *bits)
+{
+  uint8_t  w  = pgm_read_byte(&glyph->width),
+           h  = pgm_read_byte(&glyph->height);
+  uint8_t *bitmap = (uint8_t *)pgm_read_dword(&gfxFont->bitmap);
+
+  bits->ptr   = bitmap + pgm_read_word(&glyph->bitmapOffset);
+  bits->bytes = (w * h + 7) >> 3;
+  bits->acc   = 0;
+  bits->count = 0;
+
+#ifdef GFXFF_GLYPH_CACHE
+  gfx_cache_t *lru = gfxCache;
+  gfxCacheClock++;
+
+  for (uint8_t i = 0; i < GFXFF_GLYPH_CACHE; i++) {
+    gfx_cache_t *e = gfxCache + i;
+    if (e->rows && e->font == gfxFont && e->index == index) {
+      e->used = gfxCacheClock;
+      return e->rows;
+    }
+    if (e->used < lru->used) lru = e;
+  }
+
+  uint8_t wpr = (w + 31) >> 5;
+  free(lru->rows);
+  lru->rows = (uint32_t*)malloc(h * wpr * sizeof(uint32_t));
+  if (!lru->rows) {
+    lru->used = 0;
+    return nullptr;
+  }
+
+  for (int32_t yy = 0; yy < h; yy++) gfxRowBits(bits, w, lru->rows + yy * wpr);
+
+  lru->font  = gfxFont;
+  lru->index = index;
+  lru->used  = gfxCacheClock;
+
+  return lru->rows;
+#else
+  (void)index;
+  return nullptr;
+#endif
+}
+
+
+#ifdef GFXFF_GLYPH_CACHE
+/***************************************************************************************
+** Function name:           gfxCacheFree
+** Description:             Free the unpacked rows of the cached glyphs
+***************************************************************************************/
+void TFT_eSPI::gfxCacheFree(void)
+{
+  for (uint8_t i = 0; i < GFXFF_GLYPH_CACHE; i++) {
+    free(gfxCache[i].rows);
+    gfxCache[i].rows = nullptr;
+    gfxCache[i].used = 0;
+  }
+}
+#endif
+
+
+/***************************************************************************************
+** Function name:           gfxRowBits
+** Description:             Unpack the next free font glyph row to 32 bit words
+***************************************************************************************/
+void TFT_eSPI::gfxRowBits(gfx_bits_t *bits, uint8_t w, uint32_t *row)
+{
+  while (w) {
+    uint8_t n = (w > 32) ? 32 : w;
+
+    // Read ahead whole bytes, glyph rows are not byte aligned
+    while (bits->count <= 56 && bits->bytes) {
+      bits->acc |= (uint64_t)pgm_read_byte(bits->ptr++) << (56 - bits->count);
+      bits->count += 8;
+      bits->bytes--;
+    }
+
+    uint32_t keep = (n == 32) ? 0xFFFFFFFF : ~(0xFFFFFFFF >> n);
+    *row++ = (uint32_t)(bits->acc >> 32) & keep;
+    bits->acc  <<= n;
+    bits->count -= n;
+    w -= n;
+  }
+}
+
+
+/***************************************************************************************
+** Function name:           gfxNextSpan
+** Description:             Find and clear the first run of set bits in a row word
+***************************************************************************************/
+bool TFT_eSPI::gfxNextSpan(uint32_t *mask, uint8_t *start, uint8_t *len)
+{
+  uint32_t m = *mask;
+  if (!m) return false;
+
+  uint8_t  s = __builtin_clz(m);
+  uint32_t t = ~(m << s);         // Run of ones is now the leading zeros
+  uint8_t  n = t ? __builtin_clz(t) : 32;
+
+  *start = s;
+  *len   = n;
+  *mask  = (s + n >= 32) ? 0 : m & (0xFFFFFFFF >> (s + n));
+
+  return true;
+}
+#endif
+
+
 /***************************************************************************************
 ** Function name:           setAddrWindow
 ** Description:             define an area to receive a stream of pixels
@@ -3978,50 +4082,16 @@ inline uint8_t TFT_eSPI::sqrt_fraction(uint32_t num) {
 }
 
 /***************************************************************************************
-** Function name:           drawArc
-** Description:             Draw an arc clockwise from 6 o'clock position
+** Function name:           arcSlopes
+** Description:             Fill in the arc start and end slope tables for drawArc
 ***************************************************************************************/
-// Centre at x,y
-// r = arc outer radius, ir = arc inner radius. Inclusive, so arc thickness = r-ir+1
-// Angles MUST be in range 0-360, end angle MUST be greater than start angle
-// Arc foreground fg_color anti-aliased with background colour along sides
-// smooth is optional, default is true, smooth=false means no antialiasing
-// Note: Arc ends are not anti-aliased (use drawSmoothArc instead for that)
-void TFT_eSPI::drawArc(int32_t x, int32_t y, int32_t r, int32_t ir,
-                       int32_t startAngle, int32_t endAngle,
-                       uint32_t fg_color, uint32_t bg_color,
-                       bool smooth)
+// The tables hold the U16.16 slope limits for each quadrant (see drawArc), a pixel with
+// slope dy/dx is in the arc if it is between the start and end slope of the quadrant.
+void TFT_eSPI::arcSlopes(int32_t startAngle, int32_t endAngle, uint32_t *startSlope, uint32_t *endSlope)
 {
-  if (_vpOoB) return;
-  if (r < ir) transpose(r, ir);  // Required that r > ir
-  if (r <= 0 || ir < 0) return;  // Invalid r, ir can be zero (circle sector)
-  if (endAngle < startAngle) transpose(startAngle, endAngle);
-  if (startAngle < 0) startAngle = 0;
-  if (endAngle > 360) endAngle = 360;
-
-  inTransaction = true;
-
-  int32_t xs = 0;       // x start position for quadrant scan
-  uint8_t alpha = 0;    // alpha value for blending pixels
-
-  int32_t r2 = r * r;   // Outer arc radius^2
-  if (smooth) r++;      // Outer AA zone radius
-  int32_t r1 = r * r;   // Outer AA radius^2
-  int16_t w  = r - ir;  // Width of arc (r - ir + 1)
-  int32_t r3 = ir * ir; // Inner arc radius^2
-  if (smooth) ir--;     // Inner AA zone radius
-  int32_t r4 = ir * ir; // Inner AA radius^2
-
-  // Float variants of adjusted inner and outer arc radii
-  //float irf = ir;
-  //float rf  = r;
-
-  //     1 | 2
-  //    ---¦---    Arc quadrant index
-  //     0 | 3
-  // Fixed point U16.16 slope table for arc start/end in each quadrant
-  uint32_t startSlope[4] = {0,  0, 0xFFFFFFFF, 0};
-  uint32_t   endSlope[4] = {0, 0xFFFFFFFF,  0, 0};
+  // Start with quadrant 0 and 1 slopes that include the whole quadrant
+  startSlope[0] = 0; startSlope[1] = 0;          startSlope[2] = 0xFFFFFFFF; startSlope[3] = 0;
+    endSlope[0] = 0;   endSlope[1] = 0xFFFFFFFF;   endSlope[2] = 0;            endSlope[3] = 0;
 
   // Ensure maximum U16.16 slope of arc ends is ~ 0x8000 0000
   constexpr float minDivisor = 1.0f/0x8000;
@@ -4073,6 +4143,53 @@ void TFT_eSPI::drawArc(int32_t x, int32_t y, int32_t r, int32_t ir,
   else {
     endSlope[3] =  slope;
   }
+}
+
+/***************************************************************************************
+** Function name:           drawArc
+** Description:             Draw an arc clockwise from 6 o'clock position
+***************************************************************************************/
+// Centre at x,y
+// r = arc outer radius, ir = arc inner radius. Inclusive, so arc thickness = r-ir+1
+// Angles MUST be in range 0-360, end angle MUST be greater than start angle
+// Arc foreground fg_color anti-aliased with background colour along sides
+// smooth is optional, default is true, smooth=false means no antialiasing
+// Note: Arc ends are not anti-aliased (use drawSmoothArc instead for that)
+void TFT_eSPI::drawArc(int32_t x, int32_t y, int32_t r, int32_t ir,
+                       int32_t startAngle, int32_t endAngle,
+                       uint32_t fg_color, uint32_t bg_color,
+                       bool smooth)
+{
+  if (_vpOoB) return;
+  if (r < ir) transpose(r, ir);  // Required that r > ir
+  if (r <= 0 || ir < 0) return;  // Invalid r, ir can be zero (circle sector)
+  if (endAngle < startAngle) transpose(startAngle, endAngle);
+  if (startAngle < 0) startAngle = 0;
+  if (endAngle > 360) endAngle = 360;
+
+  inTransaction = true;
+
+  int32_t xs = 0;       // x start position for quadrant scan
+  uint8_t alpha = 0;    // alpha value for blending pixels
+
+  int32_t r2 = r * r;   // Outer arc radius^2
+  if (smooth) r++;      // Outer AA zone radius
+  int32_t r1 = r * r;   // Outer AA radius^2
+  int16_t w  = r - ir;  // Width of arc (r - ir + 1)
+  int32_t r3 = ir * ir; // Inner arc radius^2
+  if (smooth) ir--;     // Inner AA zone radius
+  int32_t r4 = ir * ir; // Inner AA radius^2
+
+  // Float variants of adjusted inner and outer arc radii
+  //float irf = ir;
+  //float rf  = r;
+
+  //     1 | 2
+  //    ---¦---    Arc quadrant index
+  //     0 | 3
+  // Fixed point U16.16 slope table for arc start/end in each quadrant
+  uint32_t startSlope[4], endSlope[4], slope;
+  arcSlopes(startAngle, endAngle, startSlope, endSlope);
 
   // Scan quadrant
   for (int32_t cy = r - 1; cy > 0; cy--)
@@ -4445,6 +4562,30 @@ void TFT_eSPI::drawWedgeLine(float ax, float ay, float bx, float by, float ar, f
   uint16_t bg = bg_color;
   float xpax, ypay, bax = bx - ax, bay = by - ay;
 
+  // Set up the fixed point line used to find the span of each row. Pixels outside the
+  // span have low alpha and are skipped, pixels in the covered span have high alpha and
+  // are plotted as a run, so only the edge pixels need the distance calculation. The
+  // margin absorbs rounding so the pixels plotted are the same as for a per pixel scan.
+  wedge_span_t w;
+  bool span = fmaxf(fmaxf(fabsf(ax), fabsf(ay)), fmaxf(fabsf(bx), fabsf(by))) < 4096.0f &&
+              ar < 1024.0f && br < 1024.0f && x0 > -4096 && x1 < 4096 && y0 > -4096 && y1 < 4096;
+  if (span) {
+    const float margin = 1.0f / 32.0f;
+    float len = sqrtf(bax * bax + bay * bay);
+    w.ax   = ax  * 65536.0f;
+    w.ay   = ay  * 65536.0f;
+    w.bx   = bax * 65536.0f;
+    w.by   = bay * 65536.0f;
+    w.ux   = bax / len * 1073741824.0f;
+    w.uy   = bay / len * 1073741824.0f;
+    w.len  = len * 65536.0f;
+    w.dr   = rdt * 65536.0f;
+    // The rdt term shifts the wedge edge by up to rdt from the edge of a line of radius ar,
+    // the inner radius is reduced for each row by the rdt term over the row span
+    w.rOut = (ar - LoAlphaTheshold + fmaxf(-rdt, 0.0f) + margin) * 65536.0f;
+    w.rIn  = (ar - HiAlphaTheshold - margin) * 65536.0f;
+  }
+
   begin_nin_write();
   inTransaction = true;
 
@@ -4453,9 +4594,19 @@ void TFT_eSPI::drawWedgeLine(float ax, float ay, float bx, float by, float ar, f
   for (int32_t yp = ys; yp <= y1; yp++) {
     bool swin = true;  // Flag to start new window area
     bool endX = false; // Flag to skip pixels
+    int32_t xl = xs, xr = x1, il = 1, ir = 0; // Row span and covered span
+    if (span && !wedgeLineRow(&w, yp, &xl, &xr, &il, &ir)) continue;
     ypay = yp - ay;
-    for (int32_t xp = xs; xp <= x1; xp++) {
+    for (int32_t xp = xl; xp <= xr; xp++) {
       if (endX) if (alpha <= LoAlphaTheshold) break;  // Skip right side
+      if (xp >= il && xp <= ir) {
+        // Fully covered, plot the run in one go
+        if (!endX) { endX = true; xs = xp; }
+        if (swin) { setWindow(xp, yp, width()-1, yp); swin = false; }
+        pushColor(fg_color, ir - xp + 1);
+        xp = ir; alpha = 1.0f;
+        continue;
+      }
       xpax = xp - ax;
       alpha = ar - wedgeLineDistance(xpax, ypay, bax, bay, rdt);
       if (alpha <= LoAlphaTheshold ) continue;
@@ -4481,9 +4632,19 @@ void TFT_eSPI::drawWedgeLine(float ax, float ay, float bx, float by, float ar, f
   for (int32_t yp = ys-1; yp >= y0; yp--) {
     bool swin = true;  // Flag to start new window area
     bool endX = false; // Flag to skip pixels
+    int32_t xl = xs, xr = x1, il = 1, ir = 0; // Row span and covered span
+    if (span && !wedgeLineRow(&w, yp, &xl, &xr, &il, &ir)) continue;
     ypay = yp - ay;
-    for (int32_t xp = xs; xp <= x1; xp++) {
+    for (int32_t xp = xl; xp <= xr; xp++) {
       if (endX) if (alpha <= LoAlphaTheshold) break;  // Skip right side of drawn line
+      if (xp >= il && xp <= ir) {
+        // Fully covered, plot the run in one go
+        if (!endX) { endX = true; xs = xp; }
+        if (swin) { setWindow(xp, yp, width()-1, yp); swin = false; }
+        pushColor(fg_color, ir - xp + 1);
+        xp = ir; alpha = 1.0f;
+        continue;
+      }
       xpax = xp - ax;
       alpha = ar - wedgeLineDistance(xpax, ypay, bax, bay, rdt);
       if (alpha <= LoAlphaTheshold ) continue;
@@ -4520,6 +4681,106 @@ inline float TFT_eSPI::wedgeLineDistance(float xpax, float ypay, float bax, floa
 }
 
 
+/***************************************************************************************
+** Function name:           wedgeLineRow - private helper function for drawWedgeLine
+** Description:             find the pixel span of row yp that may be drawn (xl to xr)
+**                          and the span that is fully covered (il to ir)
+***************************************************************************************/
+// The spans are clipped to the xl, xr passed in, returns false if the row is not drawn
+bool TFT_eSPI::wedgeLineRow(const wedge_span_t *w, int32_t yp, int32_t *xl, int32_t *xr, int32_t *il, int32_t *ir)
+{
+  int32_t py = (yp << 16) - w->ay;
+  int32_t l, r;
+
+  if (!wedgeLineSpan(w, py, w->rOut, &l, &r)) return false;
+
+  // Find the largest rdt term for the span from the distance along the line (h) at the ends
+  int32_t rIn = w->rIn;
+  if (w->dr != 0) {
+    int64_t hl = ((int64_t)l * w->ux + (int64_t)py * w->uy) / ((int64_t)w->len << 14);
+    int64_t hr = ((int64_t)r * w->ux + (int64_t)py * w->uy) / ((int64_t)w->len << 14);
+    int64_t h  = (w->dr > 0) == (hl > hr) ? hl : hr;
+    if (h < 0) h = 0;
+    if (h > 0x10000) h = 0x10000;
+    rIn -= (int32_t)((w->dr * h) >> 16);
+  }
+
+  // Convert to pixels, rounding inwards
+  l = (int32_t)(((int64_t)l + w->ax + 0xFFFF) >> 16);
+  r = (int32_t)(((int64_t)r + w->ax) >> 16);
+  if (l > *xl) *xl = l;
+  if (r < *xr) *xr = r;
+  if (*xl > *xr) return false;
+
+  if (rIn > 0 && wedgeLineSpan(w, py, rIn, &l, &r)) {
+    *il = (int32_t)(((int64_t)l + w->ax + 0xFFFF) >> 16);
+    *ir = (int32_t)(((int64_t)r + w->ax) >> 16);
+    if (*ir > *xr) *ir = *xr;
+  }
+
+  return true;
+}
+
+
+/***************************************************************************************
+** Function name:           wedgeLineSpan - private helper function for drawWedgeLine
+** Description:             find the x range (relative to line start) of points at a
+**                          distance less than r from the line, y = py relative to start
+***************************************************************************************/
+// Values are Q16.16 fixed point, returns false if the row does not cross the line.
+// The range is the union of the two end cap discs and the band along the line sides.
+bool TFT_eSPI::wedgeLineSpan(const wedge_span_t *w, int32_t py, int32_t r, int32_t *xl, int32_t *xr)
+{
+  int64_t l = INT64_MAX, h = INT64_MIN;
+  int64_t rr = (int64_t)r * r;
+
+  // End cap discs
+  for (int32_t i = 0; i < 2; i++) {
+    int64_t cx = i ? w->bx : 0;
+    int64_t dy = i ? py - w->by : py;
+    int64_t s2 = rr - dy * dy;
+    if (s2 <= 0) continue;
+    // Integer square root, Q32 in gives Q16 out
+    uint64_t v = s2, s = 0, b = (uint64_t)1 << ((63 - __builtin_clzll(v)) & ~1);
+    while (b) {
+      if (v >= s + b) { v -= s + b; s = (s >> 1) + b; }
+      else s >>= 1;
+      b >>= 2;
+    }
+    if (cx - (int64_t)s < l) l = cx - s;
+    if (cx + (int64_t)s > h) h = cx + s;
+  }
+
+  // Band along the sides, a*x must be between lo and hi for both the distance from the
+  // line (cross product) and the position along it (dot product). a is Q2.30 so lo and hi
+  // are Q18.46 and the division gives a Q16.16 result.
+  int64_t sl = INT64_MIN, sh = INT64_MAX;
+  for (int32_t i = 0; i < 2; i++) {
+    int64_t a  = i ? w->ux : w->uy;
+    int64_t lo = i ? -(int64_t)py * w->uy : (int64_t)py * w->ux - ((int64_t)r << 30);
+    int64_t hi = i ? ((int64_t)w->len << 30) + lo : (int64_t)py * w->ux + ((int64_t)r << 30);
+    if (a == 0) {
+      if (lo > 0 || hi < 0) { sl = 1; sh = 0; break; }
+      continue;
+    }
+    if (a < 0) { int64_t t = -lo; lo = -hi; hi = t; a = -a; }
+    if (lo / a > sl) sl = lo / a;
+    if (hi / a < sh) sh = hi / a;
+  }
+  if (sl <= sh) {
+    if (sl < l) l = sl;
+    if (sh > h) h = sh;
+  }
+
+  if (l > h) return false;
+
+  // The band is unbounded for lines near horizontal or vertical, so limit the range
+  *xl = (int32_t)(l < -0x40000000LL ? -0x40000000LL : l);
+  *xr = (int32_t)(h >  0x40000000LL ?  0x40000000LL : h);
+  return true;
+}
+
+
 /***************************************************************************************
 ** Function name:           drawFastVLine
 ** Description:             draw a vertical line
@@ -5417,6 +5678,17 @@ int16_t TFT_eSPI::drawString(const String& string, int32_t poX, int32_t poY, uin
   return drawString(buffer, poX, poY, font);
 }
 
+// Text buffer without font number, uses font set by setTextFont()
+int16_t TFT_eSPI::drawString(const TFT_eText& text, int32_t poX, int32_t poY)
+{
+  return drawString(text.c_str(), poX, poY, textfont);
+}
+// Text buffer with font number
+int16_t TFT_eSPI::drawString(const TFT_eText& text, int32_t poX, int32_t poY, uint8_t font)
+{
+  return drawString(text.c_str(), poX, poY, font);
+}
+
 // Without font number, uses font set by setTextFont()
 int16_t TFT_eSPI::drawString(const char *string, int32_t poX, int32_t poY)
 {
@@ -6062,8 +6334,22 @@ void TFT_eSPI::getSetup(setup_t &tft_settings)
 
 #include "Extensions/Button.cpp"
 
+#include "Extensions/TextBuffer.cpp"
+
 #include "Extensions/Sprite.cpp"
 
+#include "Extensions/DisplayList.cpp"
+
+#include "Extensions/BandRenderer.cpp"
+
+#include "Extensions/ArcCache.cpp"
+
+#include "Extensions/Mask.cpp"
+
+#ifdef SMOOTH_FONT
+  #include "Extensions/TextLayout.cpp"
+#endif
+
 #ifdef SMOOTH_FONT
   #include "Extensions/Smooth_font.cpp"
 #endif
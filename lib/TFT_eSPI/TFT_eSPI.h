@@ -406,8 +406,13 @@ int16_t tch_spi_freq;// Touch controller read/write SPI frequency
 // Callback prototype for smooth font pixel colour read
 typedef uint16_t (*getColorCallback)(uint16_t x, uint16_t y);
 
+// Text formatted in a fixed size buffer, see Extensions/TextBuffer.h
+class TFT_eText;
+
 // Class functions and variables
 class TFT_eSPI : public Print { friend class TFT_eSprite; // Sprite class has access to protected members
+                                 friend class TFT_eArcCache; // Arc cache uses the smooth graphics helpers
+                                 friend class TFT_eTextLayout; // Text layout draws with the font state
 
  //--------------------------------------- public ------------------------------------//
  public:
@@ -438,6 +443,8 @@ class TFT_eSPI : public Print { friend class TFT_eSprite; // Sprite class has ac
 
                    // Push (aka write pixel) colours to the set window
   virtual void     pushColor(uint16_t color);
+                   // Push len pixels of one colour to the set window
+  virtual void     pushColor(uint16_t color, uint32_t len);  // Deprecated for TFT use, use pushBlock()
 
                    // These are non-inlined to enable override
   virtual void     begin_nin_write();
@@ -475,8 +482,7 @@ class TFT_eSPI : public Print { friend class TFT_eSprite; // Sprite class has ac
   bool     clipWindow(int32_t* xs, int32_t* ys, int32_t* xe, int32_t* ye);
 
            // Push (aka write pixel) colours to the TFT (use setAddrWindow() first)
-  void     pushColor(uint16_t color, uint32_t len),  // Deprecated, use pushBlock()
-           pushColors(uint16_t  *data, uint32_t len, bool swap = true), // With byte swap option
+  void     pushColors(uint16_t  *data, uint32_t len, bool swap = true), // With byte swap option
            pushColors(uint8_t  *data, uint32_t len); // Deprecated, use pushPixels()
 
            // Write a solid block of a single colour
@@ -626,6 +632,8 @@ class TFT_eSPI : public Print { friend class TFT_eSprite; // Sprite class has ac
            drawString(const char *string, int32_t x, int32_t y),                // Draw string using current font
            drawString(const String& string, int32_t x, int32_t y, uint8_t font),// Draw string using specified font number
            drawString(const String& string, int32_t x, int32_t y),              // Draw string using current font
+           drawString(const TFT_eText& text, int32_t x, int32_t y, uint8_t font),// Draw text buffer using specified font number
+           drawString(const TFT_eText& text, int32_t x, int32_t y),              // Draw text buffer using current font
 
            drawCentreString(const char *string, int32_t x, int32_t y, uint8_t font),  // Deprecated, use setTextDatum() and drawString()
            drawRightString(const char *string, int32_t x, int32_t y, uint8_t font),   // Deprecated, use setTextDatum() and drawString()
@@ -853,12 +861,27 @@ class TFT_eSPI : public Print { friend class TFT_eSprite; // Sprite class has ac
            // Single GPIO input/output direction control
   void     gpioMode(uint8_t gpio, uint8_t mode);
 
-           // Smooth graphics helper
-  uint8_t  sqrt_fraction(uint32_t num);
+           // Smooth graphics helpers
+  static uint8_t sqrt_fraction(uint32_t num);
+  static void    arcSlopes(int32_t startAngle, int32_t endAngle, uint32_t *startSlope, uint32_t *endSlope);
 
            // Helper function: calculate distance of a point from a finite length line between two points
   float    wedgeLineDistance(float pax, float pay, float bax, float bay, float dr);
 
+           // Wedge line in Q16.16 fixed point, used to find the pixel spans of each row
+  typedef struct {
+    int32_t ax, ay;       // Line start
+    int32_t bx, by;       // Line end relative to start
+    int32_t ux, uy;       // Unit vector a to b (Q2.30)
+    int32_t len;          // Line length
+    int32_t dr;           // Radius delta, end a minus end b
+    int32_t rOut, rIn;    // Radius outside which alpha is low, inside which alpha is high
+  } wedge_span_t;
+
+           // Helper functions: find the outer and fully covered pixel spans of a row
+  bool     wedgeLineRow(const wedge_span_t *w, int32_t yp, int32_t *xl, int32_t *xr, int32_t *il, int32_t *ir);
+  bool     wedgeLineSpan(const wedge_span_t *w, int32_t py, int32_t r, int32_t *xl, int32_t *xr);
+
            // Display variant settings
   uint8_t  tabcolor,                   // ST7735 screen protector "tab" colour (now invalid)
            colstart = 0, rowstart = 0; // Screen display area to CGRAM area coordinate offsets
@@ -934,6 +957,41 @@ class TFT_eSPI : public Print { friend class TFT_eSprite; // Sprite class has ac
 
 #ifdef LOAD_GFXFF
   GFXfont  *gfxFont;
+
+  // Free font glyph bitmap reader. Rows are unpacked to 32 bit words with the first
+  // column in the top bit so runs of pixels can be found by counting leading zeros.
+  typedef struct {
+    const uint8_t *ptr;       // Next bitmap byte
+    uint32_t bytes;           // Bitmap bytes left in the glyph
+    uint64_t acc;             // Bits read ahead, next bit at the top
+    uint8_t  count;           // Number of bits in acc
+  } gfx_bits_t;
+
+           // Start reading glyph index of the free font, returns the unpacked rows if the
+           // glyph is cached (wpr words per row) otherwise nullptr
+  const uint32_t* gfxGlyphRows(GFXglyph *glyph, uint16_t index, gfx_bits_t *bits);
+           // Unpack the next glyph row of width w into row[(w + 31) / 32]
+  static void gfxRowBits(gfx_bits_t *bits, uint8_t w, uint32_t *row);
+           // Find and clear the first run of set bits in mask, returns false if none
+  static bool gfxNextSpan(uint32_t *mask, uint8_t *start, uint8_t *len);
+
+  #ifdef GFXFF_GLYPH_CACHE
+  // Most recently used glyphs unpacked to rows. Each instance has its own cache and
+  // is not locked, so instances can draw on different tasks at the same time but
+  // one instance must not be drawn to by two tasks at once.
+  typedef struct {
+    const GFXfont *font;
+    uint16_t index;
+    uint32_t used;            // Cache clock when last used
+    uint32_t *rows;
+  } gfx_cache_t;
+
+  gfx_cache_t gfxCache[GFXFF_GLYPH_CACHE] = {};
+  uint32_t    gfxCacheClock = 0;
+
+           // Free the unpacked rows of the cached glyphs
+  void     gfxCacheFree(void);
+  #endif
 #endif
 
 /***************************************************************************************
@@ -971,7 +1029,30 @@ transpose(T& a, T& b) { T t = a; a = b; b = t; }
 // Load the Button Class
 #include "Extensions/Button.h"
 
+// Load the fixed size Text Buffer classes
+#include "Extensions/TextBuffer.h"
+
 // Load the Sprite Class
 #include "Extensions/Sprite.h"
 
+// Load the fixed geometry Canvas class template
+#include "Extensions/Canvas.h"
+
+// Load the Display List Class
+#include "Extensions/DisplayList.h"
+
+// Load the parallel band renderer for Display Lists
+#include "Extensions/BandRenderer.h"
+
+// Load the smooth Arc Cache Class
+#include "Extensions/ArcCache.h"
+
+// Load the alpha Mask Class
+#include "Extensions/Mask.h"
+
+// Load the Text Layout and cache classes
+#ifdef SMOOTH_FONT
+  #include "Extensions/TextLayout.h"
+#endif
+
 #endif // ends #ifndef _TFT_eSPIH_
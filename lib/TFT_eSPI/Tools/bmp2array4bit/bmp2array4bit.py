@@ -7,7 +7,12 @@
 
     You'll need python 3.6 (the original use Python 2.7)
 
-    usage: python fourbitbmp2array.py [-v] star.bmp [-o myfile.c]
+    usage: python fourbitbmp2array.py [-v] star.bmp [-o myfile.c] [-m bits] [-i]
+
+    With the -m option the output is an alpha mask for the TFT_eMask class
+    instead of a palette and image. Each pixel is a coverage value of 1, 2, 4
+    or 8 bits, dark pixels are opaque and light pixels are clear (use -i to
+    invert this).
     
     Create the bmp file in Gimp by :
 
@@ -41,6 +46,8 @@ parser = argparse.ArgumentParser(description="Convert bmp file to C array")
 parser.add_argument("-v", "--verbose", help="debug output", action="store_true")
 parser.add_argument("input", help="input file name")
 parser.add_argument("-o", "--output", help="output file name")
+parser.add_argument("-m", "--mask", help="output an alpha mask with this many bits per pixel", type=int, choices=[1, 2, 4, 8])
+parser.add_argument("-i", "--invert", help="light pixels are opaque in the alpha mask", action="store_true")
 args = parser.parse_args()
 
 if not os.path.exists(args.input):
@@ -153,8 +160,10 @@ debugOut("Upto: {} Number of colors used: {} definitions start at: {}".format(up
 
 #Create color definition array and init the array of color values
 colorIndex = [] #(colorsUsed[0])
+colorAlpha = [] # mask coverage of each color, 0-255
 for i in range(colorsUsed[0]):
     colorIndex.append(0)
+    colorAlpha.append(0)
 
 #Assign the colors to the array.  upto = 54
 # startOfDefinitions = upto
@@ -170,6 +179,8 @@ for i in range(colorsUsed[0]):
     # colorIndex[i] = t[0]
 
     colorIndex[i] = (((red & 0xf8)<<8) + ((green & 0xfc)<<3)+(blue>>3))
+    luminance = (red * 299 + green * 587 + blue * 114) // 1000
+    colorAlpha[i] = luminance if args.invert else 255 - luminance
     debugOut("color at index {0} is {1:04x}, (r,g,b,a) = ({2:02x}, {3:02x}, {4:02x}, {5:02x})".format(i,  colorIndex[i], red, green, blue, contents[upto+3]))
 
 #debugOut(the color definitions
@@ -178,6 +189,52 @@ for i in range(colorsUsed[0]):
 
 # perfect, except upside down.
 
+if bitsPerPixel != 4:
+    print("Expected 4 bits per pixel; found {}".format(bitsPerPixel))
+    sys.exit(1)
+
+paddedWidth = int(math.ceil(bitsPerPixel * width / 32.0) * 4)
+
+if args.mask != None:
+    # Output an alpha mask, rows are packed MS bits first and start on a byte boundary
+    maskBits = args.mask
+    maxValue = (1 << maskBits) - 1
+    stride = (width * maskBits + 7) // 8
+    maskName = os.path.splitext(os.path.basename(output))[0]
+
+    outputString = "/* This was generated using a script based on the SparkFun BMPtoArray python script" + '\n'
+    outputString += " See https://github.com/sparkfun/BMPtoArray for more info */" + '\n\n'
+    outputString += "// Alpha mask for TFT_eMask, width is " + str(width) + ", height is " + str(height)
+    outputString += ", bits per pixel is " + str(maskBits) + "\n"
+    outputString += "static const uint8_t " + maskName + "[" + str(stride * height) + "] PROGMEM = {" + '\n'
+
+    # BMP rows are stored bottom up
+    for row in range(height-1, -1, -1):
+        packed = [0] * stride
+        for x in range(width):
+            colorCode = contents[offset[0] + row*paddedWidth + x // 2]
+            colorCode = (colorCode >> 4) if (x % 2) == 0 else (colorCode & 0x0f)
+            value = (colorAlpha[colorCode] * maxValue + 127) // 255
+            bit = x * maskBits
+            packed[bit // 8] |= value << (8 - maskBits - (bit % 8))
+        for i in range(0, stride, 16):
+            outputString += "\t" + "".join("0x{:02x}, ".format(b) for b in packed[i:i+16]).rstrip() + "\n"
+
+    outputString = outputString[:-2]
+    outputString += "\n};\n"
+
+    try:
+        outfile = open(output, "w")
+        outfile.write(outputString)
+        outfile.close()
+    except:
+        print("could not write output to file {}".format(output))
+        sys.exit(1)
+
+    if not debug:
+        print("Completed; the output is in {}".format(output))
+    sys.exit(0)
+
 #Make a string to hold the output of our script
 arraySize = (len(contents) - offset[0]) 
 outputString = "/* This was generated using a script based on the SparkFun BMPtoArray python script" + '\n'
@@ -194,14 +251,9 @@ outputString += "\n};\n\n"
 outputString += "// width is " + str(width) + ", height is " + str(height) + "\n"
 outputString += "static const uint8_t myGraphic[" + str(arraySize) + "] PROGMEM = {" + '\n'
 
-if bitsPerPixel != 4:
-    print("Expected 4 bits per pixel; found {}".format(bitsPerPixel))
-    sys.exit(1)
-    
 #Start converting spots to values
 #Start at the offset and go to the end of the file
 dropLastNumber = True #(width % 4) == 2 or (width % 4) == 1
-paddedWidth = int(math.ceil(bitsPerPixel * width / 32.0) * 4)
 debugOut("array range is {} {} len(contents) is {} paddedWidth is {} width is {}".format(offset[0], fileSize[0], len(contents), paddedWidth, width))
 
 r = 0
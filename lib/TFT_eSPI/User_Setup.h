@@ -310,6 +310,10 @@
 //#define LOAD_FONT8N // Font 8. Alternative to Font 8 above, slightly narrower, so 3 digits fit a 160 pixel TFT
 #define LOAD_GFXFF  // FreeFonts. Include access to the 48 Adafruit_GFX free fonts FF1 to FF48 and custom fonts
 
+// Uncomment to keep this number of recently drawn FreeFont glyphs unpacked in RAM, which
+// saves decoding the glyph bitmaps again when the same characters are redrawn
+//#define GFXFF_GLYPH_CACHE 16
+
 // Comment out the #define below to stop the SPIFFS filing system and smooth font code being loaded
 // this will save ~20kbytes of FLASH
 #define SMOOTH_FONT
@@ -0,0 +1,74 @@
+/*
+
+  Sketch to show an animated smooth arc gauge drawn with a TFT_eArcCache.
+
+  Example for library:
+  https://github.com/Bodmer/TFT_eSPI
+
+  The arc cache holds the anti-aliased pixel coverage of an arc with
+  fixed radii, so the square root and blending calculations are only
+  done once. drawGauge() remembers the last angle drawn and only the
+  pixels between the old and new angle are drawn on each update.
+
+  The time for each update is reported on the Serial port, compared
+  with redrawing the whole arc with drawArc().
+
+*/
+
+#include <TFT_eSPI.h>       // Include the graphics library
+
+TFT_eSPI tft = TFT_eSPI();  // Declare object "tft"
+
+TFT_eArcCache gauge;        // Coverage table for the gauge arc
+
+#define RADIUS       70     // Outer radius
+#define INNER_RADIUS 55     // Inner radius
+#define START_ANGLE  30     // Gauge starts at 7 o'clock
+#define END_ANGLE   330     // and ends at 5 o'clock
+
+#define TRACK_COLOR TFT_DARKGREY
+
+int32_t value = 0;          // Value in range 0-100
+int8_t  step  = 1;
+
+void setup()
+{
+  Serial.begin(115200);
+
+  tft.init();
+  tft.setRotation(1);
+  tft.fillScreen(TFT_BLACK);
+
+  if (!gauge.createCache(RADIUS, INNER_RADIUS)) Serial.println("Not enough memory for arc cache");
+}
+
+void loop()
+{
+  int32_t x = tft.width() / 2;
+  int32_t y = tft.height() / 2;
+
+  value += step;
+  if (value >= 100 || value <= 0) step = -step;
+
+  int32_t angle = map(value, 0, 100, START_ANGLE, END_ANGLE);
+  uint16_t color = (value > 80) ? TFT_RED : TFT_GREEN;
+
+  uint32_t t = micros();
+
+  // Only the pixels that change are drawn, a colour change redraws the whole gauge
+  gauge.drawGauge(&tft, x, y, START_ANGLE, END_ANGLE, angle, color, TRACK_COLOR, TFT_BLACK);
+
+  t = micros() - t;
+
+  // For comparison, the time to draw the whole gauge with drawArc()
+  static uint32_t count = 0;
+  if (++count % 100 == 0) {
+    uint32_t tf = micros();
+    tft.drawArc(x, y, RADIUS, INNER_RADIUS, START_ANGLE, END_ANGLE, TRACK_COLOR, TFT_BLACK);
+    tft.drawArc(x, y, RADIUS, INNER_RADIUS, START_ANGLE, angle, color, TFT_BLACK);
+    tf = micros() - tf;
+    Serial.printf("Update %lu us, full redraw %lu us\n", (unsigned long)t, (unsigned long)tf);
+  }
+
+  delay(10);
+}
@@ -0,0 +1,95 @@
+/*
+
+  Sketch to compare the drawing speed of a TFT_eCanvas, a Sprite
+  whose size and colour depth are fixed at compile time, with an
+  equivalent TFT_eSprite.
+
+  Example for library:
+  https://github.com/Bodmer/TFT_eSPI
+
+  The same primitives are drawn into both and the time per call is
+  reported in microseconds on the Serial port. The rendered images
+  are identical, which the sketch also checks.
+
+  To compare code size build the sketch with USE_CANVAS set to 0
+  and then 1 and note the program size reported by the IDE.
+
+*/
+
+#define USE_CANVAS 1
+
+// Width and height of the canvas, must be known at compile time
+#define WIDTH  320
+#define HEIGHT 170
+
+#define LOOPS 2000
+
+#include <TFT_eSPI.h>                 // Include the graphics library (this includes the sprite functions)
+
+TFT_eSPI    tft = TFT_eSPI();         // Declare object "tft"
+
+TFT_eSprite spr = TFT_eSprite(&tft);  // Declare Sprite object "spr" with pointer to "tft" object
+
+#if USE_CANVAS
+TFT_eCanvas<WIDTH, HEIGHT, TFT_Rgb565> canvas = TFT_eCanvas<WIDTH, HEIGHT, TFT_Rgb565>(&tft);
+#endif
+
+// Draw the test primitives LOOPS times, print the time per call
+void runTest(const char* name, TFT_eSPI* s)
+{
+  uint32_t t = micros();
+  for (int i = 0; i < LOOPS; i++) s->drawPixel(i % WIDTH, i % HEIGHT, i);
+  float tPixel = (micros() - t) / (float)LOOPS;
+
+  t = micros();
+  for (int i = 0; i < LOOPS; i++) s->drawFastHLine(i % WIDTH - 10, i % HEIGHT, 40, i);
+  float tHLine = (micros() - t) / (float)LOOPS;
+
+  t = micros();
+  for (int i = 0; i < LOOPS; i++) s->drawFastVLine(i % WIDTH, i % HEIGHT - 10, 40, i);
+  float tVLine = (micros() - t) / (float)LOOPS;
+
+  t = micros();
+  for (int i = 0; i < LOOPS; i++) s->drawLine(0, i % HEIGHT, WIDTH - 1, HEIGHT - 1 - i % HEIGHT, i);
+  float tLine = (micros() - t) / (float)LOOPS;
+
+  t = micros();
+  for (int i = 0; i < LOOPS; i++) s->fillCircle(i % WIDTH, i % HEIGHT, 4, i);
+  float tCircle = (micros() - t) / (float)LOOPS;
+
+  t = micros();
+  for (int i = 0; i < LOOPS / 10; i++) s->fillRect(i % WIDTH - 20, i % HEIGHT - 20, 60, 40, i);
+  float tRect = (micros() - t) / (float)(LOOPS / 10);
+
+  Serial.printf("%-8s pixel %.2f  hline %.2f  vline %.2f  line %.2f  circle %.2f  rect %.2f us\n",
+                name, tPixel, tHLine, tVLine, tLine, tCircle, tRect);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+
+  tft.init();
+  tft.setRotation(1);
+
+  spr.createSprite(WIDTH, HEIGHT);
+  spr.fillSprite(TFT_BLACK);
+  runTest("Sprite", &spr);
+
+#if USE_CANVAS
+  canvas.createSprite();
+  canvas.fillSprite(TFT_BLACK);
+  runTest("Canvas", &canvas);
+
+  if (memcmp(spr.getPointer(), canvas.getPointer(), WIDTH * HEIGHT * 2) == 0) Serial.println("Images match");
+  else Serial.println("Images differ!");
+
+  canvas.pushSprite(0, 0);
+#else
+  spr.pushSprite(0, 0);
+#endif
+}
+
+void loop()
+{
+}
@@ -0,0 +1,359 @@
+#include "AllocProfiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iterator>
+#if defined(ESP32)
+#include <esp_heap_caps.h>
+#endif
+
+namespace AllocProfiler {
+namespace {
+// Open addressing with linear probing, ptr is nullptr for a free entry
+struct Block {
+  const void *ptr;
+  uint32_t size : 24;
+  uint32_t tag : 8;
+};
+
+// Nothing here allocates or has a constructor that runs after the first
+// allocation
+#ifdef ALLOC_PROFILER
+Block blocks[ALLOC_PROFILER_BLOCKS];
+#endif
+uint32_t blockCount = 0;
+uint32_t untrackedCount = 0;
+const char *tagNames[ALLOC_PROFILER_TAGS] = {"untagged"};
+AllocStats tagStats[ALLOC_PROFILER_TAGS];
+HeapStats internal;
+HeapStats psram;
+// Tag of the scope each task is in, entries with tag 0 are free. Kept by task
+// handle, thread local storage is not set up for the allocations made before
+// the scheduler starts.
+struct TaskTag {
+  const void *task;
+  uint8_t tag;
+};
+TaskTag taskTags[ALLOC_PROFILER_TASKS];
+
+// Allocations happen on any task and before the scheduler starts, so the
+// tables are guarded by a spinlock rather than a mutex
+#if defined(ESP32)
+portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+void lock_() { portENTER_CRITICAL(&lock); }
+void unlock_() { portEXIT_CRITICAL(&lock); }
+#else
+std::atomic_flag lock = ATOMIC_FLAG_INIT;
+void lock_() {
+  while (lock.test_and_set(std::memory_order_acquire)) {
+  }
+}
+void unlock_() { lock.clear(std::memory_order_release); }
+#endif
+
+const void *currentTask_() {
+#if defined(ESP32)
+  // nullptr before the scheduler starts
+  return xTaskGetCurrentTaskHandle();
+#else
+  static thread_local char task;
+  return &task;
+#endif
+}
+
+// Called with the lock held
+uint8_t tagOf_(const void *task) {
+  for (const auto &entry : taskTags) {
+    if (entry.tag != 0 && entry.task == task) {
+      return entry.tag;
+    }
+  }
+  return 0;
+}
+
+// Called with the lock held, a task that does not fit stays untagged
+void setTag_(const void *task, uint8_t tag) {
+  TaskTag *free = nullptr;
+  for (auto &entry : taskTags) {
+    if (entry.tag != 0 && entry.task == task) {
+      entry.tag = tag;
+      return;
+    }
+    if (entry.tag == 0 && free == nullptr) {
+      free = &entry;
+    }
+  }
+  if (tag != 0 && free != nullptr) {
+    *free = TaskTag{task, tag};
+  }
+}
+
+#ifdef ALLOC_PROFILER
+// Called by the allocator wrappers only
+size_t slot_(const void *ptr) {
+  return (reinterpret_cast<uintptr_t>(ptr) >> 3) * 2654435761u %
+         ALLOC_PROFILER_BLOCKS;
+}
+
+void allocated_(const void *ptr, size_t size) {
+  if (ptr == nullptr) {
+    return;
+  }
+  const void *task = currentTask_();
+  lock_();
+  uint8_t tag = tagOf_(task);
+  size_t i = slot_(ptr);
+  while (blocks[i].ptr != nullptr && blocks[i].ptr != ptr) {
+    i = (i + 1) % ALLOC_PROFILER_BLOCKS;
+  }
+  // Seen already when malloc calls a wrapped heap_caps_malloc
+  if (blocks[i].ptr == ptr) {
+    unlock_();
+    return;
+  }
+  // One entry stays free to end the probes
+  if (blockCount + 1 == ALLOC_PROFILER_BLOCKS) {
+    untrackedCount++;
+    unlock_();
+    return;
+  }
+  blocks[i] = Block{ptr, static_cast<uint32_t>(size), tag};
+  blockCount++;
+
+  AllocStats &stats = tagStats[tag];
+  stats.allocations++;
+  stats.bytes += size;
+  stats.totalBytes += size;
+  stats.peakBytes = std::max(stats.peakBytes, stats.bytes);
+  unlock_();
+}
+
+void freed_(const void *ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  lock_();
+  size_t i = slot_(ptr);
+  while (blocks[i].ptr != nullptr && blocks[i].ptr != ptr) {
+    i = (i + 1) % ALLOC_PROFILER_BLOCKS;
+  }
+  // Allocated while the table was full
+  if (blocks[i].ptr == nullptr) {
+    unlock_();
+    return;
+  }
+  AllocStats &stats = tagStats[blocks[i].tag];
+  stats.frees++;
+  stats.bytes -= blocks[i].size;
+  blockCount--;
+
+  // Move later entries of the probe sequence into the hole
+  size_t hole = i;
+  for (size_t j = (i + 1) % ALLOC_PROFILER_BLOCKS; blocks[j].ptr != nullptr;
+       j = (j + 1) % ALLOC_PROFILER_BLOCKS) {
+    size_t home = slot_(blocks[j].ptr);
+    // Entry j can move if its home is not in (hole, j]
+    bool between = hole <= j ? hole < home && home <= j
+                             : hole < home || home <= j;
+    if (!between) {
+      blocks[hole] = blocks[j];
+      hole = j;
+    }
+  }
+  blocks[hole].ptr = nullptr;
+  unlock_();
+}
+#endif
+
+// Called with the lock held
+uint8_t tagIndex_(const char *tag) {
+  uint8_t index = 0;
+  for (uint8_t i = 1; i < ALLOC_PROFILER_TAGS; i++) {
+    if (tagNames[i] == nullptr) {
+      tagNames[i] = tag;
+      index = i;
+      break;
+    }
+    if (tagNames[i] == tag || strcmp(tagNames[i], tag) == 0) {
+      index = i;
+      break;
+    }
+  }
+  return index;
+}
+
+void sampleHeap_() {
+#if defined(ESP32)
+  auto sample = [](HeapStats &heap, uint32_t caps) {
+    uint32_t freeBytes = heap_caps_get_free_size(caps);
+    uint32_t largestBlock = heap_caps_get_largest_free_block(caps);
+    lock_();
+    heap.freeBytes = freeBytes;
+    heap.largestBlock = largestBlock;
+    heap.minLargestBlock = std::min(heap.minLargestBlock, largestBlock);
+    unlock_();
+  };
+  sample(internal, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  sample(psram, MALLOC_CAP_SPIRAM);
+#endif
+}
+
+void reportHeap_(Print &out, const char *name, const HeapStats &heap) {
+  uint32_t fragmentation =
+      heap.freeBytes == 0
+          ? 0
+          : 100 - 100ULL * heap.largestBlock / heap.freeBytes;
+  out.printf("%s: %u free, %u largest block, %u%% fragmented, %u smallest "
+             "largest block\n",
+             name, heap.freeBytes, heap.largestBlock, fragmentation,
+             heap.minLargestBlock == UINT32_MAX ? 0 : heap.minLargestBlock);
+}
+} // namespace
+
+AllocStats stats(const char *tag) {
+  AllocStats stats{};
+  lock_();
+  for (uint8_t i = 0; i < ALLOC_PROFILER_TAGS && tagNames[i] != nullptr; i++) {
+    if (tagNames[i] == tag || strcmp(tagNames[i], tag) == 0) {
+      stats = tagStats[i];
+      break;
+    }
+  }
+  unlock_();
+  return stats;
+}
+
+HeapStats internalHeap() {
+  lock_();
+  HeapStats heap = internal;
+  unlock_();
+  return heap;
+}
+
+HeapStats psramHeap() {
+  lock_();
+  HeapStats heap = psram;
+  unlock_();
+  return heap;
+}
+
+uint32_t untracked() {
+  lock_();
+  uint32_t count = untrackedCount;
+  unlock_();
+  return count;
+}
+
+void report(Print &out) {
+  // Copied first, printing allocates
+  const char *names[ALLOC_PROFILER_TAGS];
+  AllocStats stats[ALLOC_PROFILER_TAGS];
+  lock_();
+  std::copy(std::begin(tagNames), std::end(tagNames), names);
+  std::copy(std::begin(tagStats), std::end(tagStats), stats);
+  uint32_t tracked = blockCount;
+  uint32_t untrackedBlocks = untrackedCount;
+  unlock_();
+
+  out.printf("%-12s %8s %8s %8s %8s %10s\n", "Tag", "Allocs", "Frees",
+             "Bytes", "Peak", "Total");
+  for (uint8_t i = 0; i < ALLOC_PROFILER_TAGS && names[i] != nullptr; i++) {
+    out.printf("%-12s %8u %8u %8u %8u %10u\n", names[i], stats[i].allocations,
+               stats[i].frees, stats[i].bytes, stats[i].peakBytes,
+               stats[i].totalBytes);
+  }
+  out.printf("%u blocks tracked, %u untracked\n", tracked,
+             untrackedBlocks);
+  sampleHeap_();
+  reportHeap_(out, "Internal", internalHeap());
+  reportHeap_(out, "PSRAM", psramHeap());
+}
+
+Scope::Scope(const char *tag) {
+  const void *task = currentTask_();
+  lock_();
+  previous_ = tagOf_(task);
+  setTag_(task, tagIndex_(tag));
+  unlock_();
+}
+
+Scope::~Scope() {
+  const void *task = currentTask_();
+  lock_();
+  setTag_(task, previous_);
+  unlock_();
+  if (previous_ == 0) {
+    sampleHeap_();
+  }
+}
+} // namespace AllocProfiler
+
+#ifdef ALLOC_PROFILER
+// Targets of -Wl,--wrap, the linker sends calls of malloc to __wrap_malloc
+// and of __real_malloc to malloc
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size) {
+  void *ptr = __real_malloc(size);
+  AllocProfiler::allocated_(ptr, size);
+  return ptr;
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  void *ptr = __real_calloc(count, size);
+  AllocProfiler::allocated_(ptr, count * size);
+  return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  void *moved = __real_realloc(ptr, size);
+  if (moved != nullptr || size == 0) {
+    AllocProfiler::freed_(ptr);
+    AllocProfiler::allocated_(moved, size);
+  }
+  return moved;
+}
+
+void __wrap_free(void *ptr) {
+  AllocProfiler::freed_(ptr);
+  __real_free(ptr);
+}
+
+#if defined(ESP32)
+void *__real_heap_caps_malloc(size_t size, uint32_t caps);
+void *__real_heap_caps_calloc(size_t count, size_t size, uint32_t caps);
+void *__real_heap_caps_realloc(void *ptr, size_t size, uint32_t caps);
+void __real_heap_caps_free(void *ptr);
+
+void *__wrap_heap_caps_malloc(size_t size, uint32_t caps) {
+  void *ptr = __real_heap_caps_malloc(size, caps);
+  AllocProfiler::allocated_(ptr, size);
+  return ptr;
+}
+
+void *__wrap_heap_caps_calloc(size_t count, size_t size, uint32_t caps) {
+  void *ptr = __real_heap_caps_calloc(count, size, caps);
+  AllocProfiler::allocated_(ptr, count * size);
+  return ptr;
+}
+
+void *__wrap_heap_caps_realloc(void *ptr, size_t size, uint32_t caps) {
+  void *moved = __real_heap_caps_realloc(ptr, size, caps);
+  if (moved != nullptr || size == 0) {
+    AllocProfiler::freed_(ptr);
+    AllocProfiler::allocated_(moved, size);
+  }
+  return moved;
+}
+
+void __wrap_heap_caps_free(void *ptr) {
+  AllocProfiler::freed_(ptr);
+  __real_heap_caps_free(ptr);
+}
+#endif
+}
+#endif
@@ -0,0 +1,67 @@
+#pragma once
+#include <Arduino.h>
+
+// Scope tags, tag 0 counts the allocations made outside a scope
+#define ALLOC_PROFILER_TAGS 16
+// Tasks that can be in a scope at the same time
+#define ALLOC_PROFILER_TASKS 16
+// Live allocations whose tag and size are kept, allocations while the table
+// is full are only counted
+#define ALLOC_PROFILER_BLOCKS 2048
+
+#define ALLOC_CONCAT_(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_(a, b)
+#ifdef ALLOC_PROFILER
+// Tags the allocations of the rest of the enclosing scope on this task, tag
+// must be a literal
+#define ALLOC_SCOPE(tag)                                                       \
+  AllocProfiler::Scope ALLOC_CONCAT(allocScope, __LINE__) { tag }
+#else
+#define ALLOC_SCOPE(tag)
+#endif
+
+struct AllocStats {
+  uint32_t allocations{0}; // Blocks allocated in the scope
+  uint32_t frees{0};       // Blocks of the scope freed, wherever
+  uint32_t bytes{0};       // Bytes allocated and not freed yet
+  uint32_t peakBytes{0};
+  uint32_t totalBytes{0};  // Bytes allocated since boot
+};
+
+struct HeapStats {
+  uint32_t freeBytes{0};
+  uint32_t largestBlock{0};           // Largest allocation that would succeed
+  uint32_t minLargestBlock{UINT32_MAX}; // Smallest largest block sampled
+};
+
+// Counts heap allocations by the scope they are made in. Built with
+// ALLOC_PROFILER and malloc, calloc, realloc, free and their heap_caps_
+// variants wrapped by the linker, which is what the alloc-profiler
+// environment in platformio.ini does; operator new, ps_malloc and sprites
+// allocate through them. Without ALLOC_PROFILER scopes compile to nothing and
+// all stats are zero.
+//
+// Frees are counted against the scope the block was allocated in, so bytes
+// that stay allocated after a frame or message show up on its tag. The free
+// and largest blocks of the internal heap and of PSRAM are sampled when an
+// outermost scope ends.
+namespace AllocProfiler {
+// Stats of a tag, zero for a tag not used yet
+AllocStats stats(const char *tag);
+HeapStats internalHeap();
+HeapStats psramHeap();
+// Allocations made while all ALLOC_PROFILER_BLOCKS were tracked
+uint32_t untracked();
+void report(Print &out);
+
+class Scope {
+public:
+  explicit Scope(const char *tag);
+  ~Scope();
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+private:
+  uint8_t previous_;
+};
+} // namespace AllocProfiler
@@ -0,0 +1,66 @@
+#include "Battery.h"
+#include <Arduino.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <esp_adc_cal.h>
+#include <esp_timer.h>
+
+#define BATTERY_PIN 4
+// The battery is measured through a divider that halves the voltage
+#define BATTERY_DIVIDER 2
+#define BATTERY_SAMPLE_US 1000000
+// Samples per burst, the median of a burst rejects spikes
+#define BATTERY_OVERSAMPLE 16
+// Weight of a new burst in the smoothed value, settles in about half a minute
+#define BATTERY_SMOOTHING 0.125f
+
+namespace Battery {
+namespace {
+esp_timer_handle_t timer;
+esp_adc_cal_characteristics_t adcChars;
+// Only used on the timer task after init()
+float smoothedRaw = -1;
+std::atomic<uint32_t> voltage{0};
+std::atomic<uint32_t> chargePercent{0};
+
+uint32_t burst_() {
+  uint16_t samples[BATTERY_OVERSAMPLE];
+  for (auto &sample : samples) {
+    sample = analogRead(BATTERY_PIN);
+  }
+  auto median = samples + BATTERY_OVERSAMPLE / 2;
+  std::nth_element(samples, median, samples + BATTERY_OVERSAMPLE);
+  return *median;
+}
+
+void sample_(void *arg) {
+  uint32_t raw = burst_();
+  smoothedRaw = smoothedRaw < 0
+                    ? raw
+                    : smoothedRaw + (raw - smoothedRaw) * BATTERY_SMOOTHING;
+  uint32_t mV =
+      esp_adc_cal_raw_to_voltage(lroundf(smoothedRaw), &adcChars) *
+      BATTERY_DIVIDER;
+  voltage = mV;
+  chargePercent = getBatteryCharge(mV);
+}
+} // namespace
+
+void init() {
+  analogSetPinAttenuation(BATTERY_PIN, ADC_11db);
+  esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100,
+                           &adcChars);
+  sample_(nullptr);
+
+  esp_timer_create_args_t args = {};
+  args.callback = sample_;
+  args.name = "battery";
+  ESP_ERROR_CHECK(esp_timer_create(&args, &timer));
+  ESP_ERROR_CHECK(esp_timer_start_periodic(timer, BATTERY_SAMPLE_US));
+}
+
+uint32_t voltage_mV() { return voltage; }
+
+uint32_t charge() { return chargePercent; }
+} // namespace Battery
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+
+// Voltage and charge of the display battery, sampled in the background. The
+// ADC is characterized once, and bursts of samples are median filtered and
+// smoothed, so reading the values is only a load.
+namespace Battery {
+// Takes the first reading and starts sampling
+void init();
+// Filtered battery voltage
+uint32_t voltage_mV();
+// State of charge in percent
+uint32_t charge();
+} // namespace Battery
+
+// State of charge of a LiPo cell in percent, interpolated between the points of
+// its discharge curve
+uint32_t getBatteryCharge(uint32_t voltage);
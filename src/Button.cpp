@@ -0,0 +1,108 @@
+#include "Button.h"
+
+// Same as the OneButton defaults
+#define DEBOUNCE_MS 50
+#define CLICK_MS 400
+#define LONG_PRESS_MS 800
+
+void Button::setHandlers(callbackFunction click, callbackFunction doubleClick,
+                         callbackFunction longPressStart,
+                         callbackFunction longPressStop) {
+  click_ = click;
+  doubleClick_ = doubleClick;
+  longPressStart_ = longPressStart;
+  longPressStop_ = longPressStop;
+}
+
+void Button::begin(bool pressed, uint32_t now_ms) {
+  raw_ = stable_ = pressed;
+  rawSince_ms_ = now_ms;
+  state_ = State::Idle;
+}
+
+void Button::edge(bool pressed, uint32_t time_ms) {
+  // Levels that last less than DEBOUNCE_MS are contact bounce, so an edge
+  // restarts the wait for the level to settle
+  if (pressed != raw_) {
+    raw_ = pressed;
+    rawSince_ms_ = time_ms;
+  }
+}
+
+void Button::update(uint32_t now_ms) {
+  if (raw_ != stable_ && now_ms - rawSince_ms_ >= DEBOUNCE_MS) {
+    // Timeouts before the edge come first
+    expire_(rawSince_ms_);
+    stable_ = raw_;
+    if (stable_) {
+      pressed_(rawSince_ms_);
+    } else {
+      released_();
+    }
+  }
+  expire_(now_ms);
+}
+
+uint32_t Button::timeUntilUpdate(uint32_t now_ms) const {
+  uint32_t deadline_ms;
+  if (raw_ != stable_) {
+    deadline_ms = rawSince_ms_ + DEBOUNCE_MS;
+  } else if (state_ == State::Down) {
+    deadline_ms = pressStart_ms_ + LONG_PRESS_MS;
+  } else if (state_ == State::Up) {
+    deadline_ms = pressStart_ms_ + CLICK_MS;
+  } else {
+    return UINT32_MAX;
+  }
+  int32_t remaining = deadline_ms - now_ms;
+  return remaining > 0 ? remaining : 0;
+}
+
+void Button::pressed_(uint32_t time_ms) {
+  if (state_ == State::Up) {
+    state_ = State::DownAgain;
+  } else {
+    state_ = State::Down;
+    pressStart_ms_ = time_ms;
+  }
+}
+
+void Button::released_() {
+  switch (state_) {
+  case State::Down:
+    // Without a double click handler there is nothing to wait for
+    if (doubleClick_ == nullptr) {
+      state_ = State::Idle;
+      call_(click_);
+    } else {
+      state_ = State::Up;
+    }
+    break;
+  case State::DownAgain:
+    state_ = State::Idle;
+    call_(doubleClick_);
+    break;
+  case State::LongPress:
+    state_ = State::Idle;
+    call_(longPressStop_);
+    break;
+  default:
+    break;
+  }
+}
+
+void Button::expire_(uint32_t now_ms) {
+  if (state_ == State::Down && now_ms - pressStart_ms_ >= LONG_PRESS_MS) {
+    state_ = State::LongPress;
+    call_(longPressStart_);
+  } else if (state_ == State::Up && now_ms - pressStart_ms_ >= CLICK_MS) {
+    state_ = State::Idle;
+    call_(click_);
+  }
+}
+
+void Button::call_(callbackFunction handler) {
+  if (handler) {
+    handler();
+  }
+}
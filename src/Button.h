@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+
+typedef void (*callbackFunction)(void);
+
+// Debounce and click, double click and long press detection for a button,
+// driven by the times of the edges seen on its input. Timings follow
+// OneButton. update() calls the handlers of the events that have happened by
+// the time given, timeUntilUpdate() tells when it has to be called next
+// without an edge.
+class Button {
+public:
+  void setHandlers(callbackFunction click, callbackFunction doubleClick,
+                   callbackFunction longPressStart,
+                   callbackFunction longPressStop);
+  // Sets the level at startup, without events
+  void begin(bool pressed, uint32_t now_ms);
+  // The input changed to pressed or released at time_ms
+  void edge(bool pressed, uint32_t time_ms);
+  void update(uint32_t now_ms);
+  // Milliseconds until update() has to be called, UINT32_MAX if only an edge
+  // can cause an event
+  uint32_t timeUntilUpdate(uint32_t now_ms) const;
+
+private:
+  enum class State { Idle, Down, Up, DownAgain, LongPress };
+
+  callbackFunction click_{nullptr};
+  callbackFunction doubleClick_{nullptr};
+  callbackFunction longPressStart_{nullptr};
+  callbackFunction longPressStop_{nullptr};
+  State state_{State::Idle};
+  bool raw_{false};    // Level at the last edge
+  bool stable_{false}; // Debounced level
+  uint32_t rawSince_ms_{0};
+  uint32_t pressStart_ms_{0};
+
+  void pressed_(uint32_t time_ms);
+  void released_();
+  void expire_(uint32_t now_ms);
+  static void call_(callbackFunction handler);
+};
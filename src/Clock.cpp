@@ -0,0 +1,23 @@
+#include "Clock.h"
+#include <ctime>
+#include <esp_timer.h>
+
+// Earlier times are the clock counting from 1970 before NTP has set it
+#define WALLCLOCK_VALID_AFTER 1672531200 // 2023-01-01
+
+namespace Clock {
+uint32_t monotonic() { return esp_timer_get_time() / 1000000; }
+
+uint32_t wallclock() {
+  time_t now = time(nullptr);
+  return now < WALLCLOCK_VALID_AFTER ? 0 : now;
+}
+
+uint32_t toWallclock(uint32_t monotonic) {
+  uint32_t now = wallclock();
+  if (now == 0) {
+    return 0;
+  }
+  return now - (Clock::monotonic() - monotonic);
+}
+} // namespace Clock
@@ -0,0 +1,13 @@
+#pragma once
+#include <Arduino.h>
+
+// Sample times. The monotonic clock counts from boot and never jumps, the
+// wall clock is only valid once it has been set from NTP.
+namespace Clock {
+// Seconds since boot
+uint32_t monotonic();
+// Seconds since the epoch, 0 while the clock is not set
+uint32_t wallclock();
+// Wall clock time of an earlier monotonic time, 0 while the clock is not set
+uint32_t toWallclock(uint32_t monotonic);
+} // namespace Clock
@@ -0,0 +1,333 @@
+#include "ConnectionManager.h"
+#include <algorithm>
+#include <errno.h>
+#include <lwip/dns.h>
+#include <lwip/sockets.h>
+
+#define WIFI_CONNECT_TIMEOUT_MS 10000
+// Limits the broker DNS lookup and TCP connect, neither blocks poll()
+#define MQTT_RESOLVE_TIMEOUT_MS 5000
+#define MQTT_CONNECT_TIMEOUT_MS 5000
+// Limits how long PubSubClient waits for the broker CONNACK, the one wait that
+// blocks poll()
+#define MQTT_SOCKET_TIMEOUT_SECS 2
+
+Backoff::Backoff(uint32_t base_ms, uint32_t max_ms)
+    : base_ms_{base_ms}, max_ms_{max_ms} {}
+
+uint32_t Backoff::next() {
+  uint32_t delay_ms = max_ms_;
+  if (attempts_ < 16) {
+    delay_ms = std::min(max_ms_, base_ms_ << attempts_);
+  }
+  attempts_++;
+  return delay_ms / 2 + random(delay_ms / 2 + 1);
+}
+
+void Backoff::reset() { attempts_ = 0; }
+
+uint32_t Backoff::attempts() const { return attempts_; }
+
+/* clang-format off */
+ConnectionManager::ConnectionManager(PubSubClient &client, WiFiClient &socket,
+                                     const char *ssid, const char *password,
+                                     const char *server, uint16_t port,
+                                     const char *topic) :
+  client_{client},
+  socket_{socket},
+  ssid_{ssid},
+  password_{password},
+  server_{server},
+  port_{port},
+  topic_{topic} {}
+/* clang-format on */
+
+void ConnectionManager::begin() {
+  WiFi.onEvent(
+      [this](arduino_event_id_t event, arduino_event_info_t info) {
+        wifiUp_ = event == ARDUINO_EVENT_WIFI_STA_GOT_IP;
+      },
+      ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  WiFi.onEvent(
+      [this](arduino_event_id_t event, arduino_event_info_t info) {
+        wifiUp_ = false;
+      },
+      ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+
+  // Starts the network stack so SNTP can be configured before WiFi is up
+  WiFi.mode(WIFI_STA);
+  client_.setSocketTimeout(MQTT_SOCKET_TIMEOUT_SECS);
+  outageStart_ms_ = millis();
+}
+
+void ConnectionManager::poll() {
+  uint32_t now = millis();
+
+  pollWifi_(now);
+  pollMqtt_(now);
+}
+
+bool ConnectionManager::connected() const {
+  return mqttState_ == MqttState::Connected;
+}
+
+ConnectionManager::WifiState ConnectionManager::wifiState() const {
+  return wifiState_;
+}
+
+ConnectionManager::MqttState ConnectionManager::mqttState() const {
+  return mqttState_;
+}
+
+ConnectionMetrics ConnectionManager::metrics() const {
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  auto metrics = metrics_;
+  xSemaphoreGive(mutex_);
+  return metrics;
+}
+
+void ConnectionManager::setDisconnectHandler(std::function<void()> handler) {
+  disconnectHandler_ = handler;
+}
+
+void ConnectionManager::pollWifi_(uint32_t now) {
+  switch (wifiState_) {
+  case WifiState::Disconnected:
+    log_d("Connecting to WiFi %s", ssid_);
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(ssid_, password_);
+    wifiState_ = WifiState::Connecting;
+    stateStart_ms_ = now;
+    break;
+
+  case WifiState::Connecting:
+    if (wifiUp_) {
+      log_i("WiFi connected: %s", WiFi.localIP().toString().c_str());
+      wifiState_ = WifiState::Connected;
+      wifiBackoff_.reset();
+      xSemaphoreTake(mutex_, portMAX_DELAY);
+      metrics_.wifiConnects++;
+      xSemaphoreGive(mutex_);
+    } else if (now - stateStart_ms_ > WIFI_CONNECT_TIMEOUT_MS) {
+      WiFi.disconnect();
+      retryAt_ms_ = now + wifiBackoff_.next();
+      wifiState_ = WifiState::Backoff;
+      log_d("WiFi connect timed out, retry %u", wifiBackoff_.attempts());
+      xSemaphoreTake(mutex_, portMAX_DELAY);
+      metrics_.failedAttempts++;
+      xSemaphoreGive(mutex_);
+    }
+    break;
+
+  case WifiState::Connected:
+    if (!wifiUp_) {
+      log_d("WiFi connection lost");
+      if (mqttState_ == MqttState::Connected) {
+        connectionLost_(now);
+      }
+      closeConnect_();
+      // Otherwise the client still thinks it is connected and skips CONNECT
+      // on the next socket
+      client_.disconnect();
+      mqttState_ = MqttState::Disconnected;
+      WiFi.disconnect();
+      retryAt_ms_ = now + wifiBackoff_.next();
+      wifiState_ = WifiState::Backoff;
+    }
+    break;
+
+  case WifiState::Backoff:
+    if (static_cast<int32_t>(now - retryAt_ms_) >= 0) {
+      wifiState_ = WifiState::Disconnected;
+    }
+    break;
+  }
+}
+
+void ConnectionManager::pollMqtt_(uint32_t now) {
+  if (wifiState_ != WifiState::Connected) {
+    return;
+  }
+
+  switch (mqttState_) {
+  case MqttState::Disconnected: {
+    log_d("Resolving MQTT server %s", server_);
+    mqttStateStart_ms_ = now;
+    resolved_ = false;
+    ip_addr_t address;
+    // The callback runs on the lwIP task. One that arrives after a timeout
+    // still carries the address of the same server, so it is not discarded.
+    err_t err = dns_gethostbyname(
+        server_, &address,
+        [](const char *name, const ip_addr_t *found, void *arg) {
+          auto *self = static_cast<ConnectionManager *>(arg);
+          self->serverAddress_ = found != nullptr && IP_IS_V4(found)
+                                     ? ip4_addr_get_u32(ip_2_ip4(found))
+                                     : 0;
+          self->resolved_ = true;
+        },
+        this);
+    if (err == ERR_OK && IP_IS_V4(&address)) {
+      startConnect_(now, ip4_addr_get_u32(ip_2_ip4(&address)));
+    } else if (err == ERR_INPROGRESS) {
+      mqttState_ = MqttState::Resolving;
+    } else {
+      log_e("Could not resolve MQTT server %s, err=%d", server_, err);
+      connectFailed_(now);
+    }
+    break;
+  }
+
+  case MqttState::Resolving:
+    if (resolved_) {
+      uint32_t address = serverAddress_;
+      if (address != 0) {
+        startConnect_(now, address);
+      } else {
+        log_e("Could not resolve MQTT server %s", server_);
+        connectFailed_(now);
+      }
+    } else if (now - mqttStateStart_ms_ > MQTT_RESOLVE_TIMEOUT_MS) {
+      log_e("Resolving MQTT server %s timed out", server_);
+      connectFailed_(now);
+    }
+    break;
+
+  case MqttState::Connecting:
+    if (pollConnect_(now)) {
+      brokerConnect_(now);
+    }
+    break;
+
+  case MqttState::Connected:
+    if (client_.loop()) {
+      break;
+    }
+    log_d("MQTT connection lost, rc=%d", client_.state());
+    connectionLost_(now);
+    mqttState_ = MqttState::Disconnected;
+    break;
+
+  case MqttState::Backoff:
+    if (static_cast<int32_t>(now - retryAt_ms_) >= 0) {
+      mqttState_ = MqttState::Disconnected;
+    }
+    break;
+  }
+}
+
+void ConnectionManager::startConnect_(uint32_t now, uint32_t address) {
+  sockaddr_in server{};
+  server.sin_family = AF_INET;
+  server.sin_addr.s_addr = address;
+  server.sin_port = htons(port_);
+
+  connectFd_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (connectFd_ < 0) {
+    log_e("Could not create socket, errno=%d", errno);
+    connectFailed_(now);
+    return;
+  }
+  fcntl(connectFd_, F_SETFL, fcntl(connectFd_, F_GETFL, 0) | O_NONBLOCK);
+  if (connect(connectFd_, reinterpret_cast<sockaddr *>(&server),
+              sizeof(server)) < 0 &&
+      errno != EINPROGRESS) {
+    log_e("Could not connect to MQTT server, errno=%d", errno);
+    closeConnect_();
+    connectFailed_(now);
+    return;
+  }
+  mqttStateStart_ms_ = now;
+  mqttState_ = MqttState::Connecting;
+}
+
+// Returns true once the TCP connect completed, fails the attempt on an error
+// or timeout
+bool ConnectionManager::pollConnect_(uint32_t now) {
+  fd_set writable;
+  FD_ZERO(&writable);
+  FD_SET(connectFd_, &writable);
+  timeval timeout{0, 0};
+  int ready = select(connectFd_ + 1, nullptr, &writable, nullptr, &timeout);
+  if (ready == 0) {
+    if (now - mqttStateStart_ms_ > MQTT_CONNECT_TIMEOUT_MS) {
+      log_e("Connecting to MQTT server timed out");
+      closeConnect_();
+      connectFailed_(now);
+    }
+    return false;
+  }
+
+  int error = errno;
+  socklen_t length = sizeof(error);
+  if (ready > 0 &&
+      getsockopt(connectFd_, SOL_SOCKET, SO_ERROR, &error, &length) == 0 &&
+      error == 0) {
+    return true;
+  }
+  log_e("Could not connect to MQTT server, errno=%d", error);
+  closeConnect_();
+  connectFailed_(now);
+  return false;
+}
+
+void ConnectionManager::closeConnect_() {
+  if (connectFd_ >= 0) {
+    close(connectFd_);
+    connectFd_ = -1;
+  }
+}
+
+void ConnectionManager::brokerConnect_(uint32_t now) {
+  // PubSubClient skips its own blocking connect when the socket is connected
+  fcntl(connectFd_, F_SETFL, fcntl(connectFd_, F_GETFL, 0) & ~O_NONBLOCK);
+  socket_ = WiFiClient(connectFd_);
+  connectFd_ = -1;
+
+  // Create a random client ID
+  String clientId = "esp32client-" + String(random(0xffff), HEX);
+  uint32_t start = millis();
+  if (client_.connect(clientId.c_str()) && client_.subscribe(topic_)) {
+    log_d("MQTT connected, CONNACK in %u ms", millis() - start);
+    mqttState_ = MqttState::Connected;
+    mqttBackoff_.reset();
+
+    uint32_t outage = now - outageStart_ms_;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    metrics_.mqttConnects++;
+    metrics_.lastConnect_ms = outage;
+    if (everConnected_) {
+      metrics_.reconnects++;
+      metrics_.lastOutage_ms = outage;
+      metrics_.longestOutage_ms = std::max(metrics_.longestOutage_ms, outage);
+      metrics_.totalOutage_ms += outage;
+    }
+    xSemaphoreGive(mutex_);
+    everConnected_ = true;
+  } else {
+    log_e("Could not connect to MQTT server, rc=%d", client_.state());
+    client_.disconnect();
+    connectFailed_(now);
+  }
+}
+
+void ConnectionManager::connectFailed_(uint32_t now) {
+  retryAt_ms_ = now + mqttBackoff_.next();
+  mqttState_ = MqttState::Backoff;
+
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  metrics_.failedAttempts++;
+  xSemaphoreGive(mutex_);
+
+  if (disconnectHandler_) {
+    disconnectHandler_();
+  }
+}
+
+void ConnectionManager::connectionLost_(uint32_t now) {
+  outageStart_ms_ = now;
+
+  if (disconnectHandler_) {
+    disconnectHandler_();
+  }
+}
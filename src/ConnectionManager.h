@@ -0,0 +1,100 @@
+#pragma once
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <atomic>
+#include <functional>
+
+struct ConnectionMetrics {
+  uint32_t wifiConnects{0};    // WiFi associations that got an IP address
+  uint32_t mqttConnects{0};    // Successful broker connects
+  uint32_t reconnects{0};      // Broker connects after a lost connection
+  uint32_t failedAttempts{0};  // WiFi and broker attempts that failed
+  uint32_t lastConnect_ms{0};  // Time from starting to connect until subscribed
+  uint32_t lastOutage_ms{0};   // Duration of the last outage
+  uint32_t longestOutage_ms{0};
+  uint32_t totalOutage_ms{0};
+};
+
+// Exponential backoff with equal jitter: the n-th delay is uniformly random in
+// [d/2, d] where d = min(max, base * 2^n), so reconnecting clients spread out.
+class Backoff {
+public:
+  Backoff(uint32_t base_ms, uint32_t max_ms);
+  uint32_t next();
+  void reset();
+  uint32_t attempts() const;
+
+private:
+  uint32_t base_ms_;
+  uint32_t max_ms_;
+  uint32_t attempts_{0};
+};
+
+// Keeps the WiFi and MQTT broker connections up without blocking the caller.
+// poll() advances separate WiFi and MQTT state machines and services the MQTT
+// client, it is called from the loop task in place of reconnect()/delay().
+// The broker name is resolved and its TCP connection opened without blocking,
+// PubSubClient only sends CONNECT on the open socket, so a poll blocks for at
+// most the CONNACK wait of MQTT_SOCKET_TIMEOUT_SECS.
+class ConnectionManager {
+public:
+  enum class WifiState { Disconnected, Connecting, Connected, Backoff };
+  enum class MqttState {
+    Disconnected,
+    Resolving,
+    Connecting,
+    Connected,
+    Backoff
+  };
+
+  // The client must have been created on socket
+  ConnectionManager(PubSubClient &client, WiFiClient &socket, const char *ssid,
+                    const char *password, const char *server, uint16_t port,
+                    const char *topic);
+  void begin();
+  void poll();
+  bool connected() const;
+  WifiState wifiState() const;
+  MqttState mqttState() const;
+  ConnectionMetrics metrics() const;
+  // Called on the loop task when the broker connection is lost or fails
+  void setDisconnectHandler(std::function<void()> handler);
+
+private:
+  PubSubClient &client_;
+  WiFiClient &socket_;
+  const char *ssid_;
+  const char *password_;
+  const char *server_;
+  uint16_t port_;
+  const char *topic_;
+  WifiState wifiState_{WifiState::Disconnected};
+  MqttState mqttState_{MqttState::Disconnected};
+  Backoff wifiBackoff_{1000, 60000};
+  Backoff mqttBackoff_{500, 30000};
+  uint32_t stateStart_ms_{0};
+  uint32_t retryAt_ms_{0};
+  uint32_t outageStart_ms_{0};
+  uint32_t mqttStateStart_ms_{0};
+  // Socket of the TCP connect in progress, or -1
+  int connectFd_{-1};
+  bool everConnected_{false};
+  // Set from the WiFi event task
+  std::atomic<bool> wifiUp_{false};
+  // Set from the lwIP task by the DNS callback, the address is 0 on failure
+  std::atomic<bool> resolved_{false};
+  std::atomic<uint32_t> serverAddress_{0};
+  ConnectionMetrics metrics_;
+  SemaphoreHandle_t mutex_{xSemaphoreCreateMutex()};
+  std::function<void()> disconnectHandler_;
+
+  void pollWifi_(uint32_t now);
+  void pollMqtt_(uint32_t now);
+  void startConnect_(uint32_t now, uint32_t address);
+  bool pollConnect_(uint32_t now);
+  void closeConnect_();
+  void brokerConnect_(uint32_t now);
+  void connectFailed_(uint32_t now);
+  void connectionLost_(uint32_t now);
+};
@@ -1,25 +1,66 @@
 #include "Controller.h"
+#include "hal/gpio_ll.h"
 #include "pin_config.h"
+#include <algorithm>
 
-Controller::Controller()
-    : io14_button_{OneButton(IO14_BUTTON_PIN)}, boot_button_{OneButton(
-                                                    BOOT_BUTTON_PIN)} {};
+// Edges queued while the task is busy, bounce on a press is a few edges
+#define BUTTON_EDGE_QUEUE_LENGTH 32
+
+/* clang-format off */
+Controller::Controller() :
+  inputs_{{this, IO14_BUTTON, IO14_BUTTON_PIN},
+          {this, BOOT_BUTTON, BOOT_BUTTON_PIN}},
+  edges_{xQueueCreate(BUTTON_EDGE_QUEUE_LENGTH, sizeof(ButtonEdge))} {}
+/* clang-format on */
 
 void Controller::setHandlers(const button_handlers_t &handlers) {
-  io14_button_.attachClick(handlers.io14_handleClick);
-  io14_button_.attachDoubleClick(handlers.io14_handleDoubleClick);
-  io14_button_.attachLongPressStart(handlers.io14_handleLongPressStart);
-  io14_button_.attachLongPressStop(handlers.io14_handleLongPressStop);
-  boot_button_.attachClick(handlers.boot_handleClick);
-  boot_button_.attachDoubleClick(handlers.boot_handleDoubleClick);
-  boot_button_.attachLongPressStart(handlers.boot_handleLongPressStart);
-  boot_button_.attachLongPressStop(handlers.boot_handleLongPressStop);
+  buttons_[IO14_BUTTON].setHandlers(
+      handlers.io14_handleClick, handlers.io14_handleDoubleClick,
+      handlers.io14_handleLongPressStart, handlers.io14_handleLongPressStop);
+  buttons_[BOOT_BUTTON].setHandlers(
+      handlers.boot_handleClick, handlers.boot_handleDoubleClick,
+      handlers.boot_handleLongPressStart, handlers.boot_handleLongPressStop);
 }
 
 void Controller::controllerTask(void *param) {
+  // Buttons are active low
+  for (const auto &input : inputs_) {
+    pinMode(input.pin, INPUT_PULLUP);
+    buttons_[input.button].begin(digitalRead(input.pin) == LOW, millis());
+    attachInterruptArg(input.pin, onEdge_, const_cast<ButtonInput *>(&input),
+                       CHANGE);
+  }
+
   for (;;) {
-    io14_button_.tick();
-    boot_button_.tick();
-    taskYIELD();
+    uint32_t wait_ms = UINT32_MAX;
+    uint32_t now_ms = millis();
+    for (const auto &button : buttons_) {
+      wait_ms = std::min(wait_ms, button.timeUntilUpdate(now_ms));
+    }
+    TickType_t wait =
+        wait_ms == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait_ms);
+
+    ButtonEdge edge;
+    if (xQueueReceive(edges_, &edge, wait) == pdTRUE) {
+      // Timeouts that ended before the edge are handled first
+      buttons_[edge.button].update(edge.time_ms);
+      buttons_[edge.button].edge(edge.pressed, edge.time_ms);
+    }
+
+    now_ms = millis();
+    for (auto &button : buttons_) {
+      button.update(now_ms);
+    }
   }
-}
\ No newline at end of file
+}
+
+void IRAM_ATTR Controller::onEdge_(void *arg) {
+  auto input = static_cast<ButtonInput *>(arg);
+  ButtonEdge edge{input->button, gpio_ll_get_level(&GPIO, input->pin) == 0,
+                  millis()};
+  BaseType_t woken = pdFALSE;
+  xQueueSendFromISR(input->controller->edges_, &edge, &woken);
+  if (woken) {
+    portYIELD_FROM_ISR();
+  }
+}
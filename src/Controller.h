@@ -1,5 +1,6 @@
 #pragma once
-#include <OneButton.h>
+#include "Button.h"
+#include <Arduino.h>
 
 struct button_handlers_t {
   callbackFunction io14_handleClick;
@@ -12,6 +13,9 @@ struct button_handlers_t {
   callbackFunction boot_handleLongPressStop;
 };
 
+// Buttons are read by pin change interrupts, which queue the edges for the
+// controller task. The task sleeps until an edge arrives or until a button
+// debounce, click or long press timeout ends, instead of polling the pins.
 class Controller {
 public:
   Controller();
@@ -19,6 +23,23 @@ public:
   void controllerTask(void *param);
 
 private:
-  OneButton io14_button_;
-  OneButton boot_button_;
-};
\ No newline at end of file
+  enum { IO14_BUTTON, BOOT_BUTTON, NUM_BUTTONS };
+
+  struct ButtonEdge {
+    uint8_t button;
+    bool pressed;
+    uint32_t time_ms;
+  };
+
+  struct ButtonInput {
+    Controller *controller;
+    uint8_t button;
+    uint8_t pin;
+  };
+
+  Button buttons_[NUM_BUTTONS];
+  ButtonInput inputs_[NUM_BUTTONS];
+  QueueHandle_t edges_;
+
+  static void onEdge_(void *arg);
+};
@@ -1,6 +1,11 @@
 #include "DataModel.h"
+#include "AllocProfiler.h"
 #include "ArduinoJson.h"
+#include "Clock.h"
+#include "HistoryLog.h"
+#include "Trace.h"
 #include <algorithm>
+#include <cstring>
 #include <ctime>
 
 namespace {
@@ -10,107 +15,324 @@ void dpMinMax(ViewModel &vm, const Datapoint &dp) {
   vm.minHumidity = std::min(vm.minHumidity, dp.humidity);
   vm.maxHumidity = std::max(vm.maxHumidity, dp.humidity);
 }
+
+// Binary payloads are read straight from the payload, no copy of it is made
+bool decodeBinary(const uint8_t *payload, unsigned int length,
+                  SensorBatch &batch) {
+  if (length < SENSOR_PAYLOAD_V1_HEADER) {
+    log_e("Binary sensor message is too short");
+    return false;
+  }
+  auto &message = batch.emplace_back();
+
+  int16_t temperature;
+  uint16_t humidity, battery;
+  memcpy(&temperature, payload + 1, sizeof(temperature));
+  memcpy(&humidity, payload + 3, sizeof(humidity));
+  memcpy(&battery, payload + 5, sizeof(battery));
+
+  message.sensorTypeName =
+      String(reinterpret_cast<const char *>(payload) + SENSOR_PAYLOAD_V1_HEADER,
+             length - SENSOR_PAYLOAD_V1_HEADER);
+  message.temperature = temperature / 100.0f;
+  message.humidity = humidity / 100.0f;
+  message.battery = battery;
+  return true;
+}
+
+bool decodeBinaryBatch(const uint8_t *payload, unsigned int length,
+                       SensorBatch &batch) {
+  const uint8_t *end = payload + length;
+  const uint8_t *record = payload + 1;
+  while (record < end) {
+    if (end - record < SENSOR_PAYLOAD_BATCH_V1_RECORD ||
+        end - record <
+            SENSOR_PAYLOAD_BATCH_V1_RECORD + record[6] + record[7]) {
+      log_e("Binary sensor batch is truncated");
+      return false;
+    }
+
+    int16_t temperature;
+    uint16_t humidity, battery;
+    memcpy(&temperature, record, sizeof(temperature));
+    memcpy(&humidity, record + 2, sizeof(humidity));
+    memcpy(&battery, record + 4, sizeof(battery));
+    auto location = reinterpret_cast<const char *>(record) +
+                    SENSOR_PAYLOAD_BATCH_V1_RECORD;
+
+    auto &message = batch.emplace_back();
+    message.sensorLocation = String(location, record[6]);
+    message.sensorTypeName = String(location + record[6], record[7]);
+    message.temperature = temperature / 100.0f;
+    message.humidity = humidity / 100.0f;
+    message.battery = battery;
+
+    record += SENSOR_PAYLOAD_BATCH_V1_RECORD + record[6] + record[7];
+  }
+  return true;
+}
+
+bool decodeJsonReading(JsonObjectConst reading, SensorMessage &message) {
+  if (!reading["sen"].is<const char *>() || !reading["temp"].is<float>() ||
+      !reading["hum"].is<float>()) {
+    log_e("Sensor message is missing fields");
+    return false;
+  }
+
+  message.sensorLocation = reading["loc"] | "";
+  message.sensorTypeName = reading["sen"].as<const char *>();
+  message.temperature = reading["temp"].as<float>();
+  message.humidity = reading["hum"].as<float>();
+  message.battery = reading["battery"].as<uint32_t>();
+  return true;
+}
+
+// Document memory for a payload: a slot for every object member and array
+// element, and the strings, which are copied and fit in the payload size
+size_t jsonCapacity(const uint8_t *payload, unsigned int length) {
+  size_t slots = 0;
+  uint32_t arrays = 0; // A bit for each nesting level, set for an array
+  bool string = false;
+  for (unsigned int i = 0; i < length; i++) {
+    uint8_t c = payload[i];
+    if (string) {
+      if (c == '\\') {
+        i++;
+      } else if (c == '"') {
+        string = false;
+      }
+      continue;
+    }
+    switch (c) {
+    case '"':
+      string = true;
+      break;
+    case '[':
+      // Counts the first element, an empty array is overestimated
+      arrays = arrays << 1 | 1;
+      slots++;
+      break;
+    case '{':
+      arrays <<= 1;
+      break;
+    case ']':
+    case '}':
+      arrays >>= 1;
+      break;
+    case ',':
+      // Members are counted at the ':'
+      slots += arrays & 1;
+      break;
+    case ':':
+      slots++;
+      break;
+    }
+  }
+  return JSON_ARRAY_SIZE(slots) + length;
+}
+
+bool decodeJson(const uint8_t *payload, unsigned int length,
+                SensorBatch &batch) {
+  TRACE_SCOPE("json parse");
+  ALLOC_SCOPE("json");
+  DynamicJsonDocument doc(jsonCapacity(payload, length));
+  auto rc = deserializeJson(doc, reinterpret_cast<const char *>(payload),
+                            length);
+  if (rc != DeserializationError::Ok) {
+    log_e("Could not parse sensor message: %s", rc.c_str());
+    return false;
+  }
+
+  if (doc.is<JsonArrayConst>()) {
+    auto readings = doc.as<JsonArrayConst>();
+    batch.reserve(readings.size());
+    for (JsonObjectConst reading : readings) {
+      if (!decodeJsonReading(reading, batch.emplace_back())) {
+        return false;
+      }
+    }
+    return true;
+  }
+  return decodeJsonReading(doc.as<JsonObjectConst>(), batch.emplace_back());
+}
 }; // namespace
 
 void DataModel::setView(IView *view) { view_ = view; }
 
-void DataModel::mqttUpdate(char *topic, byte *payloadRaw, unsigned int length) {
-  String payload((const char *)payloadRaw, length);
-  log_d("[%s] %s", topic, payload.c_str());
-
-  DynamicJsonDocument doc(1024);
-  auto rc = deserializeJson(doc, payload);
-  assert(rc == DeserializationError::Ok);
-
-  auto strSensorTypeName = doc["sen"].as<String>();
-  auto temperature = doc["temp"].as<float>();
-  auto humidity = doc["hum"].as<float>();
-  auto battery = doc["battery"].as<uint32_t>();
-
-  // Extract sensor location = last path element of topic
-  auto strTopic = String(topic);
-  auto pos = strTopic.lastIndexOf('/');
-  assert(pos != -1);
-  auto strLocation = strTopic.substring(pos + 1);
-
-  // Find the corresponding sensor stats for the incoming MQTT message
-  auto it = std::find_if(sensorStats_.begin(), sensorStats_.end(),
-                         [&](const auto &st) {
-                           return st.sensorLocation == strLocation &&
-                                  st.sensorTypeName == strSensorTypeName;
-                         });
-
-  // Either use an existing sensor stats object or append a new one
-  auto &stats =
-      it == sensorStats_.end()
-          ? sensorStats_.emplace_back(++nextId_, strSensorTypeName, strLocation)
-          : *it;
-
-  xSemaphoreTake(mutex_, portMAX_DELAY);
-
-  stats.temperature = temperature;
-  stats.humidity = humidity;
-  stats.battery = battery;
-
-  stats.samples.emplace_back(temperature, humidity);
-  // Include a previous batch of samples to compute
-  // some sort of running average.
-  if (stats.samples.size() > SAMPLES_PER_DATAPOINT * 2) {
-    stats.samples.pop_front();
-  }
-  stats.sampleCount++;
-
-  if (stats.sampleCount == SAMPLES_PER_DATAPOINT) {
-    // Compute average temperature and humidity for
-    // the last 6 samples (= last 6 minutes)
-    float temperatureTotal{};
-    float humidityTotal{};
-    for (const auto &sample : stats.samples) {
-      temperatureTotal += sample.temperature;
-      humidityTotal += sample.humidity;
+void DataModel::setHistory(HistoryLog *history) {
+  // Called before any sensor updates, so the sensors are restored unlocked
+  history->load(sensorStats_,
+                [this](SensorStats &stats, uint32_t timestamp,
+                       float temperature, float humidity, uint32_t battery) {
+                  addSample_(stats, Sample{.wallclock = timestamp,
+                                           .temperature = temperature,
+                                           .humidity = humidity,
+                                           .battery = battery});
+                });
+  history_ = history;
+
+  if (!sensorStats_.empty()) {
+    view_->update({static_cast<uint16_t>(sensorStats_[0].id)});
+  }
+}
+
+bool DataModel::decode(const uint8_t *payload, unsigned int length,
+                       SensorBatch &batch) {
+  if (length > 0 && payload[0] == SENSOR_PAYLOAD_V1) {
+    return decodeBinary(payload, length, batch);
+  }
+  if (length > 0 && payload[0] == SENSOR_PAYLOAD_BATCH_V1) {
+    return decodeBinaryBatch(payload, length, batch);
+  }
+  return decodeJson(payload, length, batch);
+}
+
+void DataModel::sensorUpdate(const TopicLevel &location,
+                             const SensorBatch &batch) {
+  TRACE_SCOPE("model update");
+  ALLOC_SCOPE("model");
+  uint32_t monotonic = Clock::monotonic();
+  uint32_t wallclock = Clock::wallclock();
+  std::vector<uint16_t> updated;
+
+  for (const auto &message : batch) {
+    size_t slot = message.sensorLocation.isEmpty()
+                      ? findSensor_(location, message.sensorTypeName)
+                      : findSensor_({message.sensorLocation.c_str(),
+                                     message.sensorLocation.length()},
+                                    message.sensorTypeName);
+    if (slot == SensorTable::capacity()) {
+      log_e("Sensor table is full, dropped reading of %s",
+            message.sensorTypeName.c_str());
+      continue;
     }
-    float temperatureAvg = temperatureTotal / stats.samples.size();
-    float humidityAvg = humidityTotal / stats.samples.size();
+    auto &stats = sensorStats_[slot];
+    Sample sample{.monotonic = monotonic,
+                  .wallclock = wallclock,
+                  .temperature = message.temperature,
+                  .humidity = message.humidity,
+                  .battery = message.battery};
 
-    log_d("average temperature: %.2f", temperatureAvg);
-    log_d("average sample humidity: %.2f", humidityAvg);
+    // Samples added to the time series are queued for the history with the
+    // mutex taken, so a snapshot of the sensor knows which ones it holds
+    auto addSample = [&](const Sample &added) {
+      addSample_(stats, added);
+      if (history_ != nullptr) {
+        history_->append(slot, added.wallclock, added.temperature,
+                         added.humidity, added.battery);
+      }
+    };
+
+    xSemaphoreTake(stats.mutex, portMAX_DELAY);
+    if (wallclock == 0) {
+      // Only the current values are shown until the clock is set, the sample
+      // is aggregated once its wall clock time is known
+      stats.temperature = sample.temperature;
+      stats.humidity = sample.humidity;
+      stats.battery = sample.battery;
+      if (stats.pending.size() < MAX_PENDING_SAMPLES) {
+        stats.pending.push_back(sample);
+      }
+    } else {
+      for (auto &pending : stats.pending) {
+        pending.wallclock = Clock::toWallclock(pending.monotonic);
+        addSample(pending);
+      }
+      stats.pending.clear();
+      addSample(sample);
+    }
+
+    log_d("location: %s, bucket samples: %u, datapoints: %u",
+          stats.sensorLocation.c_str(), stats.bucketSamples,
+          stats.datapoints.size());
+    xSemaphoreGive(stats.mutex);
+
+    if (std::find(updated.begin(), updated.end(), stats.id) == updated.end()) {
+      updated.push_back(stats.id);
+    }
+  }
+
+  view_->update(updated);
+}
+
+size_t DataModel::findSensor_(const TopicLevel &location,
+                              const String &sensorTypeName) {
+  auto matches = [&](const SensorStats &stats) {
+    return location.equals(stats.sensorLocation.c_str()) &&
+           stats.sensorTypeName == sensorTypeName;
+  };
 
-    stats.datapoints.emplace_back(temperatureAvg, humidityAvg);
-    if (stats.datapoints.size() > MAX_DATAPOINTS) {
-      stats.datapoints.pop_front();
+  size_t count = sensorStats_.size();
+  for (size_t slot = 0; slot < count; slot++) {
+    if (matches(sensorStats_[slot])) {
+      return slot;
     }
+  }
 
-    stats.sampleCount = 0;
+  // Another writer may have added the sensor since it was looked up
+  xSemaphoreTake(addMutex_, portMAX_DELAY);
+  size_t slot = count;
+  for (; slot < sensorStats_.size(); slot++) {
+    if (matches(sensorStats_[slot])) {
+      break;
+    }
   }
+  if (slot == sensorStats_.size()) {
+    slot = sensorStats_.emplace(slot + 1, sensorTypeName, location.toString());
+  }
+  xSemaphoreGive(addMutex_);
+  return slot;
+}
 
-  xSemaphoreGive(mutex_);
+void DataModel::addSample_(SensorStats &stats, const Sample &sample) {
+  stats.timestamp = sample.wallclock;
+  stats.temperature = sample.temperature;
+  stats.humidity = sample.humidity;
+  stats.battery = sample.battery;
 
-  view_->update(stats.id);
+  // A sample in a later bucket completes the datapoint of the current one,
+  // buckets without samples leave a gap in the time series. Samples from
+  // before the current bucket, after the clock was stepped back, are added
+  // to it.
+  uint32_t bucket = sample.wallclock / DATAPOINT_SECS;
+  if (stats.bucketSamples > 0 && bucket > stats.bucket) {
+    float temperatureAvg = stats.temperatureTotal / stats.bucketSamples;
+    float humidityAvg = stats.humidityTotal / stats.bucketSamples;
 
-  log_d("location: %s, samples: %u, datapoints: %u", stats.sensorLocation,
-        stats.sampleCount, stats.datapoints.size());
+    log_d("average temperature: %.2f", temperatureAvg);
+    log_d("average sample humidity: %.2f", humidityAvg);
+
+    stats.datapoints.append(stats.bucket * DATAPOINT_SECS, temperatureAvg,
+                            humidityAvg);
+    stats.bucketSamples = 0;
+    stats.temperatureTotal = 0;
+    stats.humidityTotal = 0;
+  }
+  if (stats.bucketSamples == 0) {
+    stats.bucket = bucket;
+  }
+  stats.bucketSamples++;
+  stats.temperatureTotal += sample.temperature;
+  stats.humidityTotal += sample.humidity;
 }
 
 std::vector<uint16_t> DataModel::getSensorIds() const {
   std::vector<uint16_t> sensorIds;
 
-  xSemaphoreTake(mutex_, portMAX_DELAY);
-  for (const auto &stats : sensorStats_) {
-    sensorIds.push_back(stats.id);
+  size_t count = sensorStats_.size();
+  for (size_t slot = 0; slot < count; slot++) {
+    sensorIds.push_back(sensorStats_[slot].id);
   }
-  xSemaphoreGive(mutex_);
 
   return sensorIds;
 }
 
 ViewModel DataModel::getViewModel(uint16_t sensorId) const {
-  xSemaphoreTake(mutex_, portMAX_DELAY);
-
-  auto it = std::find_if(sensorStats_.begin(), sensorStats_.end(),
-                         [=](const auto &st) { return st.id == sensorId; });
-  assert(it != sensorStats_.end());
+  TRACE_SCOPE("getViewModel");
+  assert(sensorId > 0 && sensorId <= sensorStats_.size());
+  const SensorStats &stats = sensorStats_[sensorId - 1];
 
-  const SensorStats &stats = *it;
+  xSemaphoreTake(stats.mutex, portMAX_DELAY);
 
   ViewModel vm{.sensorTypeName = stats.sensorTypeName,
                .sensorLocation = stats.sensorLocation,
@@ -123,16 +345,17 @@ ViewModel DataModel::getViewModel(uint16_t sensorId) const {
 
                .maxHumidity = stats.humidity};
 
-  for (const auto &dp : stats.samples) {
-    dpMinMax(vm, dp);
-  }
-
-  for (const auto &dp : stats.datapoints) {
-    vm.datapoints.emplace_back(dp);
-    dpMinMax(vm, dp);
+  vm.datapoints = stats.datapoints;
+  auto reader = stats.datapoints.reader();
+  Datapoint dp{0, 0};
+  while (reader.next(dp)) {
+    if (static_cast<int32_t>(stats.timestamp - dp.timestamp) <=
+        VIEW_HISTORY_SECS) {
+      dpMinMax(vm, dp);
+    }
   }
 
-  xSemaphoreGive(mutex_);
+  xSemaphoreGive(stats.mutex);
 
   return vm;
 }
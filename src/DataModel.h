@@ -1,35 +1,98 @@
 #pragma once
 #include "IView.h"
+#include "SlotTable.h"
+#include "TimeSeries.h"
+#include "TopicRouter.h"
 #include <Arduino.h>
-#include <deque>
 #include <vector>
 
-#define SAMPLES_PER_DATAPOINT 4
-#define MAX_DATAPOINTS 300
+// Datapoints average the samples received in 4 minute wall clock buckets
+#define DATAPOINT_SECS 240
+// Datapoints kept per sensor, about 8 days of history
+#define MAX_DATAPOINTS 3000
+// History shown and used for the min and max values, 20 hours
+#define VIEW_HISTORY_SECS (20 * 3600)
+// Samples of a sensor held until the wall clock is set
+#define MAX_PENDING_SAMPLES 32
+// Sensor slots, slot numbers are a byte in the history log
+#define SENSOR_TABLE_CHUNK 16
+#define SENSOR_TABLE_CHUNKS 16
 
-struct Datapoint {
+struct Sample {
+  uint32_t monotonic; // Seconds since boot when received
+  uint32_t wallclock; // Seconds since the epoch, 0 if the clock was not set
   float temperature;
   float humidity;
-  Datapoint(float temperature, float humidity)
-      : temperature{temperature}, humidity{humidity} {}
+  uint32_t battery;
 };
 
-struct SensorStats {
-  long id;
+// Sensors publish either a JSON object, {"sen":"BME280","temp":21.5,
+// "hum":48.2,"battery":3950}, or this binary payload, little endian:
+//   uint8_t  SENSOR_PAYLOAD_V1
+//   int16_t  temperature in 1/100 degree
+//   uint16_t humidity in 1/100 percent
+//   uint16_t battery in mV
+//   char     sensor type name, up to the end of the payload
+// The first byte tells them apart, JSON starts with '{' or white space.
+//
+// Gateways can batch readings of many sensors in one message, as a JSON array
+// of the objects above with the location in "loc", or in binary as
+// SENSOR_PAYLOAD_BATCH_V1 followed by records of:
+//   int16_t  temperature in 1/100 degree
+//   uint16_t humidity in 1/100 percent
+//   uint16_t battery in mV
+//   uint8_t  location length
+//   uint8_t  sensor type name length
+//   char     location, then sensor type name
+// Readings without a location are for the last level of the topic.
+#define SENSOR_PAYLOAD_V1 0x81
+#define SENSOR_PAYLOAD_V1_HEADER 7
+#define SENSOR_PAYLOAD_BATCH_V1 0x82
+#define SENSOR_PAYLOAD_BATCH_V1_RECORD 8
+
+struct SensorMessage {
+  String sensorLocation; // Empty for the location in the topic
   String sensorTypeName;
-  String sensorLocation;
-  uint32_t sampleCount;
   float temperature;
   float humidity;
   uint32_t battery;
-  std::deque<Datapoint> samples;
-  std::deque<Datapoint> datapoints;
+};
+
+// Readings of one MQTT message
+typedef std::vector<SensorMessage> SensorBatch;
+
+// The id and names are set when a sensor is added and can be read without a
+// lock, the other fields are guarded by its mutex
+struct SensorStats {
+  const long id;
+  const String sensorTypeName;
+  const String sensorLocation;
+  SemaphoreHandle_t mutex{xSemaphoreCreateMutex()};
+  float temperature;
+  float humidity;
+  uint32_t battery;
+  uint32_t timestamp{0}; // Wall clock time of the last aggregated sample
+  // Bucket being filled and the totals of its samples
+  uint32_t bucket{0};
+  uint32_t bucketSamples{0};
+  float temperatureTotal{0};
+  float humidityTotal{0};
+  TimeSeries datapoints{MAX_DATAPOINTS};
+  // Samples received before the wall clock was set
+  std::vector<Sample> pending{};
   SensorStats(long id, const String &sensorTypeName,
               const String &sensorLocation)
-      : id{id}, sensorTypeName{sensorTypeName}, sensorLocation{sensorLocation},
-        sampleCount{0} {}
+      : id{id}, sensorTypeName{sensorTypeName}, sensorLocation{sensorLocation} {
+  }
+  SensorStats(const SensorStats &) = delete;
+  SensorStats &operator=(const SensorStats &) = delete;
+  ~SensorStats() { vSemaphoreDelete(mutex); }
 };
 
+// Sensors by slot, the id of a sensor is its slot + 1
+typedef SlotTable<SensorStats, SENSOR_TABLE_CHUNK, SENSOR_TABLE_CHUNKS>
+    SensorTable;
+
 struct ViewModel {
   String sensorTypeName;
   String sensorLocation;
@@ -40,21 +103,37 @@ struct ViewModel {
   float humidity;
   float minHumidity;
   float maxHumidity;
-  std::vector<Datapoint> datapoints;
+  TimeSeries datapoints{MAX_DATAPOINTS};
 };
 
 typedef void (*displayCallback_t)(const SensorStats &sensorStats);
 
+class HistoryLog;
+
 class DataModel {
 public:
   void setView(IView *view);
-  void mqttUpdate(char *topic, byte *payloadRaw, unsigned int length);
+  // Restores the sensors saved in history and records new samples to it
+  void setHistory(HistoryLog *history);
+  // Decodes a JSON or binary sensor message or batch, returns false if it is
+  // not valid
+  static bool decode(const uint8_t *payload, unsigned int length,
+                     SensorBatch &batch);
+  // Adds the readings of a message on the topic ending with location, with one
+  // view update. Readings of different sensors can be added concurrently.
+  void sensorUpdate(const TopicLevel &location, const SensorBatch &batch);
   std::vector<uint16_t> getSensorIds() const;
   ViewModel getViewModel(uint16_t sensorId) const;
 
 private:
   IView *view_;
-  uint16_t nextId_{0};
-  std::vector<SensorStats> sensorStats_{};
-  SemaphoreHandle_t mutex_{xSemaphoreCreateMutex()};
+  HistoryLog *history_{nullptr};
+  // Sensors are found without a lock, adding one takes addMutex_
+  SensorTable sensorStats_{};
+  SemaphoreHandle_t addMutex_{xSemaphoreCreateMutex()};
+
+  // Returns the slot of the sensor, adding it if it is new, or
+  // SensorTable::capacity() if the table is full
+  size_t findSensor_(const TopicLevel &location, const String &sensorTypeName);
+  void addSample_(SensorStats &stats, const Sample &sample);
 };
\ No newline at end of file
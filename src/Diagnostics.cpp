@@ -0,0 +1,156 @@
+#include "Diagnostics.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <esp_freertos_hooks.h>
+#include <esp_timer.h>
+
+// Gaps between idle hook calls up to this long are idle time, longer ones are
+// time the core ran other tasks or interrupts
+#define IDLE_GAP_US 20
+// Idle hooks keep measuring this long after a sample
+#define IDLE_MEASURE_US 1000000
+
+namespace Diagnostics {
+namespace {
+std::atomic<uint32_t> messageCount{0};
+std::atomic<uint32_t> rejectedCount{0};
+std::atomic<uint32_t> lastParse_us{0};
+std::atomic<uint32_t> avgParse_us{0};
+
+// Written by the idle hook of each core
+struct IdleTime {
+  int64_t lastHook_us;
+  std::atomic<uint32_t> idle_us;
+};
+
+IdleTime idleTime[portNUM_PROCESSORS];
+std::atomic<int64_t> measureUntil_us{0};
+
+// Idle time and clock at the previous cores() sample
+uint32_t previousIdle_us[portNUM_PROCESSORS];
+int64_t previousSample_us = 0;
+
+// The idle task calls the hook again at once while it returns false, so the
+// calls are a few microseconds apart while the core is idle
+template <uint8_t core> bool idleHook() {
+  IdleTime &time = idleTime[core];
+  int64_t now = esp_timer_get_time();
+  int64_t gap = now - time.lastHook_us;
+  time.lastHook_us = now;
+  if (gap <= IDLE_GAP_US) {
+    time.idle_us.store(time.idle_us.load(std::memory_order_relaxed) + gap,
+                       std::memory_order_relaxed);
+  }
+  // Wait for an interrupt as usual when not measuring
+  return now > measureUntil_us.load(std::memory_order_relaxed);
+}
+
+#if configGENERATE_RUN_TIME_STATS
+struct RunTime {
+  TaskHandle_t task;
+  uint32_t counter;
+};
+
+// Run time counters of the previous sample
+std::vector<RunTime> previousTasks;
+uint32_t previousTotal = 0;
+#endif
+} // namespace
+
+void messageParsed(uint32_t parse_us) {
+  uint32_t count = messageCount.load(std::memory_order_relaxed) + 1;
+  uint32_t avg = avgParse_us.load(std::memory_order_relaxed);
+  avgParse_us.store(count == 1 ? parse_us : avg - avg / 16 + parse_us / 16,
+                    std::memory_order_relaxed);
+  lastParse_us.store(parse_us, std::memory_order_relaxed);
+  messageCount.store(count, std::memory_order_relaxed);
+}
+
+void messageRejected() {
+  rejectedCount.store(rejectedCount.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+}
+
+MessageStats messages() {
+  return MessageStats{.messages = messageCount.load(),
+                      .rejected = rejectedCount.load(),
+                      .lastParse_us = lastParse_us.load(),
+                      .avgParse_us = avgParse_us.load()};
+}
+
+MemoryStats memory() {
+  return MemoryStats{.freeHeap = ESP.getFreeHeap(),
+                     .minFreeHeap = ESP.getMinFreeHeap(),
+                     .largestBlock = ESP.getMaxAllocHeap(),
+                     .freePsram = ESP.getFreePsram()};
+}
+
+std::vector<TaskLoad> tasks() {
+  // Room for tasks started while the state is taken
+  std::vector<TaskStatus_t> status(uxTaskGetNumberOfTasks() + 4);
+  uint32_t total = 0;
+  status.resize(uxTaskGetSystemState(status.data(), status.size(), &total));
+
+  std::vector<TaskLoad> tasks;
+  tasks.reserve(status.size());
+  for (const auto &task : status) {
+    TaskLoad &load = tasks.emplace_back();
+    strlcpy(load.name, task.pcTaskName, sizeof(load.name));
+    load.stackFree = task.usStackHighWaterMark;
+    load.cpu = -1;
+  }
+
+#if configGENERATE_RUN_TIME_STATS
+  // The total is the time of one core, each core runs a task all the time
+  uint32_t elapsed = (total - previousTotal) * portNUM_PROCESSORS;
+  for (size_t i = 0; i < status.size() && elapsed > 0; i++) {
+    auto it = std::find_if(previousTasks.begin(), previousTasks.end(),
+                           [&](const RunTime &previous) {
+                             return previous.task == status[i].xHandle;
+                           });
+    uint32_t since = it == previousTasks.end() ? 0 : it->counter;
+    tasks[i].cpu =
+        static_cast<float>(status[i].ulRunTimeCounter - since) / elapsed;
+  }
+
+  previousTasks.clear();
+  for (const auto &task : status) {
+    previousTasks.push_back({task.xHandle, task.ulRunTimeCounter});
+  }
+  previousTotal = total;
+#endif
+
+  std::stable_sort(tasks.begin(), tasks.end(),
+                   [](const TaskLoad &a, const TaskLoad &b) {
+                     return a.cpu > b.cpu;
+                   });
+  return tasks;
+}
+
+std::array<float, portNUM_PROCESSORS> cores() {
+  int64_t now = esp_timer_get_time();
+  if (previousSample_us == 0) {
+    esp_register_freertos_idle_hook_for_cpu(idleHook<0>, 0);
+#if portNUM_PROCESSORS > 1
+    esp_register_freertos_idle_hook_for_cpu(idleHook<1>, 1);
+#endif
+  }
+  // Idle time is only counted while measuring, a sample after a pause of more
+  // than a second is the start of a new measurement
+  bool measured = previousSample_us != 0 &&
+                  now - previousSample_us < IDLE_MEASURE_US;
+  measureUntil_us = now + IDLE_MEASURE_US;
+
+  std::array<float, portNUM_PROCESSORS> load;
+  for (uint8_t core = 0; core < portNUM_PROCESSORS; core++) {
+    uint32_t idle = idleTime[core].idle_us.load(std::memory_order_relaxed);
+    float idleShare = static_cast<float>(idle - previousIdle_us[core]) /
+                      (now - previousSample_us);
+    load[core] = measured ? 1 - std::min(1.0f, idleShare) : -1;
+    previousIdle_us[core] = idle;
+  }
+  previousSample_us = now;
+  return load;
+}
+} // namespace Diagnostics
@@ -0,0 +1,43 @@
+#pragma once
+#include <Arduino.h>
+#include <array>
+#include <vector>
+
+struct MessageStats {
+  uint32_t messages{0};     // Messages decoded since boot
+  uint32_t rejected{0};     // Messages that did not decode, not in the timing
+  uint32_t lastParse_us{0}; // Time to decode the last message
+  uint32_t avgParse_us{0};  // Moving average over about 16 messages
+};
+
+struct MemoryStats {
+  uint32_t freeHeap{0};     // Internal RAM
+  uint32_t minFreeHeap{0};  // Least internal RAM free since boot
+  uint32_t largestBlock{0}; // Largest internal allocation that would succeed
+  uint32_t freePsram{0};
+};
+
+struct TaskLoad {
+  char name[configMAX_TASK_NAME_LEN];
+  uint32_t stackFree; // Least stack left since the task started, in bytes
+  float cpu;          // Share of all cores since the last sample, or -1 if
+                      // FreeRTOS does not keep run time stats
+};
+
+// State of the device for the diagnostics page. Recording a message costs a
+// few stores, the memory and task state is only collected when sampled, so it
+// costs nothing while the page is not shown.
+namespace Diagnostics {
+// Called on the MQTT task for each message decoded
+void messageParsed(uint32_t parse_us);
+MessageStats messages();
+MemoryStats memory();
+// Called on the MQTT task for each message that did not decode
+void messageRejected();
+// Tasks by CPU share since the previous call, called from one task
+std::vector<TaskLoad> tasks();
+// Busy share of each core since the previous call, or -1 on the first call.
+// Measured from the idle hooks, which keep the idle task spinning instead of
+// waiting for an interrupt for a second after each call.
+std::array<float, portNUM_PROCESSORS> cores();
+} // namespace Diagnostics
@@ -0,0 +1,123 @@
+#include "FrameScheduler.h"
+#include "Trace.h"
+#include <algorithm>
+#include <iterator>
+#include <esp_timer.h>
+
+namespace {
+TickType_t toTicks(int64_t us) {
+  // Round up so the task does not wake before the time has passed
+  return pdMS_TO_TICKS((us + 999) / 1000) + 1;
+}
+} // namespace
+
+/* clang-format off */
+FrameScheduler::FrameScheduler(uint32_t minFrame_ms, uint32_t tick_ms) :
+  minFrame_us_{minFrame_ms * 1000LL},
+  tick_us_{tick_ms * 1000LL} {}
+/* clang-format on */
+
+void FrameScheduler::invalidate(uint32_t reasons) {
+  int64_t none = 0;
+  firstEvent_us_.compare_exchange_strong(none, esp_timer_get_time());
+  invalidations_++;
+  pending_.fetch_or(reasons);
+  TaskHandle_t task = task_;
+  if (task != nullptr) {
+    xTaskNotifyGive(task);
+  }
+}
+
+uint32_t FrameScheduler::waitForFrame() {
+  if (task_ == nullptr) {
+    task_ = xTaskGetCurrentTaskHandle();
+    nextTick_us_ = esp_timer_get_time();
+  }
+
+  int64_t now_us = esp_timer_get_time();
+  while (pending_ == 0 && now_us < nextTick_us_) {
+    ulTaskNotifyTake(pdTRUE, toTicks(nextTick_us_ - now_us));
+    now_us = esp_timer_get_time();
+  }
+
+  // Cap the frame rate, invalidations until the frame starts are merged
+  if (now_us < frameStart_us_ + minFrame_us_) {
+    vTaskDelay(toTicks(frameStart_us_ + minFrame_us_ - now_us));
+    now_us = esp_timer_get_time();
+  }
+  frameStart_us_ = now_us;
+
+  // The notification of the taken bits is cleared, later ones wake the next
+  // wait
+  ulTaskNotifyTake(pdTRUE, 0);
+  uint32_t reasons = pending_.exchange(0);
+  frameEvent_us_ = firstEvent_us_.exchange(0);
+  uint32_t merged = invalidations_.exchange(0);
+  if (frameEvent_us_ == 0) {
+    frameEvent_us_ = now_us;
+  }
+
+  if (now_us >= nextTick_us_) {
+    reasons |= FRAME_TICK;
+    frameEvent_us_ = std::min(frameEvent_us_, nextTick_us_);
+    while (nextTick_us_ <= now_us) {
+      nextTick_us_ += tick_us_;
+    }
+  }
+
+  if (merged > 1) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    stats_.coalesced += merged - 1;
+    xSemaphoreGive(mutex_);
+  }
+  return reasons;
+}
+
+void FrameScheduler::frameDone(bool rendered) {
+  int64_t now_us = esp_timer_get_time();
+  uint32_t latency_us = now_us - frameEvent_us_;
+  uint32_t frame_us = now_us - frameStart_us_;
+
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  if (rendered) {
+    stats_.frames++;
+    stats_.lastLatency_us = latency_us;
+    stats_.maxLatency_us = std::max(stats_.maxLatency_us, latency_us);
+    stats_.avgLatency_us =
+        stats_.frames == 1
+            ? latency_us
+            : stats_.avgLatency_us - stats_.avgLatency_us / 16 +
+                  latency_us / 16;
+    stats_.avgFrame_us =
+        stats_.frames == 1
+            ? frame_us
+            : stats_.avgFrame_us - stats_.avgFrame_us / 16 + frame_us / 16;
+    frameTimes_us_[(stats_.frames - 1) % FRAME_TIME_SAMPLES] = frame_us;
+  } else {
+    stats_.skipped++;
+  }
+  xSemaphoreGive(mutex_);
+  if (rendered) {
+    Trace::counter("frame latency us", latency_us);
+  }
+
+  log_d("Frame %s, latency %u us", rendered ? "rendered" : "skipped",
+        latency_us);
+}
+
+FrameStats FrameScheduler::stats() const {
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  FrameStats stats = stats_;
+  uint32_t frameTimes_us[FRAME_TIME_SAMPLES];
+  std::copy(std::begin(frameTimes_us_), std::end(frameTimes_us_),
+            frameTimes_us);
+  xSemaphoreGive(mutex_);
+
+  size_t samples = std::min<uint32_t>(stats.frames, FRAME_TIME_SAMPLES);
+  if (samples > 0) {
+    auto p99 = frameTimes_us + (samples * 99 + 99) / 100 - 1;
+    std::nth_element(frameTimes_us, p99, frameTimes_us + samples);
+    stats.p99Frame_us = *p99;
+  }
+  return stats;
+}
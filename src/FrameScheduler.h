@@ -0,0 +1,52 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// Reason bit of the periodic frame, the other bits are free for the caller
+#define FRAME_TICK 0x80000000
+// Render times kept for the percentile
+#define FRAME_TIME_SAMPLES 128
+
+struct FrameStats {
+  uint32_t frames{0};         // Frames rendered
+  uint32_t skipped{0};        // Frames due that had nothing new to draw
+  uint32_t coalesced{0};      // Invalidations merged into a pending frame
+  uint32_t lastLatency_us{0}; // From the first invalidation to pixels shown
+  uint32_t maxLatency_us{0};
+  uint32_t avgLatency_us{0};  // Moving average over about 16 frames
+  uint32_t avgFrame_us{0};    // Render time, moving average as above
+  uint32_t p99Frame_us{0};    // Render time of the last FRAME_TIME_SAMPLES
+};
+
+// Decides when the display task renders. Any task can invalidate the screen
+// with a set of reason bits, which wakes the display task; invalidations that
+// arrive before the frame is taken are merged into it. Frames start at least
+// minFrame_ms apart, and a FRAME_TICK frame is due every tick_ms.
+class FrameScheduler {
+public:
+  FrameScheduler(uint32_t minFrame_ms, uint32_t tick_ms);
+  // Called from any task
+  void invalidate(uint32_t reasons);
+  // Called from the display task, blocks until a frame is due and returns the
+  // reasons for it
+  uint32_t waitForFrame();
+  // Ends the frame returned by waitForFrame(), rendered is false if it was
+  // skipped because nothing changed
+  void frameDone(bool rendered);
+  FrameStats stats() const;
+
+private:
+  const int64_t minFrame_us_;
+  const int64_t tick_us_;
+  std::atomic<TaskHandle_t> task_{nullptr};
+  std::atomic<uint32_t> pending_{0};
+  std::atomic<uint32_t> invalidations_{0};
+  // Time of the first invalidation of the pending frame, 0 if none
+  std::atomic<int64_t> firstEvent_us_{0};
+  int64_t nextTick_us_{0};
+  int64_t frameStart_us_{0};
+  int64_t frameEvent_us_{0};
+  FrameStats stats_;
+  uint32_t frameTimes_us_[FRAME_TIME_SAMPLES]{};
+  SemaphoreHandle_t mutex_{xSemaphoreCreateMutex()};
+};
@@ -0,0 +1,444 @@
+#include "HistoryLog.h"
+#include <LittleFS.h>
+#include <cstring>
+#include <memory>
+
+// Size at which the log is folded into a new snapshot
+#define HISTORY_LOG_MAX_BYTES (32 * 1024)
+// The log is flushed once this many samples are written or the oldest one
+// written is this old, a power loss loses at most these
+#define HISTORY_FLUSH_SAMPLES 16
+#define HISTORY_FLUSH_MS 10000
+// Samples waiting for the writer task
+#define HISTORY_QUEUE_LENGTH 64
+
+namespace {
+const char *snapshotPath = "/history.snap";
+const char *snapshotTmpPath = "/history.tmp";
+const char *logPath = "/history.log";
+
+const uint32_t snapshotMagic = 0x504e5348; // "HSNP"
+const uint32_t logMagic = 0x474f4c48;      // "HLOG"
+const uint16_t snapshotVersion = 3;
+
+enum RecordKind : uint8_t { Sensor = 1, Sample = 2 };
+
+struct SnapshotHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t sensors;
+  uint32_t sequence;
+  uint32_t length; // Body bytes following the header
+  uint32_t crc;    // CRC-32 of the body
+};
+
+struct LogHeader {
+  uint32_t magic;
+  uint32_t sequence; // Snapshot the log records follow
+};
+
+struct RecordHeader {
+  uint8_t kind;
+  uint8_t slot;   // Index of the sensor in the model
+  uint8_t length; // Payload bytes following the header
+  uint8_t crc;    // CRC-8 of the header fields and payload
+};
+
+struct SampleRecord {
+  uint32_t timestamp;
+  float temperature;
+  float humidity;
+  uint32_t battery;
+};
+
+struct QueuedSample {
+  uint32_t number;
+  uint8_t slot;
+  SampleRecord record;
+};
+
+uint32_t crc32(const uint8_t *data, size_t length) {
+  uint32_t crc = 0xffffffff;
+  while (length--) {
+    crc ^= *data++;
+    for (int i = 0; i < 8; i++) {
+      crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+uint8_t crc8(uint8_t crc, const uint8_t *data, size_t length) {
+  while (length--) {
+    crc ^= *data++;
+    for (int i = 0; i < 8; i++) {
+      crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+uint8_t recordCrc(const RecordHeader &header, const uint8_t *payload) {
+  uint8_t crc = crc8(0, &header.kind, 3);
+  return crc8(crc, payload, header.length);
+}
+
+// Reads whole files into memory so they are parsed in a single pass
+std::unique_ptr<uint8_t[]> readFile(const char *path, size_t &size) {
+  size = 0;
+  if (!LittleFS.exists(path)) {
+    return nullptr;
+  }
+  fs::File file = LittleFS.open(path, "r");
+  if (!file) {
+    return nullptr;
+  }
+  std::unique_ptr<uint8_t[]> data{new (std::nothrow) uint8_t[file.size()]};
+  if (data) {
+    size = file.read(data.get(), file.size());
+  }
+  file.close();
+  return data;
+}
+
+// Bounds checked reader over a file read into memory
+class Reader {
+public:
+  Reader(const uint8_t *data, size_t size) : data_{data}, size_{size} {}
+
+  bool read(void *value, size_t length) {
+    if (length > size_ - offset_) {
+      return false;
+    }
+    memcpy(value, data_ + offset_, length);
+    offset_ += length;
+    return true;
+  }
+
+  const uint8_t *skip(size_t length) {
+    if (length > size_ - offset_) {
+      return nullptr;
+    }
+    offset_ += length;
+    return data_ + offset_ - length;
+  }
+
+  size_t offset() const { return offset_; }
+
+private:
+  const uint8_t *data_;
+  size_t size_;
+  size_t offset_{0};
+};
+
+void appendBytes(std::vector<uint8_t> &buffer, const void *value,
+                 size_t length) {
+  auto bytes = static_cast<const uint8_t *>(value);
+  buffer.insert(buffer.end(), bytes, bytes + length);
+}
+} // namespace
+
+bool HistoryLog::begin() {
+  // Format the partition the first time it is used
+  mounted_ = LittleFS.begin(true);
+  if (!mounted_) {
+    log_e("Could not mount LittleFS, history is not saved");
+  }
+  return mounted_;
+}
+
+bool HistoryLog::load(SensorTable &sensorStats,
+                      const replayCallback_t &addSample) {
+  if (!mounted_) {
+    return false;
+  }
+  sensorStats_ = &sensorStats;
+
+  uint32_t start = millis();
+  bool restored = loadSnapshot_(sensorStats);
+  knownSlots_ = sensorStats.size();
+
+  size_t size;
+  auto data = readFile(logPath, size);
+  LogHeader header{};
+  Reader reader{data.get(), size};
+  bool logValid = reader.read(&header, sizeof(header)) &&
+                  header.magic == logMagic && header.sequence == sequence_;
+  if (logValid) {
+    // Replay the records up to the first one that is torn or corrupt
+    RecordHeader record;
+    const uint8_t *payload;
+    while (reader.read(&record, sizeof(record)) &&
+           (payload = reader.skip(record.length)) != nullptr &&
+           record.crc == recordCrc(record, payload)) {
+      if (record.kind == RecordKind::Sensor && record.slot == knownSlots_) {
+        auto names = reinterpret_cast<const char *>(payload);
+        auto typeLength = strnlen(names, record.length);
+        auto location = typeLength < record.length
+                            ? String(names + typeLength + 1,
+                                     record.length - typeLength - 1)
+                            : String();
+        sensorStats.emplace(knownSlots_ + 1, String(names, typeLength),
+                            location);
+        knownSlots_++;
+      } else if (record.kind == RecordKind::Sample &&
+                 record.slot < knownSlots_ &&
+                 record.length == sizeof(SampleRecord)) {
+        SampleRecord sample;
+        memcpy(&sample, payload, sizeof(sample));
+        addSample(sensorStats[record.slot], sample.timestamp,
+                  sample.temperature, sample.humidity, sample.battery);
+      }
+      restored = true;
+    }
+    logBytes_ = reader.offset();
+  }
+
+  if (logValid && logBytes_ == size) {
+    log_ = LittleFS.open(logPath, "a");
+  } else if (logValid) {
+    // The log ends in a torn record, fold it into a snapshot so new records
+    // are not appended after it
+    snapshot_();
+  } else {
+    startLog_();
+  }
+
+  log_i("History of %u sensors restored in %u ms", sensorStats.size(),
+        millis() - start);
+
+  queue_ = xQueueCreate(HISTORY_QUEUE_LENGTH, sizeof(QueuedSample));
+  auto rc = xTaskCreatePinnedToCore(
+      [](void *param) { static_cast<HistoryLog *>(param)->writerTask_(); },
+      "history", 6144, this, tskIDLE_PRIORITY + 1, nullptr, 0);
+  assert(rc == pdPASS);
+  return restored;
+}
+
+void HistoryLog::append(size_t slot, uint32_t timestamp, float temperature,
+                        float humidity, uint32_t battery) {
+  if (queue_ == nullptr) {
+    return;
+  }
+
+  QueuedSample sample{.number = nextSample_++,
+                      .slot = static_cast<uint8_t>(slot),
+                      .record = {timestamp, temperature, humidity, battery}};
+  if (xQueueSend(queue_, &sample, 0) != pdTRUE) {
+    log_e("History queue is full, sample not saved");
+  }
+}
+
+bool HistoryLog::snapshot_() {
+  uint32_t start = millis();
+  std::vector<uint8_t> body;
+  size_t count = sensorStats_->size();
+  snapshotMarks_.resize(count);
+  for (size_t slot = 0; slot < count; slot++) {
+    const auto &stats = (*sensorStats_)[slot];
+    xSemaphoreTake(stats.mutex, portMAX_DELAY);
+    // Samples are queued with the mutex taken, so those numbered before this
+    // are in the snapshot
+    snapshotMarks_[slot] = nextSample_;
+    uint8_t typeLength = std::min<size_t>(stats.sensorTypeName.length(), 127);
+    uint8_t locationLength =
+        std::min<size_t>(stats.sensorLocation.length(), 127);
+    std::vector<uint8_t> datapoints;
+    stats.datapoints.save(datapoints);
+    uint32_t datapointsLength = datapoints.size();
+
+    appendBytes(body, &typeLength, sizeof(typeLength));
+    appendBytes(body, &locationLength, sizeof(locationLength));
+    appendBytes(body, stats.sensorTypeName.c_str(), typeLength);
+    appendBytes(body, stats.sensorLocation.c_str(), locationLength);
+    appendBytes(body, &stats.temperature, sizeof(stats.temperature));
+    appendBytes(body, &stats.humidity, sizeof(stats.humidity));
+    appendBytes(body, &stats.battery, sizeof(stats.battery));
+    appendBytes(body, &stats.timestamp, sizeof(stats.timestamp));
+    appendBytes(body, &stats.bucket, sizeof(stats.bucket));
+    appendBytes(body, &stats.bucketSamples, sizeof(stats.bucketSamples));
+    appendBytes(body, &stats.temperatureTotal, sizeof(stats.temperatureTotal));
+    appendBytes(body, &stats.humidityTotal, sizeof(stats.humidityTotal));
+    // Datapoints are saved in their compressed form
+    appendBytes(body, &datapointsLength, sizeof(datapointsLength));
+    appendBytes(body, datapoints.data(), datapoints.size());
+    xSemaphoreGive(stats.mutex);
+  }
+
+  SnapshotHeader header{.magic = snapshotMagic,
+                        .version = snapshotVersion,
+                        .sensors = static_cast<uint16_t>(count),
+                        .sequence = sequence_ + 1,
+                        .length = static_cast<uint32_t>(body.size()),
+                        .crc = crc32(body.data(), body.size())};
+
+  // Write a new file and rename it so a complete snapshot always exists
+  fs::File file = LittleFS.open(snapshotTmpPath, "w");
+  if (!file) {
+    log_e("Could not create %s", snapshotTmpPath);
+    return false;
+  }
+  bool ok = file.write(reinterpret_cast<const uint8_t *>(&header),
+                       sizeof(header)) == sizeof(header) &&
+            file.write(body.data(), body.size()) == body.size();
+  file.close();
+  if (!ok || !LittleFS.rename(snapshotTmpPath, snapshotPath)) {
+    log_e("Could not write history snapshot");
+    LittleFS.remove(snapshotTmpPath);
+    return false;
+  }
+
+  // A log that follows an older snapshot is ignored when loading, so a reset
+  // before the new log is started loses nothing
+  sequence_++;
+  knownSlots_ = count;
+  startLog_();
+
+  log_i("History snapshot of %u bytes written in %u ms", body.size(),
+        millis() - start);
+  return true;
+}
+
+bool HistoryLog::loadSnapshot_(SensorTable &sensorStats) {
+  size_t size;
+  auto data = readFile(snapshotPath, size);
+  Reader reader{data.get(), size};
+  SnapshotHeader header;
+  if (!reader.read(&header, sizeof(header)) || header.magic != snapshotMagic ||
+      header.version != snapshotVersion) {
+    return false;
+  }
+
+  auto body = reader.skip(header.length);
+  if (body == nullptr || crc32(body, header.length) != header.crc) {
+    log_e("History snapshot is corrupt, ignored");
+    return false;
+  }
+
+  // Sequence is kept even if the sensors cannot be parsed, so the next
+  // snapshot is numbered after this one. The log that follows this snapshot
+  // still matches the sequence, but load() only replays the sensors the log
+  // describes itself, its records for the sensors of the snapshot are skipped.
+  sequence_ = header.sequence;
+
+  // Sensors are restored straight into the table, which is emptied again if
+  // the snapshot cannot be parsed
+  reader = Reader{body, header.length};
+  for (uint16_t i = 0; i < header.sensors; i++) {
+    uint8_t typeLength, locationLength;
+    uint32_t datapointsLength;
+    const uint8_t *type, *location, *datapoints;
+    if (!reader.read(&typeLength, sizeof(typeLength)) ||
+        !reader.read(&locationLength, sizeof(locationLength)) ||
+        (type = reader.skip(typeLength)) == nullptr ||
+        (location = reader.skip(locationLength)) == nullptr ||
+        sensorStats.size() == SensorTable::capacity()) {
+      sensorStats.clear();
+      return false;
+    }
+
+    auto &stats = sensorStats[sensorStats.emplace(
+        i + 1, String(reinterpret_cast<const char *>(type), typeLength),
+        String(reinterpret_cast<const char *>(location), locationLength))];
+    if (!reader.read(&stats.temperature, sizeof(stats.temperature)) ||
+        !reader.read(&stats.humidity, sizeof(stats.humidity)) ||
+        !reader.read(&stats.battery, sizeof(stats.battery)) ||
+        !reader.read(&stats.timestamp, sizeof(stats.timestamp)) ||
+        !reader.read(&stats.bucket, sizeof(stats.bucket)) ||
+        !reader.read(&stats.bucketSamples, sizeof(stats.bucketSamples)) ||
+        !reader.read(&stats.temperatureTotal,
+                     sizeof(stats.temperatureTotal)) ||
+        !reader.read(&stats.humidityTotal, sizeof(stats.humidityTotal)) ||
+        !reader.read(&datapointsLength, sizeof(datapointsLength)) ||
+        (datapoints = reader.skip(datapointsLength)) == nullptr ||
+        !stats.datapoints.restore(datapoints, datapointsLength)) {
+      sensorStats.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool HistoryLog::startLog_() {
+  log_.close();
+  log_ = LittleFS.open(logPath, "w");
+  if (!log_) {
+    log_e("Could not create %s", logPath);
+    return false;
+  }
+
+  LogHeader header{.magic = logMagic, .sequence = sequence_};
+  logBytes_ = log_.write(reinterpret_cast<const uint8_t *>(&header),
+                         sizeof(header));
+  log_.flush();
+  return logBytes_ == sizeof(header);
+}
+
+bool HistoryLog::writeRecord_(uint8_t kind, uint8_t slot, const void *data,
+                              uint8_t length) {
+  auto payload = static_cast<const uint8_t *>(data);
+  RecordHeader header{.kind = kind, .slot = slot, .length = length};
+  header.crc = recordCrc(header, payload);
+
+  size_t written =
+      log_.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+  written += log_.write(payload, length);
+  logBytes_ += written;
+  return written == sizeof(header) + length;
+}
+
+void HistoryLog::writerTask_() {
+  QueuedSample sample;
+  uint32_t unflushed = 0;
+  uint32_t unflushedSince = 0;
+
+  for (;;) {
+    TickType_t wait = portMAX_DELAY;
+    if (unflushed > 0) {
+      uint32_t age = millis() - unflushedSince;
+      wait = age < HISTORY_FLUSH_MS ? pdMS_TO_TICKS(HISTORY_FLUSH_MS - age) : 0;
+    }
+
+    bool received = xQueueReceive(queue_, &sample, wait) == pdTRUE;
+    // Samples queued before the last snapshot of their sensor are in it
+    bool inSnapshot =
+        received && sample.slot < snapshotMarks_.size() &&
+        static_cast<int32_t>(sample.number - snapshotMarks_[sample.slot]) < 0;
+    if (received && !inSnapshot && log_) {
+      // Describe sensors new to this log before their first sample
+      while (knownSlots_ <= sample.slot) {
+        const auto &stats = (*sensorStats_)[knownSlots_];
+        // Type name and location separated by a null
+        uint8_t names[UINT8_MAX];
+        size_t typeLength =
+            std::min<size_t>(stats.sensorTypeName.length(), 127);
+        size_t locationLength =
+            std::min<size_t>(stats.sensorLocation.length(), 127);
+        memcpy(names, stats.sensorTypeName.c_str(), typeLength);
+        names[typeLength] = '\0';
+        memcpy(names + typeLength + 1, stats.sensorLocation.c_str(),
+               locationLength);
+        writeRecord_(RecordKind::Sensor, knownSlots_, names,
+                     typeLength + 1 + locationLength);
+        knownSlots_++;
+      }
+
+      writeRecord_(RecordKind::Sample, sample.slot, &sample.record,
+                   sizeof(sample.record));
+      if (unflushed++ == 0) {
+        unflushedSince = millis();
+      }
+    }
+
+    if (unflushed >= HISTORY_FLUSH_SAMPLES ||
+        (unflushed > 0 && millis() - unflushedSince >= HISTORY_FLUSH_MS)) {
+      log_.flush();
+      unflushed = 0;
+    }
+
+    if (logBytes_ >= HISTORY_LOG_MAX_BYTES) {
+      snapshot_();
+      unflushed = 0;
+    }
+  }
+}
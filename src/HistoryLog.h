@@ -0,0 +1,59 @@
+#pragma once
+#include "DataModel.h"
+#include <Arduino.h>
+#include <FS.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// Replays a sample read back from the log into the sensor it was recorded for
+typedef std::function<void(SensorStats &stats, uint32_t timestamp,
+                           float temperature, float humidity, uint32_t battery)>
+    replayCallback_t;
+
+// Persists the sensor history on LittleFS so it survives a reboot.
+//
+// Every sample is appended to a log file as a small checksummed record, a
+// torn record at the end of the log after a power loss is ignored. When the
+// log grows past HISTORY_LOG_MAX_BYTES the complete history is written to a
+// snapshot file and the log is started again, so at boot one bulk read of the
+// snapshot plus a short log replay restores the history. LittleFS spreads the
+// writes over the flash partition.
+//
+// Samples are queued and written by a low priority task, which flushes the
+// log every HISTORY_FLUSH_SAMPLES samples or HISTORY_FLUSH_MS and writes the
+// snapshots, so the MQTT task never waits for the flash.
+class HistoryLog {
+public:
+  bool begin();
+  // Restores the sensors from the snapshot, then replays the samples logged
+  // after it through addSample and starts the writer task. Returns false if
+  // there is no history.
+  bool load(SensorTable &sensorStats, const replayCallback_t &addSample);
+  // Queues a sample of the sensor in slot for the writer task. Called with the
+  // mutex of the sensor taken, after the sample was added to it.
+  void append(size_t slot, uint32_t timestamp, float temperature,
+              float humidity, uint32_t battery);
+
+private:
+  bool mounted_{false};
+  // Only used by the writer task once it is started
+  const SensorTable *sensorStats_{nullptr};
+  uint32_t sequence_{0};  // Snapshot the current log follows
+  size_t knownSlots_{0};  // Sensors described in the current log
+  size_t logBytes_{0};
+  fs::File log_;
+  QueueHandle_t queue_{nullptr};
+  // Numbers the queued samples, per sensor in the order they were added
+  std::atomic<uint32_t> nextSample_{0};
+  // Sample number of each sensor when it was last snapshot, queued samples
+  // before it are in the snapshot and are not logged
+  std::vector<uint32_t> snapshotMarks_;
+
+  bool snapshot_();
+  bool loadSnapshot_(SensorTable &sensorStats);
+  bool startLog_();
+  bool writeRecord_(uint8_t kind, uint8_t slot, const void *data,
+                    uint8_t length);
+  void writerTask_();
+};
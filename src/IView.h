@@ -1,7 +1,9 @@
 #pragma once
 #include <Arduino.h>
+#include <vector>
 
 class IView {
 public:
-  virtual void update(uint16_t sensorId) = 0;
+  // Called once per MQTT message with the sensors it updated
+  virtual void update(const std::vector<uint16_t> &sensorIds) = 0;
 };
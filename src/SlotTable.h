@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+// Append only table whose slots never move, so a reference to a slot stays
+// valid while slots are added.
+//
+// Slots are allocated in chunks of ChunkSize that are never reallocated, and a
+// slot is constructed before the count is published with a release store.
+// Readers load the count with acquire and can then use every slot below it
+// without a lock, while a slot is being added. Adding slots has to be
+// serialized by the caller, the contents of a slot are synchronized by the
+// slot itself.
+template <typename T, size_t ChunkSize, size_t Chunks> class SlotTable {
+public:
+  SlotTable() = default;
+  SlotTable(const SlotTable &) = delete;
+  SlotTable &operator=(const SlotTable &) = delete;
+  ~SlotTable() { clear(); }
+
+  static constexpr size_t capacity() { return ChunkSize * Chunks; }
+
+  // Slots published so far
+  size_t size() const { return size_.load(std::memory_order_acquire); }
+  bool empty() const { return size() == 0; }
+
+  T &operator[](size_t slot) {
+    return chunks_[slot / ChunkSize]->slots[slot % ChunkSize];
+  }
+  const T &operator[](size_t slot) const {
+    return chunks_[slot / ChunkSize]->slots[slot % ChunkSize];
+  }
+
+  // Constructs a slot from args and publishes it. Returns its index, or
+  // capacity() if the table is full.
+  template <typename... Args> size_t emplace(Args &&...args) {
+    size_t slot = size_.load(std::memory_order_relaxed);
+    if (slot == capacity()) {
+      return capacity();
+    }
+    Chunk *&chunk = chunks_[slot / ChunkSize];
+    if (chunk == nullptr) {
+      chunk = new Chunk;
+    }
+    new (&chunk->slots[slot % ChunkSize]) T(std::forward<Args>(args)...);
+    size_.store(slot + 1, std::memory_order_release);
+    return slot;
+  }
+
+  // Removes all slots, only while there are no readers
+  void clear() {
+    size_t count = size_.load(std::memory_order_relaxed);
+    for (size_t slot = 0; slot < count; slot++) {
+      (*this)[slot].~T();
+    }
+    for (auto &chunk : chunks_) {
+      delete chunk;
+      chunk = nullptr;
+    }
+    size_.store(0, std::memory_order_release);
+  }
+
+private:
+  // Raw storage, slots are constructed when they are added
+  struct Chunk {
+    union {
+      T slots[ChunkSize];
+    };
+    Chunk() {}
+    ~Chunk() {}
+  };
+
+  Chunk *chunks_[Chunks]{};
+  std::atomic<size_t> size_{0};
+};
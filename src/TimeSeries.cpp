@@ -0,0 +1,287 @@
+#include "TimeSeries.h"
+#include <cmath>
+#include <cstring>
+
+#define TIMESERIES_BLOCK_POINTS 256
+// Values are kept to 1/32 degree or percent, well below the sensor accuracy
+#define VALUE_SCALE 32.0f
+
+namespace {
+uint32_t floatBits(float value) {
+  value = std::round(value * VALUE_SCALE) / VALUE_SCALE;
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+float bitsFloat(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+int32_t signExtend(uint32_t value, uint8_t bits) {
+  return static_cast<int32_t>(value << (32 - bits)) >> (32 - bits);
+}
+
+void put(std::vector<uint8_t> &out, const void *value, size_t length) {
+  auto bytes = static_cast<const uint8_t *>(value);
+  out.insert(out.end(), bytes, bytes + length);
+}
+
+bool get(const uint8_t *&data, const uint8_t *end, void *value,
+         size_t length) {
+  if (static_cast<size_t>(end - data) < length) {
+    return false;
+  }
+  memcpy(value, data, length);
+  data += length;
+  return true;
+}
+} // namespace
+
+TimeSeries::TimeSeries(uint32_t maxPoints) : maxPoints_{maxPoints} {}
+
+void TimeSeries::append(uint32_t timestamp, float temperature,
+                        float humidity) {
+  if (blocks_.empty() || blocks_.back().count == TIMESERIES_BLOCK_POINTS) {
+    if (!blocks_.empty()) {
+      blocks_.back().words.shrink_to_fit();
+    }
+    blocks_.emplace_back();
+  }
+
+  Block &block = blocks_.back();
+  uint32_t values[] = {floatBits(temperature), floatBits(humidity)};
+
+  if (block.count == 0) {
+    // The first point of a block is stored in full
+    write_(block, timestamp, 32);
+    block.delta = 0;
+    for (int i = 0; i < 2; i++) {
+      write_(block, values[i], 32);
+      // No previous window, the first changed value stores its own
+      block.channels[i] = {values[i], 32, 0};
+    }
+  } else {
+    uint32_t delta = timestamp - block.timestamp;
+    int32_t deltaOfDelta = static_cast<int32_t>(delta - block.delta);
+    if (deltaOfDelta == 0) {
+      write_(block, 0b0, 1);
+    } else if (deltaOfDelta >= -64 && deltaOfDelta < 64) {
+      write_(block, 0b10, 2);
+      write_(block, deltaOfDelta, 7);
+    } else if (deltaOfDelta >= -256 && deltaOfDelta < 256) {
+      write_(block, 0b110, 3);
+      write_(block, deltaOfDelta, 9);
+    } else if (deltaOfDelta >= -2048 && deltaOfDelta < 2048) {
+      write_(block, 0b1110, 4);
+      write_(block, deltaOfDelta, 12);
+    } else {
+      write_(block, 0b1111, 4);
+      write_(block, deltaOfDelta, 32);
+    }
+    block.delta = delta;
+
+    for (int i = 0; i < 2; i++) {
+      writeValue_(block, block.channels[i], values[i]);
+    }
+  }
+
+  block.timestamp = timestamp;
+  block.count++;
+  count_++;
+
+  // Drop the oldest block once the newer ones hold maxPoints
+  while (blocks_.size() > 1 && count_ - blocks_.front().count >= maxPoints_) {
+    count_ -= blocks_.front().count;
+    blocks_.pop_front();
+  }
+}
+
+TimeSeries::Reader TimeSeries::reader() const { return Reader{&blocks_}; }
+
+size_t TimeSeries::size() const { return count_; }
+
+size_t TimeSeries::bytes() const {
+  size_t bytes = 0;
+  for (const auto &block : blocks_) {
+    bytes += block.words.capacity() * sizeof(uint32_t);
+  }
+  return bytes;
+}
+
+void TimeSeries::save(std::vector<uint8_t> &out) const {
+  uint16_t blocks = blocks_.size();
+  put(out, &blocks, sizeof(blocks));
+  for (const auto &block : blocks_) {
+    put(out, &block.count, sizeof(block.count));
+    put(out, &block.bits, sizeof(block.bits));
+    put(out, &block.timestamp, sizeof(block.timestamp));
+    put(out, &block.delta, sizeof(block.delta));
+    for (const auto &channel : block.channels) {
+      put(out, &channel.value, sizeof(channel.value));
+      put(out, &channel.leading, sizeof(channel.leading));
+      put(out, &channel.trailing, sizeof(channel.trailing));
+    }
+    put(out, block.words.data(), block.words.size() * sizeof(uint32_t));
+  }
+}
+
+bool TimeSeries::restore(const uint8_t *data, size_t length) {
+  const uint8_t *end = data + length;
+  std::deque<Block> blocks;
+  size_t count = 0;
+
+  uint16_t blockCount;
+  if (!get(data, end, &blockCount, sizeof(blockCount))) {
+    return false;
+  }
+  for (uint16_t i = 0; i < blockCount; i++) {
+    Block &block = blocks.emplace_back();
+    if (!get(data, end, &block.count, sizeof(block.count)) ||
+        !get(data, end, &block.bits, sizeof(block.bits)) ||
+        !get(data, end, &block.timestamp, sizeof(block.timestamp)) ||
+        !get(data, end, &block.delta, sizeof(block.delta))) {
+      return false;
+    }
+    for (auto &channel : block.channels) {
+      if (!get(data, end, &channel.value, sizeof(channel.value)) ||
+          !get(data, end, &channel.leading, sizeof(channel.leading)) ||
+          !get(data, end, &channel.trailing, sizeof(channel.trailing))) {
+        return false;
+      }
+    }
+    block.words.resize((block.bits + 31) / 32);
+    if (block.count > TIMESERIES_BLOCK_POINTS ||
+        !get(data, end, block.words.data(),
+             block.words.size() * sizeof(uint32_t))) {
+      return false;
+    }
+    count += block.count;
+  }
+
+  blocks_ = std::move(blocks);
+  count_ = count;
+  return true;
+}
+
+void TimeSeries::write_(Block &block, uint32_t value, uint8_t bits) {
+  if (bits < 32) {
+    value &= (1u << bits) - 1;
+  }
+
+  uint32_t offset = block.bits & 31;
+  if (offset == 0) {
+    block.words.push_back(0);
+  }
+  uint32_t free = 32 - offset;
+  if (bits <= free) {
+    block.words.back() |= value << (free - bits);
+  } else {
+    // Split over the end of the last word
+    block.words.back() |= value >> (bits - free);
+    block.words.push_back(value << (32 - (bits - free)));
+  }
+  block.bits += bits;
+}
+
+void TimeSeries::writeValue_(Block &block, Channel &channel, uint32_t value) {
+  uint32_t diff = value ^ channel.value;
+  channel.value = value;
+  if (diff == 0) {
+    write_(block, 0b0, 1);
+    return;
+  }
+
+  uint8_t leading = __builtin_clz(diff);
+  uint8_t trailing = __builtin_ctz(diff);
+  if (leading >= channel.leading && trailing >= channel.trailing) {
+    // Changed bits fit in the previous window
+    write_(block, 0b10, 2);
+    write_(block, diff >> channel.trailing,
+           32 - channel.leading - channel.trailing);
+  } else {
+    uint8_t length = 32 - leading - trailing;
+    write_(block, 0b11, 2);
+    write_(block, leading, 5);
+    write_(block, length - 1, 5);
+    write_(block, diff >> trailing, length);
+    channel.leading = leading;
+    channel.trailing = trailing;
+  }
+}
+
+TimeSeries::Reader::Reader(const std::deque<Block> *blocks)
+    : blocks_{blocks} {}
+
+bool TimeSeries::Reader::next(Datapoint &dp) {
+  while (block_ < blocks_->size() && index_ == (*blocks_)[block_].count) {
+    block_++;
+    index_ = 0;
+    bit_ = 0;
+  }
+  if (block_ == blocks_->size()) {
+    return false;
+  }
+
+  if (index_ == 0) {
+    timestamp_ = read_(32);
+    delta_ = 0;
+    for (auto &channel : channels_) {
+      channel = {read_(32), 32, 0};
+    }
+  } else {
+    int32_t deltaOfDelta;
+    if (read_(1) == 0) {
+      deltaOfDelta = 0;
+    } else if (read_(1) == 0) {
+      deltaOfDelta = signExtend(read_(7), 7);
+    } else if (read_(1) == 0) {
+      deltaOfDelta = signExtend(read_(9), 9);
+    } else if (read_(1) == 0) {
+      deltaOfDelta = signExtend(read_(12), 12);
+    } else {
+      deltaOfDelta = read_(32);
+    }
+    delta_ += deltaOfDelta;
+    timestamp_ += delta_;
+
+    for (auto &channel : channels_) {
+      readValue_(channel);
+    }
+  }
+  index_++;
+
+  dp = Datapoint{bitsFloat(channels_[0].value), bitsFloat(channels_[1].value),
+                 timestamp_};
+  return true;
+}
+
+uint32_t TimeSeries::Reader::read_(uint8_t bits) {
+  const auto &words = (*blocks_)[block_].words;
+  uint32_t word = bit_ >> 5;
+  uint32_t offset = bit_ & 31;
+  uint32_t value = (words[word] << offset) >> (32 - bits);
+  if (bits > 32 - offset) {
+    // Rest of the bits from the start of the next word
+    value |= words[word + 1] >> (64 - offset - bits);
+  }
+  bit_ += bits;
+  return value;
+}
+
+void TimeSeries::Reader::readValue_(Channel &channel) {
+  if (read_(1) == 0) {
+    return;
+  }
+  if (read_(1) == 0) {
+    uint8_t length = 32 - channel.leading - channel.trailing;
+    channel.value ^= read_(length) << channel.trailing;
+  } else {
+    channel.leading = read_(5);
+    uint8_t length = read_(5) + 1;
+    channel.trailing = 32 - channel.leading - length;
+    channel.value ^= read_(length) << channel.trailing;
+  }
+}
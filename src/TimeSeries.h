@@ -0,0 +1,85 @@
+#pragma once
+#include <Arduino.h>
+#include <deque>
+#include <vector>
+
+struct Datapoint {
+  float temperature;
+  float humidity;
+  uint32_t timestamp; // Seconds, only set for points read from a TimeSeries
+  Datapoint(float temperature, float humidity, uint32_t timestamp = 0)
+      : temperature{temperature}, humidity{humidity}, timestamp{timestamp} {}
+};
+
+// Compressed series of timestamped temperature and humidity points, encoded as
+// in Facebook's Gorilla time series database.
+//
+// Timestamps are stored as the difference between successive deltas, a single
+// bit while points arrive at a regular interval. Values are XORed with the
+// previous value and only the bits that changed are stored, a single bit when
+// the value is the same. Values are first rounded to 1/VALUE_SCALE so that
+// they only use the top bits of the float mantissa.
+//
+// Points are encoded in blocks of TIMESERIES_BLOCK_POINTS so the oldest block
+// can be dropped once more than maxPoints are held. Points can only be read
+// oldest first, with a Reader.
+class TimeSeries {
+  struct Block;
+  // XOR encoder state of a value
+  struct Channel {
+    uint32_t value;
+    uint8_t leading;
+    uint8_t trailing;
+  };
+
+public:
+  class Reader {
+  public:
+    // Reads the next point, returns false after the newest point
+    bool next(Datapoint &dp);
+
+  private:
+    friend class TimeSeries;
+    const std::deque<Block> *blocks_;
+    size_t block_{0};
+    uint16_t index_{0};
+    uint32_t bit_{0};
+    uint32_t timestamp_{0};
+    uint32_t delta_{0};
+    Channel channels_[2]{};
+
+    explicit Reader(const std::deque<Block> *blocks);
+    uint32_t read_(uint8_t bits);
+    void readValue_(Channel &channel);
+  };
+
+  explicit TimeSeries(uint32_t maxPoints);
+  void append(uint32_t timestamp, float temperature, float humidity);
+  Reader reader() const;
+  // Points held, at least maxPoints once that many have been appended
+  size_t size() const;
+  // Bytes of encoded points
+  size_t bytes() const;
+  // Serialises the encoded blocks, restore() accepts the saved bytes
+  void save(std::vector<uint8_t> &out) const;
+  bool restore(const uint8_t *data, size_t length);
+
+private:
+  struct Block {
+    std::vector<uint32_t> words;
+    uint32_t bits{0};
+    uint16_t count{0};
+    // Encoder state after the last point
+    uint32_t timestamp{0};
+    uint32_t delta{0};
+    Channel channels[2]{};
+  };
+
+  uint32_t maxPoints_;
+  size_t count_{0};
+  std::deque<Block> blocks_;
+
+  static void write_(Block &block, uint32_t value, uint8_t bits);
+  static void writeValue_(Block &block, Channel &channel,
+                          uint32_t value);
+};
@@ -0,0 +1,164 @@
+#include "TopicRouter.h"
+#include <cstring>
+
+namespace {
+// FNV-1a
+uint32_t levelHash(const char *data, size_t length) {
+  uint32_t hash = 2166136261u;
+  while (length--) {
+    hash = (hash ^ static_cast<uint8_t>(*data++)) * 16777619u;
+  }
+  return hash;
+}
+} // namespace
+
+bool TopicLevel::equals(const char *str) const {
+  return strncmp(data, str, length) == 0 && str[length] == '\0';
+}
+
+String TopicLevel::toString() const { return String(data, length); }
+
+const char *TopicMatch::topic() const { return topic_; }
+
+uint8_t TopicMatch::levels() const { return count_; }
+
+TopicLevel TopicMatch::level(uint8_t n) const { return levels_[n]; }
+
+TopicLevel TopicMatch::last() const { return levels_[count_ - 1]; }
+
+TopicRouter::TopicRouter() : root_{new Node} {}
+
+TopicRouter::~TopicRouter() = default;
+
+bool TopicRouter::subscribe(const char *filter, handler_t handler) {
+  TopicLevel levels[MAX_TOPIC_LEVELS];
+  uint32_t hashes[MAX_TOPIC_LEVELS];
+  uint8_t count = split_(filter, levels, hashes);
+  if (count > MAX_TOPIC_LEVELS) {
+    log_e("Topic filter %s has too many levels", filter);
+    return false;
+  }
+
+  Node *node = root_.get();
+  for (uint8_t i = 0; i < count; i++) {
+    const auto &level = levels[i];
+    if (level.equals("#") && i == count - 1) {
+      node->multiLevel.push_back(handler);
+      filterCount_++;
+      return true;
+    }
+
+    if (level.equals("+")) {
+      if (!node->singleLevel) {
+        node->singleLevel.reset(new Node);
+      }
+      node = node->singleLevel.get();
+      continue;
+    }
+
+    if (memchr(level.data, '+', level.length) ||
+        memchr(level.data, '#', level.length)) {
+      log_e("Invalid topic filter %s", filter);
+      return false;
+    }
+
+    Node *child = nullptr;
+    auto range = node->children.equal_range(hashes[i]);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (level.equals(it->second->level.c_str())) {
+        child = it->second.get();
+        break;
+      }
+    }
+    if (child == nullptr) {
+      child = new Node;
+      child->level = level.toString();
+      node->children.emplace(hashes[i], child);
+    }
+    node = child;
+  }
+
+  node->handlers.push_back(handler);
+  filterCount_++;
+  return true;
+}
+
+size_t TopicRouter::dispatch(const char *topic, const uint8_t *payload,
+                             unsigned int length) const {
+  TopicLevel levels[MAX_TOPIC_LEVELS];
+  uint32_t hashes[MAX_TOPIC_LEVELS];
+  uint8_t count = split_(topic, levels, hashes);
+  if (count > MAX_TOPIC_LEVELS) {
+    log_e("Topic %s has too many levels", topic);
+    return 0;
+  }
+
+  TopicMatch match;
+  match.topic_ = topic;
+  match.levels_ = levels;
+  match.count_ = count;
+  return match_(*root_, match, hashes, 0, payload, length);
+}
+
+size_t TopicRouter::filterCount() const { return filterCount_; }
+
+uint8_t TopicRouter::split_(const char *topic, TopicLevel *levels,
+                            uint32_t *hashes) {
+  uint8_t count = 0;
+  const char *start = topic;
+  for (;;) {
+    const char *end = strchr(start, '/');
+    size_t length = end ? end - start : strlen(start);
+    if (count == MAX_TOPIC_LEVELS) {
+      return MAX_TOPIC_LEVELS + 1;
+    }
+    levels[count] = {start, length};
+    hashes[count] = levelHash(start, length);
+    count++;
+    if (end == nullptr) {
+      return count;
+    }
+    start = end + 1;
+  }
+}
+
+size_t TopicRouter::match_(const Node &node, const TopicMatch &match,
+                           const uint32_t *hashes, uint8_t index,
+                           const uint8_t *payload, unsigned int length) const {
+  // Wildcards do not match the first level of $SYS style topics
+  bool wildcards = index > 0 || match.count_ == 0 ||
+                   match.levels_[0].length == 0 ||
+                   match.levels_[0].data[0] != '$';
+  size_t called = 0;
+
+  if (wildcards) {
+    for (const auto &handler : node.multiLevel) {
+      handler(match, payload, length);
+      called++;
+    }
+  }
+
+  if (index == match.count_) {
+    for (const auto &handler : node.handlers) {
+      handler(match, payload, length);
+      called++;
+    }
+    return called;
+  }
+
+  const auto &level = match.levels_[index];
+  auto range = node.children.equal_range(hashes[index]);
+  for (auto it = range.first; it != range.second; ++it) {
+    const auto &child = *it->second;
+    if (child.level.length() == level.length &&
+        memcmp(child.level.c_str(), level.data, level.length) == 0) {
+      called += match_(child, match, hashes, index + 1, payload, length);
+    }
+  }
+
+  if (wildcards && node.singleLevel) {
+    called +=
+        match_(*node.singleLevel, match, hashes, index + 1, payload, length);
+  }
+  return called;
+}
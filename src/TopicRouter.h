@@ -0,0 +1,102 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#define MAX_TOPIC_LEVELS 16
+
+// A level of a topic, pointing into the topic string
+struct TopicLevel {
+  const char *data;
+  size_t length;
+  bool equals(const char *str) const;
+  String toString() const;
+};
+
+// Topic being dispatched, split into levels
+class TopicMatch {
+public:
+  const char *topic() const;
+  uint8_t levels() const;
+  TopicLevel level(uint8_t n) const;
+  TopicLevel last() const;
+
+private:
+  friend class TopicRouter;
+  const char *topic_;
+  const TopicLevel *levels_;
+  uint8_t count_;
+};
+
+// Dispatches MQTT messages to the handlers of the topic filters they match.
+//
+// Filters are split into levels and stored in a trie with a child per level
+// name, looked up by hash, and separate children for the + and # wildcards.
+// Matching a topic walks the trie one level at a time, so its cost depends on
+// the topic depth and the wildcards on its path but not on the number of
+// filters, and it allocates nothing. The wildcards follow MQTT: + matches one
+// level, # as the last level matches the parent and any levels below it, and
+// neither matches a first level starting with $.
+class TopicRouter {
+public:
+  typedef std::function<void(const TopicMatch &topic, const uint8_t *payload,
+                             unsigned int length)>
+      handler_t;
+
+  TopicRouter();
+  ~TopicRouter();
+
+  // Adds a handler for topics matching filter, returns false if the filter is
+  // not valid
+  bool subscribe(const char *filter, handler_t handler);
+
+  // Adds a handler for messages decoded by decode, messages that do not
+  // decode are logged and dropped. Each filter decodes into its own Message,
+  // which is cleared rather than constructed for every message so it keeps
+  // its storage, so the handler must not keep references into it.
+  template <typename Message>
+  bool subscribe(const char *filter,
+                 bool (*decode)(const uint8_t *payload, unsigned int length,
+                                Message &message),
+                 std::function<void(const TopicMatch &topic,
+                                    const Message &message)>
+                     handler) {
+    return subscribe(filter, [decode, handler, message = Message{}](
+                                 const TopicMatch &topic,
+                                 const uint8_t *payload,
+                                 unsigned int length) mutable {
+      message.clear();
+      if (!decode(payload, length, message)) {
+        log_e("Dropped message on %s that could not be decoded", topic.topic());
+        return;
+      }
+      handler(topic, message);
+    });
+  }
+
+  // Calls the handlers of all filters matching topic, returns the number of
+  // handlers called. Called from one task at a time.
+  size_t dispatch(const char *topic, const uint8_t *payload,
+                  unsigned int length) const;
+  size_t filterCount() const;
+
+private:
+  struct Node {
+    String level;
+    std::unordered_multimap<uint32_t, std::unique_ptr<Node>> children;
+    std::unique_ptr<Node> singleLevel; // + child
+    std::vector<handler_t> handlers;   // Filters ending at this node
+    std::vector<handler_t> multiLevel; // Filters ending with # below it
+  };
+
+  std::unique_ptr<Node> root_;
+  size_t filterCount_{0};
+
+  static uint8_t split_(const char *topic, TopicLevel *levels,
+                        uint32_t *hashes);
+  size_t match_(const Node &node, const TopicMatch &match,
+                const uint32_t *hashes, uint8_t index, const uint8_t *payload,
+                unsigned int length) const;
+};
@@ -0,0 +1,155 @@
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <esp_timer.h>
+#include <vector>
+
+namespace Trace {
+namespace {
+enum EventType : uint8_t { Begin = 1, End, Counter };
+
+struct Event {
+  uint32_t cycles;
+  TickType_t tick; // Tells the cycle counter wraps apart, every 18 s
+  const char *name;
+  TaskHandle_t task;
+  int32_t value;
+  uint8_t type;
+  uint8_t core;
+};
+
+// Cycle counts of each core at a common time
+struct Calibration {
+  uint32_t cycles;
+  TickType_t tick;
+  int64_t time_us;
+};
+
+Event events[TRACE_EVENTS];
+std::atomic<uint32_t> head{0};
+std::atomic<bool> recording{false};
+Calibration calibration[portNUM_PROCESSORS];
+uint32_t cyclesPerUs = 240;
+
+void record_(uint8_t type, const char *name, int32_t value) {
+  if (!recording.load(std::memory_order_relaxed)) {
+    return;
+  }
+  auto &event =
+      events[head.fetch_add(1, std::memory_order_relaxed) % TRACE_EVENTS];
+  event.core = xPortGetCoreID();
+  event.cycles = ESP.getCycleCount();
+  event.tick = xTaskGetTickCount();
+  event.name = name;
+  event.task = xTaskGetCurrentTaskHandle();
+  event.value = value;
+  event.type = type;
+}
+
+void calibrate_(void *param) {
+  auto &cal = calibration[xPortGetCoreID()];
+  cal.tick = xTaskGetTickCount();
+  cal.cycles = ESP.getCycleCount();
+  cal.time_us = esp_timer_get_time();
+  xSemaphoreGive(static_cast<SemaphoreHandle_t>(param));
+  vTaskDelete(nullptr);
+}
+
+// Microseconds since boot of an event. The cycle counters of the cores are
+// not synchronized and wrap, so the count since the calibration of the core
+// is unwrapped with the tick count, which is accurate to a millisecond.
+double toMicros_(const Event &event) {
+  const auto &cal = calibration[event.core];
+  const int64_t wrap = 1LL << 32;
+  int64_t estimate = static_cast<int64_t>(static_cast<int32_t>(
+                         event.tick - cal.tick)) *
+                     portTICK_PERIOD_MS * 1000 * cyclesPerUs;
+  int64_t cycles = static_cast<uint32_t>(event.cycles - cal.cycles);
+  cycles += llround(static_cast<double>(estimate - cycles) / wrap) * wrap;
+  return cal.time_us + static_cast<double>(cycles) / cyclesPerUs;
+}
+} // namespace
+
+void begin() {
+  cyclesPerUs = getCpuFrequencyMhz();
+
+  SemaphoreHandle_t done = xSemaphoreCreateCounting(portNUM_PROCESSORS, 0);
+  for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++) {
+    xTaskCreatePinnedToCore(calibrate_, "trace", 2048, done,
+                            configMAX_PRIORITIES - 1, nullptr, core);
+  }
+  for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++) {
+    xSemaphoreTake(done, portMAX_DELAY);
+  }
+  vSemaphoreDelete(done);
+
+  recording = true;
+}
+
+void beginSpan(const char *name) { record_(EventType::Begin, name, 0); }
+
+void endSpan(const char *name) { record_(EventType::End, name, 0); }
+
+void counter(const char *name, int32_t value) {
+  record_(EventType::Counter, name, value);
+}
+
+void dump(Print &out) {
+  bool wasRecording = recording.exchange(false);
+  // Let events being recorded complete
+  delay(1);
+
+  uint32_t end = head.load();
+  uint32_t start = end > TRACE_EVENTS ? end - TRACE_EVENTS : 0;
+
+  // Names of the tasks that still exist
+  std::vector<TaskStatus_t> tasks(uxTaskGetNumberOfTasks() + 4);
+  tasks.resize(uxTaskGetSystemState(tasks.data(), tasks.size(), nullptr));
+  std::vector<std::pair<uint8_t, TaskHandle_t>> threads;
+
+  out.print("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  bool first = true;
+  for (uint32_t i = start; i < end; i++) {
+    const auto &event = events[i % TRACE_EVENTS];
+    auto thread = std::make_pair(event.core, event.task);
+    if (std::find(threads.begin(), threads.end(), thread) == threads.end()) {
+      threads.push_back(thread);
+    }
+
+    out.printf("%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":%u,"
+               "\"tid\":%u",
+               first ? "" : ",\n", event.name,
+               event.type == EventType::Begin ? "B"
+               : event.type == EventType::End ? "E"
+                                              : "C",
+               toMicros_(event), event.core,
+               reinterpret_cast<uintptr_t>(event.task));
+    if (event.type == EventType::Counter) {
+      out.printf(",\"args\":{\"value\":%d}", event.value);
+    }
+    out.print("}");
+    first = false;
+  }
+
+  for (const auto &[core, task] : threads) {
+    auto it = std::find_if(tasks.begin(), tasks.end(), [&](const auto &status) {
+      return status.xHandle == task;
+    });
+    out.printf("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,"
+               "\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+               first ? "" : ",\n", core, reinterpret_cast<uintptr_t>(task),
+               it != tasks.end() ? it->pcTaskName : "ended");
+    first = false;
+  }
+  for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++) {
+    out.printf("%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,"
+               "\"args\":{\"name\":\"core %u\"}}",
+               first ? "" : ",\n", core, core);
+    first = false;
+  }
+  out.print("\n]}\n");
+
+  recording = wasRecording;
+}
+} // namespace Trace
@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+
+// Events kept, older ones are overwritten
+#define TRACE_EVENTS 512
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// Traces the rest of the enclosing scope as a span, name must be a literal
+#define TRACE_SCOPE(name) Trace::Span TRACE_CONCAT(traceSpan, __LINE__){name}
+
+// Records spans and counters into a fixed ring with CPU cycle counter
+// timestamps. Recording claims a slot with one atomic increment and takes no
+// lock, so any task can record for well under a microsecond. Names are stored
+// as pointers and must be string literals.
+//
+// dump() writes the ring as Chrome Trace Event JSON, which chrome://tracing
+// and ui.perfetto.dev open, with a row per task under a process per core.
+namespace Trace {
+// Calibrates the cycle counter of each core and starts recording
+void begin();
+void beginSpan(const char *name);
+void endSpan(const char *name);
+void counter(const char *name, int32_t value);
+// Pauses recording while the ring is written to out
+void dump(Print &out);
+
+class Span {
+public:
+  explicit Span(const char *name) : name_{name} { beginSpan(name); }
+  ~Span() { endSpan(name_); }
+
+private:
+  const char *name_;
+};
+} // namespace Trace
@@ -1,11 +1,17 @@
 #include "View.h"
+#include "AllocProfiler.h"
+#include "Battery.h"
+#include "ConnectionManager.h"
 #include "DataModel.h"
-#include "esp_adc_cal.h"
+#include "Diagnostics.h"
+#include "Trace.h"
 #include "humidity.h"
 #include "thermometer.h"
 #include <Arduino.h>
+#include <algorithm>
 #include <cmath>
 #include <ctime>
+#include <esp_timer.h>
 
 #include "Calibri32.h"
 #include "CalibriBold20.h"
@@ -14,26 +20,34 @@
 #define medium CalibriBold20
 #define large Calibri32
 
-#define NUM_PAGES 3
+#define NUM_PAGES 4
+#define DIAGNOSTICS_PAGE 3
 #define HOURS_PER_DIVISION 4
 #define SECS_PER_HOUR 3600
 #define PIXELS_PER_HOUR 15
-#define BAT_ADC 4
-
-uint32_t getBatteryCharge(uint32_t voltage);
-
-#define SAMPLE_INTERVAL_SECS 60 // one minute
-const uint32_t datapointInterval_secs =
-    SAMPLES_PER_DATAPOINT * SAMPLE_INTERVAL_SECS;
+// Frames are at most 30 per second, the clock on the main page is redrawn
+// every second
+#define FRAME_MIN_MS 33
+#define FRAME_TICK_MS 1000
+// Frame reasons besides FRAME_TICK
+#define FRAME_DATA 0x1
+#define FRAME_NAVIGATION 0x2
 
 const uint32_t backgroundColor = TFT_WHITE;
+// Graph background where datapoints are missing
+const uint32_t gapColor = 0x2104;
 
-static uint32_t readADC_Cal(int ADC_Raw) {
-  esp_adc_cal_characteristics_t adc_chars;
+static void loadFont(TFT_eSprite &sprite, const uint8_t font[]) {
+  TRACE_SCOPE("font load");
+  sprite.loadFont(font);
+}
 
-  esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100,
-                           &adc_chars);
-  return (esp_adc_cal_raw_to_voltage(ADC_Raw, &adc_chars));
+// Returns the size of the Sprite pixel data, the nominal bytes a frame sends
+// to the display. Clipping and the window commands are not counted.
+static uint32_t pushSprite(TFT_eSprite &sprite) {
+  TRACE_SCOPE("sprite push");
+  sprite.pushSprite(0, 0);
+  return sprite.width() * sprite.height() * sizeof(uint16_t);
 }
 
 /* clang-format off */
@@ -42,6 +56,7 @@ View::View(uint32_t width, uint32_t height, DataModel& dataModel) :
   height_{height}, 
   dataModel_{dataModel},
   tft_{TFT_eSPI()},
+  frames_{FRAME_MIN_MS, FRAME_TICK_MS},
   customGreen_{tft_.color565(0, 204, 0)} {
     dataModel.setView(this);
   }
@@ -51,66 +66,110 @@ void View::init() {
   tft_.init();
   tft_.setRotation(1);
   std::swap(width_, height_);
+  if (!bands_.begin()) {
+    log_e("Could not start the band renderer, graphs render on one core");
+  }
 }
 
-void View::update(uint16_t sensorId) {
+void View::update(const std::vector<uint16_t> &sensorIds) {
+  if (sensorIds.empty()) {
+    return;
+  }
+
+  xSemaphoreTake(mutex_, portMAX_DELAY);
   if (currentSensorId_ == 0) {
-    currentSensorId_ = sensorId;
+    currentSensorId_ = sensorIds.front();
   }
-  if (sensorId == currentSensorId_) {
-    vm_ = dataModel_.getViewModel(sensorId);
-    render_();
-    updateCounter_ = 0;
+  bool current = std::find(sensorIds.begin(), sensorIds.end(),
+                           currentSensorId_) != sensorIds.end();
+  xSemaphoreGive(mutex_);
+
+  // The view model is fetched on the display task when the frame is drawn
+  if (current) {
+    frames_.invalidate(FRAME_DATA);
   }
 }
 
 void View::updateTask(void *param) {
-  auto ticktime = xTaskGetTickCount();
   for (;;) {
-    render_();
-    vTaskDelayUntil(&ticktime, 1000);
+    uint32_t reasons = frames_.waitForFrame();
+    frames_.frameDone(render_(reasons));
   }
 }
 
 void View::nextPage() {
+  xSemaphoreTake(mutex_, portMAX_DELAY);
   pageIndex_ = (pageIndex_ + 1) % NUM_PAGES;
-  render_();
+  xSemaphoreGive(mutex_);
+  frames_.invalidate(FRAME_NAVIGATION);
 }
 
 void View::nextSensor() {
   auto sensorIds = dataModel_.getSensorIds();
 
+  xSemaphoreTake(mutex_, portMAX_DELAY);
   for (int i = 0; i < sensorIds.size(); i++) {
     if (sensorIds[i] == currentSensorId_) {
       int next = (i + 1) % sensorIds.size();
       currentSensorId_ = sensorIds[next];
       // Reset to initial page
       pageIndex_ = 0;
-      update(currentSensorId_);
+      xSemaphoreGive(mutex_);
+      frames_.invalidate(FRAME_DATA | FRAME_NAVIGATION);
       return;
     }
   }
+  xSemaphoreGive(mutex_);
 
   assert(false);
 }
 
 void View::incrementDisconnects() { disconnectCount_++; }
 
-void View::render_() {
+void View::setConnection(const ConnectionManager *connection) {
+  connection_ = connection;
+}
+
+FrameStats View::frameStats() const { return frames_.stats(); }
+
+bool View::render_(uint32_t reasons) {
+  ALLOC_SCOPE("render");
   xSemaphoreTake(mutex_, portMAX_DELAY);
+  uint32_t pageIndex = pageIndex_;
+  uint16_t sensorId = currentSensorId_;
+  xSemaphoreGive(mutex_);
+
+  if ((reasons & FRAME_DATA) && sensorId != 0) {
+    vm_ = dataModel_.getViewModel(sensorId);
+    updateCounter_ = 0;
+  }
 
-  switch (pageIndex_) {
+  switch (pageIndex) {
   case 1:
-    renderGraphPage_(GraphType::Temperature);
+  case 2: {
+    TRACE_SCOPE("render graph");
+    // Between data updates the graph only changes when time moves it by a
+    // pixel
+    uint32_t column = time(nullptr) / (SECS_PER_HOUR / PIXELS_PER_HOUR);
+    if (reasons == FRAME_TICK && column == graphColumn_) {
+      return false;
+    }
+    graphColumn_ = column;
+    renderGraphPage_(pageIndex == 1 ? GraphType::Temperature
+                                    : GraphType::Humidity);
     break;
-  case 2:
-    renderGraphPage_(GraphType::Humidity);
+  }
+  case DIAGNOSTICS_PAGE: {
+    TRACE_SCOPE("render diagnostics");
+    renderDiagnosticsPage_();
     break;
-  default:
+  }
+  default: {
+    TRACE_SCOPE("render main");
     renderMainPage_();
   }
-
-  xSemaphoreGive(mutex_);
+  }
+  return true;
 }
 
 void View::renderMainPage_() {
@@ -121,18 +180,25 @@ void View::renderMainPage_() {
   displaySprite.setSwapBytes(true);
   displaySprite.fillSprite(TFT_WHITE);
 
+  // The icons are opaque and never tinted, so they stay RGB565 images: the
+  // 16 bit pushImage() is a row copy, about twice as fast as blending a
+  // TFT_eMask, for 5 KB more flash. Masks are for icons drawn in a colour
+  // or over a changing background.
   displaySprite.pushImage(16, 8, 32, 64, thermometer);
   displaySprite.pushImage(160, 12, 32, 40, humidity);
 
-  displaySprite.loadFont(large);
+  loadFont(displaySprite, large);
   displaySprite.setTextColor(TFT_BLACK, backgroundColor);
-  auto strTemperature = String(vm_.temperature, 1) + "°C";
+  // Labels are formatted into buffers on the stack rather than heap Strings
+  TFT_eTextBuffer<16> strTemperature;
+  strTemperature.addFixed(vm_.temperature, 1, "°C");
   displaySprite.drawString(strTemperature, 56, 22);
-  auto strHumidity = String(vm_.humidity, 0) + "%";
+  TFT_eTextBuffer<16> strHumidity;
+  strHumidity.addFixed(vm_.humidity, 0, "%");
   displaySprite.drawString(strHumidity, 198, 22);
-  displaySprite.drawString(vm_.sensorLocation, 56, 52);
+  labelCache_.drawString(&displaySprite, vm_.sensorLocation, 56, 52);
 
-  displaySprite.loadFont(small);
+  loadFont(displaySprite, small);
   displaySprite.setTextDatum(TR_DATUM);
   auto chargePercent = getBatteryCharge(vm_.battery);
   if (chargePercent <= 10) {
@@ -142,44 +208,44 @@ void View::renderMainPage_() {
   } else {
     displaySprite.setTextColor(customGreen_, TFT_WHITE);
   }
-  auto strBatttery = "BAT: " + String(chargePercent) + "%";
+  TFT_eTextBuffer<16> strBattery{"BAT: "};
+  strBattery.addUInt(chargePercent, "%");
 
-  displaySprite.drawString(strBatttery, width_ - 4, 4);
+  displaySprite.drawString(strBattery, width_ - 4, 4);
 
   detailSprite.createSprite(width_, 80);
   detailSprite.fillSprite(TFT_DARKGREY);
-  detailSprite.loadFont(small);
+  loadFont(detailSprite, small);
   detailSprite.setTextColor(TFT_WHITE, TFT_BLACK);
 
   int32_t y = 4;
-  auto strMinMax = "MIN: " + String(vm_.minTemperature, 1);
-  strMinMax += "°C, MAX: " + String(vm_.maxTemperature, 1) + "°C";
+  TFT_eTextBuffer<40> strMinMax{"MIN: "};
+  strMinMax.addFixed(vm_.minTemperature, 1, "°C, MAX: ");
+  strMinMax.addFixed(vm_.maxTemperature, 1, "°C");
   detailSprite.drawString(strMinMax, 4, y);
 
   y += 17;
-  auto strCounter = "Counter: " + String(updateCounter_++);
-  strCounter += ", Disconnects: " + String(disconnectCount_);
+  TFT_eTextBuffer<48> strCounter{"Counter: "};
+  strCounter.addUInt(updateCounter_++, ", Disconnects: ");
+  strCounter.addUInt(disconnectCount_);
   detailSprite.drawString(strCounter, 4, y);
 
   y += 17;
-  uint32_t battery_mv = readADC_Cal(analogRead(BAT_ADC)) * 2;
-
-  // auto battery_mv = (analogRead(4) * 2 * 3.3 * 1000) / 4096;
-  auto strBattery2 =
-      "Display BAT: " + String(getBatteryCharge(battery_mv)) + "%";
+  TFT_eTextBuffer<24> strBattery2{"Display BAT: "};
+  strBattery2.addUInt(Battery::charge(), "%");
   detailSprite.drawString(strBattery2, 4, y);
 
   y += 17;
   tm timeinfo;
-  char buf[64];
   getLocalTime(&timeinfo);
-  strftime(buf, sizeof(buf), "%c", &timeinfo);
-  detailSprite.drawString(buf, 4, y);
+  TFT_eTextBuffer<64> strTime;
+  strTime.addTime("%c", &timeinfo);
+  detailSprite.drawString(strTime, 4, y);
 
   detailSprite.pushToSprite(&displaySprite, 0, height_ - 80);
   detailSprite.deleteSprite();
 
-  displaySprite.pushSprite(0, 0);
+  frameBytes_ = pushSprite(displaySprite);
 }
 
 void View::renderGraphPage_(GraphType graphType) {
@@ -200,55 +266,186 @@ void View::renderGraphPage_(GraphType graphType) {
 
   float scalingFactor = static_cast<float>(height_ - axis_px) / (valueRange);
 
-  auto displaySprite = TFT_eSprite(&tft_);
   auto graphSprite = TFT_eSprite(&tft_);
+  graphSprite.createSprite(width_, height_);
 
-  displaySprite.createSprite(width_, height_);
-  displaySprite.setSwapBytes(true);
-  displaySprite.fillSprite(TFT_WHITE);
+  time_t now = time(nullptr);
+  tm time_buf;
+  localtime_r(&now, &time_buf);
+  time_buf.tm_min = 0;
+  time_buf.tm_sec = 0;
 
-  graphSprite.createSprite(width_, height_);
-  graphSprite.fillSprite(TFT_BLACK);
+  time_t wholeHour = mktime(&time_buf);
+  int x = width_ - 1 - PIXELS_PER_HOUR * (now - wholeHour) / SECS_PER_HOUR;
+
+  // The grid and its labels only change with the value range and when the hour
+  // lines move, so replay the recorded grid until then.
+  int32_t gridKey[] = {static_cast<int32_t>(minValue),
+                       static_cast<int32_t>(maxValue), x, time_buf.tm_hour};
+  if (gridList_.size() == 0 ||
+      !std::equal(std::begin(gridKey), std::end(gridKey), gridKey_)) {
+    std::copy(std::begin(gridKey), std::end(gridKey), gridKey_);
+    recordGrid_(minValue, maxValue, x, time_buf.tm_hour);
+  }
+  // Datapoints are placed by their wall clock time, on the same axis as the
+  // hour lines
+  auto timeToX = [&](uint32_t timestamp) {
+    int32_t age = now - timestamp;
+    return static_cast<int32_t>(width_) - 1 -
+           PIXELS_PER_HOUR * age / SECS_PER_HOUR;
+  };
+
+  // Shade the buckets without a datapoint, under the grid
+  gapList_.clear();
+  gapList_.fillScreen(TFT_BLACK);
+  auto reader = vm_.datapoints.reader();
+  Datapoint dp{0, 0};
+  uint32_t previous = 0;
+  auto fillGap = [&](uint32_t from, uint32_t to) {
+    int32_t x0 = timeToX(from);
+    gapList_.fillRect(x0, 0, timeToX(to) - x0 + 1, height_ - axis_px, gapColor);
+  };
+  while (reader.next(dp)) {
+    if (previous != 0 && dp.timestamp - previous > DATAPOINT_SECS) {
+      fillGap(previous + DATAPOINT_SECS, dp.timestamp - 1);
+    }
+    previous = dp.timestamp;
+  }
+  // The datapoint of the current bucket is added when it ends
+  if (previous != 0 && now - previous > 2 * DATAPOINT_SECS) {
+    fillGap(previous + DATAPOINT_SECS, now);
+  }
+
+  pointList_.clear();
+  reader = vm_.datapoints.reader();
+  while (reader.next(dp)) {
+    int32_t age = now - dp.timestamp;
+    if (age < 0 || age > VIEW_HISTORY_SECS) {
+      continue;
+    }
+    float value =
+        graphType == GraphType::Temperature ? dp.temperature : dp.humidity;
+    float scaledValue = std::round((value - minValue) * scalingFactor);
+    uint32_t y = static_cast<uint32_t>(scaledValue);
+    pointList_.fillCircle(timeToX(dp.timestamp), height_ - y - axis_px, 2,
+                          TFT_RED);
+  }
+
+  // Each core rasterizes half of the rows, the sprite is complete on return
+  bands_.clear();
+  bands_.add(&gapList_);
+  bands_.add(&gridList_);
+  bands_.add(&pointList_);
+  bands_.render(&graphSprite);
+
+  loadFont(graphSprite, large);
+  graphSprite.setTextDatum(TL_DATUM);
+  graphSprite.setTextColor(TFT_WHITE, TFT_LIGHTGREY, true);
+  labelCache_.drawString(&graphSprite, vm_.sensorLocation, axis_px + 8, 8);
+
+  frameBytes_ = pushSprite(graphSprite);
+}
+
+void View::renderDiagnosticsPage_() {
+  // Sampled only while the page is shown, every FRAME_TICK_MS
+  FrameStats frames = frames_.stats();
+  MessageStats messages = Diagnostics::messages();
+  MemoryStats memory = Diagnostics::memory();
+  std::vector<TaskLoad> tasks = Diagnostics::tasks();
+  std::array<float, portNUM_PROCESSORS> cores = Diagnostics::cores();
+
+  int64_t now_us = esp_timer_get_time();
+  float messageRate =
+      hudTime_us_ == 0 ? 0
+                       : (messages.messages - hudMessages_) * 1e6f /
+                             (now_us - hudTime_us_);
+  hudMessages_ = messages.messages;
+  hudTime_us_ = now_us;
+
+  auto hudSprite = TFT_eSprite(&tft_);
+  hudSprite.createSprite(width_, height_);
+  hudSprite.fillSprite(TFT_BLACK);
+  // The built in 6x8 font fits 40 columns and 16 rows
+  hudSprite.setTextFont(1);
+  hudSprite.setTextColor(TFT_GREEN, TFT_BLACK);
+  hudSprite.setCursor(0, 0);
+
+  hudSprite.printf("Frame %5.1f ms avg %5.1f ms p99\n",
+                   frames.avgFrame_us / 1000.0f, frames.p99Frame_us / 1000.0f);
+  hudSprite.printf("Latency %u ms avg %u ms max\n",
+                   frames.avgLatency_us / 1000, frames.maxLatency_us / 1000);
+  hudSprite.printf("Frame size %u kB, %u skipped\n", frameBytes_ / 1024,
+                   frames.skipped);
+  hudSprite.print("CPU");
+  for (float load : cores) {
+    if (load < 0) {
+      hudSprite.print("    -");
+    } else {
+      hudSprite.printf(" %3.0f%%", load * 100);
+    }
+  }
+  hudSprite.print("\n");
+  hudSprite.printf("MQTT %.1f msg/s, parse %u us, %u bad\n", messageRate,
+                   messages.avgParse_us, messages.rejected);
+  if (connection_ != nullptr) {
+    ConnectionMetrics connection = connection_->metrics();
+    hudSprite.printf("Broker %u up %u fail, outage %u s max\n",
+                     connection.mqttConnects, connection.failedAttempts,
+                     connection.longestOutage_ms / 1000);
+  }
+  hudSprite.printf("Heap %uk free %uk block %uk min\n",
+                   memory.freeHeap / 1024, memory.largestBlock / 1024,
+                   memory.minFreeHeap / 1024);
+  hudSprite.printf("PSRAM %uk free, battery %u mV\n\n",
+                   memory.freePsram / 1024, Battery::voltage_mV());
+
+  hudSprite.setTextColor(TFT_WHITE, TFT_BLACK);
+  hudSprite.printf("%-16s %5s %6s\n", "Task", "CPU", "Stack");
+  hudSprite.setTextColor(TFT_GREEN, TFT_BLACK);
+  for (const auto &task : tasks) {
+    if (hudSprite.getCursorY() + 8 > height_) {
+      break;
+    }
+    if (task.cpu < 0) {
+      hudSprite.printf("%-16s %5s %6u\n", task.name, "-", task.stackFree);
+    } else {
+      hudSprite.printf("%-16s %4.0f%% %6u\n", task.name, task.cpu * 100,
+                       task.stackFree);
+    }
+  }
+
+  frameBytes_ = pushSprite(hudSprite);
+}
 
-  graphSprite.drawFastVLine(axis_px, 0, height_ - axis_px, TFT_LIGHTGREY);
+void View::recordGrid_(float minValue, float maxValue, int x, int hour) {
+  const int axis_px = 20;
+  auto valueRange = maxValue - minValue;
+  float scalingFactor = static_cast<float>(height_ - axis_px) / (valueRange);
+
+  gridList_.clear();
+  gridList_.drawFastVLine(axis_px, 0, height_ - axis_px, TFT_LIGHTGREY);
 
   auto step = (height_ - axis_px) / static_cast<uint32_t>(valueRange);
-  // log_d("scalingFactor: %.2f, valueRange: %.2f, step: %u", scalingFactor,
-  //       valueRange, step);
 
   // draw horizontal grid lines with their y-axis value label
   uint32_t y;
-  graphSprite.setTextDatum(MR_DATUM);
-  graphSprite.loadFont(small);
+  char buf[12];
+  gridList_.setTextDatum(MR_DATUM);
+  gridList_.loadFont(small);
   for (uint32_t i = 0; i < height_ - axis_px; i += step) {
     y = height_ - axis_px - i;
-    graphSprite.drawFastHLine(axis_px, y, width_, TFT_LIGHTGREY);
+    gridList_.drawFastHLine(axis_px, y, width_, TFT_LIGHTGREY);
     auto labelValue = (i / scalingFactor) + minValue;
-    graphSprite.drawFloat(labelValue, 0, axis_px - 2, y);
+    snprintf(buf, sizeof(buf), "%ld", lroundf(labelValue));
+    gridList_.drawString(buf, axis_px - 2, y);
   }
 
-  int graphWidth = width_ - axis_px;
-  time_t per_division_secs = HOURS_PER_DIVISION * SECS_PER_HOUR;
-  float xScalingFactor =
-      graphWidth / static_cast<float>(datapointInterval_secs * MAX_DATAPOINTS);
-
-  time_t now = time(nullptr);
-  tm time_buf;
-  localtime_r(&now, &time_buf);
-  time_buf.tm_min = 0;
-  time_buf.tm_sec = 0;
-
-  time_t wholeHour = mktime(&time_buf);
-  int x = width_ - 1 - PIXELS_PER_HOUR * (now - wholeHour) / SECS_PER_HOUR;
-
-  int hour = time_buf.tm_hour;
-  graphSprite.setTextDatum(BC_DATUM);
-  char buf[8];
+  gridList_.setTextDatum(BC_DATUM);
 
   while (x > axis_px) {
-    graphSprite.drawFastVLine(x, 0, height_ - axis_px, TFT_LIGHTGREY);
+    gridList_.drawFastVLine(x, 0, height_ - axis_px, TFT_LIGHTGREY);
     snprintf(buf, sizeof(buf), "%02d:00", hour);
-    graphSprite.drawString(buf, x, height_ - 1);
+    gridList_.drawString(buf, x, height_ - 1);
 
     hour -= HOURS_PER_DIVISION;
     if (hour < 0) {
@@ -258,22 +455,5 @@ void View::renderGraphPage_(GraphType graphType) {
     x -= 60;
   }
 
-  x = width_;
-  std::for_each(
-      vm_.datapoints.rbegin(), vm_.datapoints.rend(), [&](const auto &dp) {
-        float value =
-            graphType == GraphType::Temperature ? dp.temperature : dp.humidity;
-        float scaledValue = std::round((value - minValue) * scalingFactor);
-        uint32_t y = static_cast<uint32_t>(scaledValue);
-        graphSprite.fillCircle(--x, height_ - y - axis_px, 2, TFT_RED);
-      });
-
-  graphSprite.loadFont(large);
-  graphSprite.setTextDatum(TL_DATUM);
-  graphSprite.setTextColor(TFT_WHITE, TFT_LIGHTGREY, true);
-  graphSprite.drawString(vm_.sensorLocation, axis_px + 8, 8);
-
-  graphSprite.pushToSprite(&displaySprite, 0, 0);
-
-  displaySprite.pushSprite(0, 0);
+  gridList_.optimise();
 }
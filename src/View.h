@@ -1,20 +1,26 @@
 #pragma once
 #include "DataModel.h"
+#include "FrameScheduler.h"
 #include "IView.h"
 #include <Arduino.h>
 #include <TFT_eSPI.h>
 
+class ConnectionManager;
+
 enum class GraphType { Temperature, Humidity };
 
 class View : IView {
 public:
   View(uint32_t width, uint32_t height, DataModel &dataModel);
   void init();
-  virtual void update(uint16_t sensorId) override;
+  virtual void update(const std::vector<uint16_t> &sensorIds) override;
   void updateTask(void *param);
   void nextPage();
   void nextSensor();
   void incrementDisconnects();
+  // Shows the connection metrics on the diagnostics page
+  void setConnection(const ConnectionManager *connection);
+  FrameStats frameStats() const;
 
 private:
   uint32_t width_;
@@ -24,12 +30,35 @@ private:
   uint32_t updateCounter_{0};
   uint32_t pageIndex_{0};
   uint32_t disconnectCount_{0};
+  const ConnectionManager *connection_{nullptr};
   uint16_t currentSensorId_{0};
+  // Graph column of the last graph frame, the graph only moves when it changes
+  uint32_t graphColumn_{0};
+  // Only used on the display task
   ViewModel vm_;
+  // Guards the page and sensor shown, which change on other tasks
   SemaphoreHandle_t mutex_{xSemaphoreCreateMutex()};
+  FrameScheduler frames_;
   uint16_t customGreen_;
+  TFT_eDisplayList gridList_;
+  int32_t gridKey_[4]{};
+  // Graph layers recorded each frame, replayed around the grid by a band
+  // renderer with a worker on each core
+  TFT_eDisplayList gapList_;
+  TFT_eDisplayList pointList_;
+  TFT_eBandRenderer bands_;
+  // Layouts of the labels that repeat between renders, such as the location.
+  // Readings change with every message and are drawn without it.
+  TFT_eTextCache labelCache_;
+  // Pixel data size of the last frame pushed, the nominal bytes sent
+  uint32_t frameBytes_{0};
+  // Message count at the last diagnostics frame, for the message rate
+  uint32_t hudMessages_{0};
+  int64_t hudTime_us_{0};
 
-  void render_();
+  bool render_(uint32_t reasons);
   void renderMainPage_();
   void renderGraphPage_(GraphType graphType);
+  void renderDiagnosticsPage_();
+  void recordGrid_(float minValue, float maxValue, int x, int hour);
 };
\ No newline at end of file
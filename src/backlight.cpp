@@ -1,54 +1,148 @@
 #include "backlight.h"
 #include "pin_config.h"
 #include <Arduino.h>
+#include <algorithm>
+#include <cmath>
+#include <esp_timer.h>
+
+#define BACKLIGHT_CHANNEL 0
+#define BACKLIGHT_PIN 38
+#define BACKLIGHT_PWM_HZ 10000
+#define BACKLIGHT_PWM_BITS 12
+#define BACKLIGHT_GAMMA 2.2f
+// Fade steps, 50 per second
+#define BACKLIGHT_STEP_US 20000
+#define BACKLIGHT_IDLE_MS 60000
+#define BACKLIGHT_DEFAULT_LEVEL 0.5f
+#define BACKLIGHT_MIN_LEVEL 0.05f
+#define BACKLIGHT_DIM_LEVEL 0.15f
+// Level change per second, holding a button goes through the full range in
+// about 2.5 seconds
+#define BACKLIGHT_ADJUST_RATE 0.4f
+#define BACKLIGHT_DIM_RATE 0.2f
+#define BACKLIGHT_WAKE_RATE 2.0f
 
 namespace Backlight {
-TaskHandle_t taskHandle;
-uint32_t brightness = 50;
+namespace {
+esp_timer_handle_t timer;
+SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+float level = 0;  // Level shown
+float target = 0; // Level being faded to
+float rate = 0;   // Level change per second of the fade
+float userLevel = BACKLIGHT_DEFAULT_LEVEL;
+uint32_t duty = UINT32_MAX;
+int64_t lastStep_us = 0;
+int64_t lastActivity_us = 0;
+bool dimmed = false;
 
-void init() {
-  // Set initial TFT brightness
-  ledcSetup(0, 10000, 8);
-  ledcAttachPin(38, 0);
-  ledcWrite(0, brightness);
+void write_() {
+  const uint32_t maxDuty = (1 << BACKLIGHT_PWM_BITS) - 1;
+  uint32_t newDuty = lroundf(powf(level, BACKLIGHT_GAMMA) * maxDuty);
+  if (newDuty != duty) {
+    duty = newDuty;
+    ledcWrite(BACKLIGHT_CHANNEL, duty);
+  }
 }
 
-void changeBrightnessTask(void *param) {
-  auto delta = reinterpret_cast<int>(param);
-
-  for (;;) {
-    brightness += delta;
-    ledcWrite(0, brightness);
-    delay(100);
+// Arms the timer for the next fade step, or for the end of the idle time when
+// there is no fade. Called with the mutex taken.
+void schedule_() {
+  esp_timer_stop(timer);
+  if (level != target) {
+    esp_timer_start_once(timer, BACKLIGHT_STEP_US);
+  } else if (!dimmed) {
+    int64_t idle_us = esp_timer_get_time() - lastActivity_us;
+    esp_timer_start_once(
+        timer, std::max<int64_t>(BACKLIGHT_IDLE_MS * 1000LL - idle_us, 0));
   }
 }
 
-void startIncreaseBrightness() {
-  if (!taskHandle) {
-    BaseType_t rc = xTaskCreatePinnedToCore(changeBrightnessTask, "backlight",
-                                            2400, (void *)1, 1, &taskHandle, 1);
-    assert(rc == pdPASS);
-  }
+void fade_(float newTarget, float newRate) {
+  target = std::clamp(newTarget, 0.0f, 1.0f);
+  rate = newRate;
+  lastStep_us = esp_timer_get_time();
+  schedule_();
 }
 
-void stopIncreaseBrightness() {
-  if (taskHandle) {
-    vTaskDelete(taskHandle);
-    taskHandle = nullptr;
+void onTimer_(void *arg) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  int64_t now_us = esp_timer_get_time();
+  if (level != target) {
+    // Steps follow the time passed, so a late timer does not slow the fade
+    float step = rate * (now_us - lastStep_us) / 1e6f;
+    lastStep_us = now_us;
+    level = level < target ? std::min(level + step, target)
+                           : std::max(level - step, target);
+    write_();
+  } else if (!dimmed &&
+             now_us - lastActivity_us >= BACKLIGHT_IDLE_MS * 1000LL) {
+    dimmed = true;
+    fade_(std::min(userLevel, BACKLIGHT_DIM_LEVEL), BACKLIGHT_DIM_RATE);
   }
+  schedule_();
+  xSemaphoreGive(mutex);
 }
 
-void startDecreaseBrightness() {
-  if (!taskHandle) {
-    BaseType_t rc = xTaskCreatePinnedToCore(
-        changeBrightnessTask, "backlight", 2400, (void *)-1, 1, &taskHandle, 1);
-    assert(rc == pdPASS);
-  }
+void startAdjust_(float newTarget) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  dimmed = false;
+  lastActivity_us = esp_timer_get_time();
+  fade_(newTarget, BACKLIGHT_ADJUST_RATE);
+  xSemaphoreGive(mutex);
+}
+
+void stopAdjust_() {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  userLevel = level;
+  lastActivity_us = esp_timer_get_time();
+  fade_(level, 0);
+  xSemaphoreGive(mutex);
+}
+} // namespace
+
+void init() {
+  ledcSetup(BACKLIGHT_CHANNEL, BACKLIGHT_PWM_HZ, BACKLIGHT_PWM_BITS);
+  ledcAttachPin(BACKLIGHT_PIN, BACKLIGHT_CHANNEL);
+
+  esp_timer_create_args_t args = {};
+  args.callback = onTimer_;
+  args.name = "backlight";
+  ESP_ERROR_CHECK(esp_timer_create(&args, &timer));
+
+  // Fade in from off
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  write_();
+  lastActivity_us = esp_timer_get_time();
+  fade_(userLevel, BACKLIGHT_WAKE_RATE);
+  xSemaphoreGive(mutex);
+}
+
+void fadeTo(float newLevel, float newRate) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  userLevel = std::clamp(newLevel, BACKLIGHT_MIN_LEVEL, 1.0f);
+  lastActivity_us = esp_timer_get_time();
+  dimmed = false;
+  fade_(userLevel, newRate);
+  xSemaphoreGive(mutex);
 }
-void stopDecreaseBrightness() {
-  if (taskHandle) {
-    vTaskDelete(taskHandle);
-    taskHandle = nullptr;
+
+void activity() {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  lastActivity_us = esp_timer_get_time();
+  if (dimmed) {
+    dimmed = false;
+    fade_(userLevel, BACKLIGHT_WAKE_RATE);
+  } else {
+    schedule_();
   }
+  xSemaphoreGive(mutex);
 }
-} // namespace Backlight
\ No newline at end of file
+
+void startIncreaseBrightness() { startAdjust_(1.0f); }
+
+void stopIncreaseBrightness() { stopAdjust_(); }
+
+void startDecreaseBrightness() { startAdjust_(BACKLIGHT_MIN_LEVEL); }
+
+void stopDecreaseBrightness() { stopAdjust_(); }
+} // namespace Backlight
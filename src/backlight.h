@@ -1,9 +1,18 @@
 #pragma once
+#include <stdint.h>
 
+// Backlight brightness, faded by a timer. Levels are perceived brightness from
+// 0 to 1 and are gamma corrected to the PWM duty, so fades look even. After
+// BACKLIGHT_IDLE_MS without activity the backlight dims, and activity fades it
+// back to the level set by the user.
 namespace Backlight {
 void init();
+// Fades to level, changing by rate per second, and makes it the user level
+void fadeTo(float level, float rate);
+// Wakes the backlight from idle dimming and restarts the idle time
+void activity();
 void startIncreaseBrightness();
 void stopIncreaseBrightness();
 void startDecreaseBrightness();
 void stopDecreaseBrightness();
-} // namespace Backlight
\ No newline at end of file
+} // namespace Backlight
@@ -1,4 +1,6 @@
+#include "Battery.h"
 #include <array>
+#include <cstddef>
 #include <utility>
 
 // https://blog.ampow.com/lipo-voltage-chart/
@@ -9,9 +11,17 @@ const std::array<std::pair<uint32_t, uint32_t>, 21> voltage_to_percentage{
      {3690, 10},  {3610, 5},  {3270, 0}}};
 
 uint32_t getBatteryCharge(uint32_t voltage) {
-  for (auto entry : voltage_to_percentage) {
-    if (voltage >= entry.first) {
-      return entry.second;
+  if (voltage >= voltage_to_percentage.front().first) {
+    return voltage_to_percentage.front().second;
+  }
+  for (size_t i = 1; i < voltage_to_percentage.size(); i++) {
+    const auto &[highVoltage, highPercentage] = voltage_to_percentage[i - 1];
+    const auto &[lowVoltage, lowPercentage] = voltage_to_percentage[i];
+    if (voltage >= lowVoltage) {
+      return lowPercentage + ((voltage - lowVoltage) *
+                                  (highPercentage - lowPercentage) +
+                              (highVoltage - lowVoltage) / 2) /
+                                 (highVoltage - lowVoltage);
     }
   }
   return 0;
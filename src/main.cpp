@@ -1,5 +1,12 @@
+#include "AllocProfiler.h"
+#include "Battery.h"
+#include "ConnectionManager.h"
 #include "Controller.h"
 #include "DataModel.h"
+#include "Diagnostics.h"
+#include "HistoryLog.h"
+#include "TopicRouter.h"
+#include "Trace.h"
 #include "View.h"
 #include "backlight.h"
 #include "pin_config.h"
@@ -7,6 +14,7 @@
 #include <Arduino.h>
 #include <PubSubClient.h>
 #include <WiFi.h>
+#include <esp_timer.h>
 #include <stdlib.h>
 
 #define MQTT_PORT 1883
@@ -17,15 +25,28 @@ const char *ssid = WIFI_SSID;
 const char *password = WIFI_PASSWORD;
 const char *mqttServer = MQTT_SERVER;
 const char *ntpServer = "time.google.com";
+const char *sensorTopic = "/home/sensors/+";
 
 auto wifiClient = WiFiClient{};
 auto pubSubClient = PubSubClient{wifiClient};
+auto connection = ConnectionManager{pubSubClient, wifiClient, ssid,
+                                    password,     mqttServer, MQTT_PORT,
+                                    sensorTopic};
 auto dataModel = DataModel{};
+auto history = HistoryLog{};
 auto view = View{TFT_WIDTH, TFT_HEIGHT, dataModel};
 auto controller = Controller{};
+auto router = TopicRouter{};
 
-void nextPage() { view.nextPage(); }
-void nextSensor() { view.nextSensor(); }
+void nextPage() {
+  Backlight::activity();
+  view.nextPage();
+}
+
+void nextSensor() {
+  Backlight::activity();
+  view.nextSensor();
+}
 
 button_handlers_t buttonEventHandlers = {
     .io14_handleClick = nextSensor,
@@ -37,85 +58,63 @@ button_handlers_t buttonEventHandlers = {
     .boot_handleLongPressStart = Backlight::startDecreaseBrightness,
     .boot_handleLongPressStop = Backlight::stopDecreaseBrightness};
 
-void reconnect() {
-  while (WiFi.status() != WL_CONNECTED) {
-    uint16_t innerRetry = 0;
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(ssid, password);
-    while (WiFi.status() != WL_CONNECTED && innerRetry++ < 4) {
-      log_d("WiFi status retry: %u", innerRetry);
-      delay(500);
-    }
-    if (WiFi.status() == WL_CONNECTED) {
-      break;
-    } else {
-      WiFi.disconnect();
-      delay(500);
-    }
-  }
-
-  if (!pubSubClient.connected()) {
-    log_d("Attempting MQTT connection...");
-    // Create a random pubSubClient ID
-    String clientId = "esp32client-" + String(random(0xffff), HEX);
-    // Attempt to connect
-    if (pubSubClient.connect(clientId.c_str())) {
-      log_d("...connected");
-      auto success = pubSubClient.subscribe("/home/sensors/+");
-      assert(success);
-    } else {
-      view.incrementDisconnects();
-      log_e("Could not connect to MQTT server, rc=%d", pubSubClient.state());
-      delay(5000);
-      WiFi.disconnect();
-    }
-  }
-}
-
 void mqttCallback(char *topic, byte *payloadRaw, unsigned int length) {
-  dataModel.mqttUpdate(topic, payloadRaw, length);
+  TRACE_SCOPE("mqtt receive");
+  ALLOC_SCOPE("mqtt");
+  log_d("[%s] %.*s", topic, length, payloadRaw);
+  if (router.dispatch(topic, payloadRaw, length) == 0) {
+    log_d("No handler for %s", topic);
+  }
 }
 
 } // namespace
 
 void setup() {
   Serial.begin(115200);
+  Trace::begin();
 
   // Enable battery
   pinMode(15, OUTPUT);
   digitalWrite(15, HIGH);
+  Battery::init();
 
   view.init();
   Backlight::init();
 
-  controller.setHandlers(buttonEventHandlers);
+  // Restore the sensor history saved before the last reset
+  history.begin();
+  dataModel.setHistory(&history);
 
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(ssid, password);
-
-  while (WiFi.status() != WL_CONNECTED) {
-    log_d("WiFi not connected");
-    delay(500);
-  }
+  controller.setHandlers(buttonEventHandlers);
 
-  log_i("WiFi connected: %s", WiFi.localIP().toString().c_str());
+  // WiFi and the MQTT server are connected from loop() by the connection
+  // manager
+  pubSubClient.setCallback(mqttCallback);
+  router.subscribe<SensorBatch>(
+      sensorTopic,
+      [](const uint8_t *payload, unsigned int length, SensorBatch &batch) {
+        int64_t start_us = esp_timer_get_time();
+        if (!DataModel::decode(payload, length, batch)) {
+          Diagnostics::messageRejected();
+          return false;
+        }
+        Diagnostics::messageParsed(esp_timer_get_time() - start_us);
+        return true;
+      },
+      [](const TopicMatch &topic, const SensorBatch &batch) {
+        dataModel.sensorUpdate(topic.last(), batch);
+      });
+  connection.setDisconnectHandler([] { view.incrementDisconnects(); });
+  view.setConnection(&connection);
+  connection.begin();
 
   // Timezone for Amsterdam
 
-  // Get system time from NTP server
+  // Get system time from NTP server, it is synchronised once WiFi is up
   configTime(0, 0, ntpServer);
   setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
   tzset();
 
-  tm timeinfo;
-  if (getLocalTime(&timeinfo)) {
-    Serial.println(&timeinfo, "%A, %B %d %Y %H:%M:%S");
-  }
-
-  // Configure MQTT server connection
-  pubSubClient.setServer(mqttServer, MQTT_PORT);
-  pubSubClient.setCallback(mqttCallback);
-
   auto rc = xTaskCreatePinnedToCore(
       +[](void *param) { controller.controllerTask(param); }, "controller",
       8192, nullptr, 1, nullptr, 1);
@@ -128,12 +127,19 @@ void setup() {
 }
 
 void loop() {
-  if (!pubSubClient.connected()) {
-    reconnect();
+  connection.poll();
+
+  // Send 't' on the serial port for a Chrome trace of the last events, 'a'
+  // for the allocations by scope
+  switch (Serial.available() > 0 ? Serial.read() : -1) {
+  case 't':
+    Trace::dump(Serial);
+    break;
+  case 'a':
+    AllocProfiler::report(Serial);
+    break;
   }
 
-  pubSubClient.loop();
-
   // Give idle task some execution time
   delay(1);
 }
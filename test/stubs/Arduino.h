@@ -0,0 +1,406 @@
+#pragma once
+// Host stand-ins for the parts of the Arduino ESP32 core the application
+// uses, so the modules without hardware access build for the native tests.
+// Time and randomness are driven by the tests.
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <math.h>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef uint8_t byte;
+typedef bool boolean;
+using std::max;
+using std::min;
+
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define pgm_read_word(address) (*(const uint16_t *)(address))
+#define pgm_read_dword(address) (*(const uint32_t *)(address))
+#define pgm_read_ptr(address) (*(void *const *)(address))
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define HEX 16
+#define DEC 10
+
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline int digitalRead(int) { return 0; }
+inline uint32_t digitalPinToBitMask(int) { return 0; }
+
+enum adc_attenuation_t { ADC_0db, ADC_2_5db, ADC_6db, ADC_11db };
+inline uint16_t analogRead(int) { return 0; }
+inline void analogSetPinAttenuation(int, adc_attenuation_t) {}
+
+inline void logDiscard(const char *format, ...) {}
+#define log_e(format, ...) logDiscard(format, ##__VA_ARGS__)
+#define log_w log_e
+#define log_i log_e
+#define log_d log_e
+#define log_v log_e
+
+// Milliseconds since boot, advanced by the tests
+inline uint32_t fakeMillis = 0;
+// Returns the value of random(range) when set, rand() % range otherwise
+inline long (*fakeRandom)(long range) = nullptr;
+
+inline unsigned long millis() { return fakeMillis; }
+inline void delay(uint32_t ms) { fakeMillis += ms; }
+inline void yield() {}
+inline void delayMicroseconds(uint32_t) {}
+
+// The host clock, for measuring code under test, wraps at 32 bits as on the
+// ESP32
+inline unsigned long micros() {
+  using namespace std::chrono;
+  return static_cast<uint32_t>(
+      duration_cast<microseconds>(steady_clock::now().time_since_epoch())
+          .count());
+}
+
+inline long random(long range) {
+  if (range <= 0) {
+    return 0;
+  }
+  return fakeRandom != nullptr ? fakeRandom(range) : rand() % range;
+}
+
+inline long random(long low, long high) { return low + random(high - low); }
+
+// In glibc from 2.38
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+inline size_t strlcpy(char *dst, const char *src, size_t size) {
+  size_t length = strlen(src);
+  if (size > 0) {
+    size_t copied = std::min(length, size - 1);
+    memcpy(dst, src, copied);
+    dst[copied] = '\0';
+  }
+  return length;
+}
+#endif
+
+inline char *ltoa(long value, char *buf, int base) {
+  sprintf(buf, base == HEX ? "%lx" : "%ld", value);
+  return buf;
+}
+
+class String {
+public:
+  String() = default;
+  String(const char *text) : text_{text != nullptr ? text : ""} {}
+  String(const char *text, size_t length) : text_{text, length} {}
+  String(const std::string &text) : text_{text} {}
+  String(long value, int base = DEC) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), base == HEX ? "%lx" : "%ld", value);
+    text_ = buf;
+  }
+  String(int value, int base = DEC) : String(static_cast<long>(value), base) {}
+  String(unsigned value, int base = DEC)
+      : String(static_cast<long>(value), base) {}
+
+  const char *c_str() const { return text_.c_str(); }
+  unsigned length() const { return text_.size(); }
+  bool isEmpty() const { return text_.empty(); }
+  char charAt(unsigned index) const { return text_[index]; }
+  void toCharArray(char *buf, unsigned size) const {
+    getBytes(reinterpret_cast<unsigned char *>(buf), size);
+  }
+  void getBytes(unsigned char *buf, unsigned size) const {
+    if (size > 0) {
+      size_t length = std::min<size_t>(text_.size(), size - 1);
+      memcpy(buf, text_.data(), length);
+      buf[length] = 0;
+    }
+  }
+  int lastIndexOf(char c) const {
+    size_t index = text_.rfind(c);
+    return index == std::string::npos ? -1 : static_cast<int>(index);
+  }
+  String substring(unsigned from) const { return text_.substr(from); }
+  bool endsWith(const String &suffix) const {
+    return text_.size() >= suffix.text_.size() &&
+           text_.compare(text_.size() - suffix.text_.size(),
+                         suffix.text_.size(), suffix.text_) == 0;
+  }
+  bool operator==(const String &other) const { return text_ == other.text_; }
+  String &operator+=(const String &other) {
+    text_ += other.text_;
+    return *this;
+  }
+  friend String operator+(String left, const String &right) {
+    return left += right;
+  }
+
+private:
+  std::string text_;
+};
+
+class Print {
+public:
+  virtual ~Print() = default;
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (size-- > 0) {
+      n += write(*buffer++);
+    }
+    return n;
+  }
+  size_t print(const char *text) {
+    return write(reinterpret_cast<const uint8_t *>(text), strlen(text));
+  }
+  size_t print(const String &text) { return print(text.c_str()); }
+  size_t println(const char *text = "") { return print(text) + print("\n"); }
+  size_t printf(const char *format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    return write(reinterpret_cast<const uint8_t *>(buf),
+                 std::min<size_t>(std::max(length, 0), sizeof(buf) - 1));
+  }
+};
+
+// FreeRTOS, ticks are milliseconds and tasks are threads
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define portNUM_PROCESSORS 2
+#define configMAX_PRIORITIES 25
+#define tskIDLE_PRIORITY 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+namespace FakeRtos {
+// Waits for ready under lock for up to ticks, forever with portMAX_DELAY
+template <typename Ready>
+bool wait(std::condition_variable &cv, std::unique_lock<std::mutex> &lock,
+          TickType_t ticks, Ready ready) {
+  if (ticks == portMAX_DELAY) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  return cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+}
+} // namespace FakeRtos
+
+// A mutex, or a counting semaphore when max is set
+struct FakeSemaphore {
+  std::mutex mutex;
+  std::condition_variable cv;
+  unsigned count{1};
+  unsigned max{0};
+};
+typedef FakeSemaphore *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new FakeSemaphore; }
+
+inline SemaphoreHandle_t xSemaphoreCreateCounting(unsigned max,
+                                                  unsigned initial) {
+  auto semaphore = new FakeSemaphore;
+  semaphore->count = initial;
+  semaphore->max = max;
+  return semaphore;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore,
+                                 TickType_t ticks) {
+  if (semaphore->max == 0) {
+    semaphore->mutex.lock();
+    return pdTRUE;
+  }
+  std::unique_lock<std::mutex> lock{semaphore->mutex};
+  if (!FakeRtos::wait(semaphore->cv, lock, ticks,
+                      [&] { return semaphore->count > 0; })) {
+    return pdFALSE;
+  }
+  semaphore->count--;
+  return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  if (semaphore->max == 0) {
+    semaphore->mutex.unlock();
+    return pdTRUE;
+  }
+  std::lock_guard<std::mutex> lock{semaphore->mutex};
+  if (semaphore->count == semaphore->max) {
+    return pdFALSE;
+  }
+  semaphore->count++;
+  semaphore->cv.notify_one();
+  return pdTRUE;
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t semaphore) { delete semaphore; }
+
+struct FakeQueue {
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<std::vector<uint8_t>> items;
+  unsigned length;
+  size_t itemSize;
+};
+typedef FakeQueue *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(unsigned length, size_t itemSize) {
+  auto queue = new FakeQueue;
+  queue->length = length;
+  queue->itemSize = itemSize;
+  return queue;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item,
+                             TickType_t ticks) {
+  std::unique_lock<std::mutex> lock{queue->mutex};
+  if (!FakeRtos::wait(queue->cv, lock, ticks, [&] {
+        return queue->items.size() < queue->length;
+      })) {
+    return pdFALSE;
+  }
+  auto bytes = static_cast<const uint8_t *>(item);
+  queue->items.emplace_back(bytes, bytes + queue->itemSize);
+  queue->cv.notify_all();
+  return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item,
+                                TickType_t ticks) {
+  std::unique_lock<std::mutex> lock{queue->mutex};
+  if (!FakeRtos::wait(queue->cv, lock, ticks,
+                      [&] { return !queue->items.empty(); })) {
+    return pdFALSE;
+  }
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  queue->cv.notify_all();
+  return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock{queue->mutex};
+  return queue->items.size();
+}
+
+inline void vQueueDelete(QueueHandle_t queue) { delete queue; }
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *param);
+
+#define configMAX_TASK_NAME_LEN 16
+
+struct TaskStatus_t {
+  TaskHandle_t xHandle;
+  const char *pcTaskName;
+  uint32_t ulRunTimeCounter;
+  uint32_t usStackHighWaterMark;
+};
+
+// Notification state of a task, or of a thread the tests started
+struct FakeTask {
+  std::mutex mutex;
+  std::condition_variable cv;
+  uint32_t notifications{0};
+};
+inline thread_local FakeTask *fakeCurrentTask = nullptr;
+
+// The task runs on a detached thread until its function returns
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function,
+                                          const char *, uint32_t, void *param,
+                                          UBaseType_t, TaskHandle_t *handle,
+                                          BaseType_t) {
+  auto task = new FakeTask;
+  if (handle != nullptr) {
+    *handle = task;
+  }
+  std::thread{[=] {
+    fakeCurrentTask = task;
+    function(param);
+  }}.detach();
+  return pdPASS;
+}
+
+inline void vTaskDelete(TaskHandle_t) {}
+
+inline void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+inline TickType_t xTaskGetTickCount() { return micros() / 1000; }
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (fakeCurrentTask == nullptr) {
+    fakeCurrentTask = new FakeTask;
+  }
+  return fakeCurrentTask;
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t handle) {
+  auto task = static_cast<FakeTask *>(handle);
+  std::lock_guard<std::mutex> lock{task->mutex};
+  task->notifications++;
+  task->cv.notify_all();
+  return pdPASS;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  auto task = static_cast<FakeTask *>(xTaskGetCurrentTaskHandle());
+  std::unique_lock<std::mutex> lock{task->mutex};
+  FakeRtos::wait(task->cv, lock, ticks,
+                 [&] { return task->notifications > 0; });
+  uint32_t notifications = task->notifications;
+  if (notifications > 0) {
+    task->notifications = clear ? 0 : notifications - 1;
+  }
+  return notifications;
+}
+
+inline UBaseType_t uxTaskGetNumberOfTasks() { return 0; }
+
+inline UBaseType_t uxTaskGetSystemState(TaskStatus_t *, UBaseType_t,
+                                        uint32_t *) {
+  return 0;
+}
+
+inline BaseType_t xPortGetCoreID() { return 0; }
+
+inline uint32_t getCpuFrequencyMhz() { return 240; }
+
+struct FakeEsp {
+  uint32_t getCycleCount() const { return micros() * 240; }
+  uint32_t getFreeHeap() const { return 256 * 1024; }
+  uint32_t getMinFreeHeap() const { return 200 * 1024; }
+  uint32_t getMaxAllocHeap() const { return 100 * 1024; }
+  uint32_t getFreePsram() const { return 8 * 1024 * 1024; }
+};
+inline FakeEsp ESP;
+
+// Local time from the host clock
+inline bool getLocalTime(struct tm *info, uint32_t = 5000) {
+  time_t now = time(nullptr);
+  localtime_r(&now, info);
+  return true;
+}
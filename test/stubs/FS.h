@@ -0,0 +1,32 @@
+#pragma once
+#include <Arduino.h>
+#include <memory>
+
+namespace fs {
+// A file of the host file system
+class File {
+public:
+  File() = default;
+  explicit File(FILE *file) : file_{file, fclose} {}
+
+  explicit operator bool() const { return file_ != nullptr; }
+  size_t write(const uint8_t *data, size_t size) {
+    return fwrite(data, 1, size, file_.get());
+  }
+  size_t read(uint8_t *data, size_t size) {
+    return fread(data, 1, size, file_.get());
+  }
+  size_t size() const {
+    long position = ftell(file_.get());
+    fseek(file_.get(), 0, SEEK_END);
+    long size = ftell(file_.get());
+    fseek(file_.get(), position, SEEK_SET);
+    return size;
+  }
+  void flush() { fflush(file_.get()); }
+  void close() { file_.reset(); }
+
+private:
+  std::shared_ptr<FILE> file_;
+};
+} // namespace fs
@@ -0,0 +1,36 @@
+#pragma once
+#include <FS.h>
+#include <filesystem>
+#include <unistd.h>
+
+// LittleFS in a directory of the host, emptied by format()
+class FakeLittleFS {
+public:
+  bool begin(bool formatOnFail) {
+    std::error_code error;
+    std::filesystem::create_directories(root_, error);
+    return !error;
+  }
+  bool format() {
+    std::error_code error;
+    std::filesystem::remove_all(root_, error);
+    return begin(true);
+  }
+  bool exists(const char *path) { return std::filesystem::exists(at_(path)); }
+  fs::File open(const char *path, const char *mode) {
+    FILE *file = fopen(at_(path).c_str(), mode);
+    return file != nullptr ? fs::File{file} : fs::File{};
+  }
+  bool rename(const char *from, const char *to) {
+    return ::rename(at_(from).c_str(), at_(to).c_str()) == 0;
+  }
+  bool remove(const char *path) { return ::remove(at_(path).c_str()) == 0; }
+
+private:
+  std::filesystem::path root_{std::filesystem::temp_directory_path() /
+                              ("littlefs-" + std::to_string(getpid()))};
+
+  std::string at_(const char *path) { return root_.string() + path; }
+};
+
+inline FakeLittleFS LittleFS;
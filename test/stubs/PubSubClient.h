@@ -0,0 +1,77 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+#define MQTT_CONNECT_UNAUTHORIZED 5
+
+// Broker session behind the fake client, the TCP connection under it is real
+struct FakeBroker {
+  bool up = true;      // Answers CONNECT, clearing it drops the session
+  bool refuse = false; // Answers CONNECT with a refused CONNACK
+  int connects = 0;
+};
+
+inline FakeBroker fakeBroker;
+
+// Speaks to fakeBroker instead of sending MQTT packets. Like PubSubClient 2.8
+// it only opens a connection itself, blocking, when the socket is not
+// connected yet, which the tests count.
+class PubSubClient {
+public:
+  explicit PubSubClient(WiFiClient &client) : client_{client} {}
+
+  void setSocketTimeout(uint16_t timeout) { socketTimeout = timeout; }
+
+  bool connect(const char *id) {
+    // A session the client believes is up is kept, CONNECT is not sent
+    if (state_ == MQTT_CONNECTED && client_.connected()) {
+      return true;
+    }
+    if (!client_.connected()) {
+      blockingConnects++;
+      state_ = MQTT_CONNECT_FAILED;
+      return false;
+    }
+    if (!fakeBroker.up) {
+      state_ = MQTT_CONNECTION_TIMEOUT;
+      client_.stop();
+      return false;
+    }
+    if (fakeBroker.refuse) {
+      state_ = MQTT_CONNECT_UNAUTHORIZED;
+      return false;
+    }
+    fakeBroker.connects++;
+    state_ = MQTT_CONNECTED;
+    return true;
+  }
+
+  bool subscribe(const char *) { return state_ == MQTT_CONNECTED; }
+
+  bool loop() {
+    if (state_ == MQTT_CONNECTED && !fakeBroker.up) {
+      state_ = MQTT_CONNECTION_LOST;
+      client_.stop();
+    }
+    return state_ == MQTT_CONNECTED;
+  }
+
+  void disconnect() {
+    state_ = MQTT_DISCONNECTED;
+    client_.stop();
+  }
+
+  int state() { return state_; }
+
+  uint16_t socketTimeout = 15;
+  int blockingConnects = 0;
+
+private:
+  WiFiClient &client_;
+  int state_{MQTT_DISCONNECTED};
+};
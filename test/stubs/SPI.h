@@ -0,0 +1,32 @@
+#pragma once
+#include <Arduino.h>
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+// Accepts and discards all transfers, the tests draw into Sprites
+struct SPISettings {
+  SPISettings(uint32_t = 0, int = 0, int = 0) {}
+};
+
+class SPIClass {
+public:
+  void begin(int = -1, int = -1, int = -1, int = -1) {}
+  void end() {}
+  void beginTransaction(SPISettings) {}
+  void endTransaction() {}
+  void setFrequency(uint32_t) {}
+  void setBitOrder(int) {}
+  void setDataMode(int) {}
+  void setHwCs(bool) {}
+  uint8_t transfer(uint8_t) { return 0; }
+  void transfer(void *, uint32_t) {}
+  uint16_t transfer16(uint16_t) { return 0; }
+  void write(uint8_t) {}
+  void write16(uint16_t) {}
+  void write32(uint32_t) {}
+  void writeBytes(const uint8_t *, uint32_t) {}
+  void writePattern(const uint8_t *, uint8_t, uint32_t) {}
+};
+
+inline SPIClass SPI;
@@ -0,0 +1,77 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+#include <memory>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+enum arduino_event_id_t {
+  ARDUINO_EVENT_WIFI_STA_GOT_IP,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED
+};
+struct arduino_event_info_t {};
+enum wifi_mode_t { WIFI_OFF, WIFI_STA };
+
+struct IPAddress {
+  String toString() const { return "192.168.1.2"; }
+};
+
+// Shares a socket between copies and closes it with the last one, like the
+// ESP32 WiFiClient
+class WiFiClient {
+public:
+  WiFiClient() = default;
+  explicit WiFiClient(int fd)
+      : fd_{new int{fd}, [](int *fd) {
+              close(*fd);
+              delete fd;
+            }} {}
+  uint8_t connected() { return fd_ != nullptr; }
+  void stop() { fd_.reset(); }
+  int fd() const { return fd_ != nullptr ? *fd_ : -1; }
+
+private:
+  std::shared_ptr<int> fd_;
+};
+
+using WiFiEventHandler =
+    std::function<void(arduino_event_id_t, arduino_event_info_t)>;
+
+// Station that gets an address as soon as it starts while the access point is
+// up, the tests take the link down with setUp(false)
+struct FakeWiFi {
+  bool apUp = true;
+  bool up = false;
+  int begins = 0;
+  std::vector<std::pair<arduino_event_id_t, WiFiEventHandler>> handlers;
+
+  void onEvent(WiFiEventHandler handler, arduino_event_id_t event) {
+    handlers.emplace_back(event, handler);
+  }
+  void mode(wifi_mode_t) {}
+  void begin(const char *, const char *) {
+    begins++;
+    if (apUp) {
+      setUp(true);
+    }
+  }
+  void disconnect() { setUp(false); }
+  IPAddress localIP() { return {}; }
+
+  void setUp(bool state) {
+    if (up == state) {
+      return;
+    }
+    up = state;
+    auto event = up ? ARDUINO_EVENT_WIFI_STA_GOT_IP
+                    : ARDUINO_EVENT_WIFI_STA_DISCONNECTED;
+    for (auto &[id, handler] : handlers) {
+      if (id == event) {
+        handler(event, {});
+      }
+    }
+  }
+};
+
+inline FakeWiFi WiFi;
@@ -0,0 +1,19 @@
+#pragma once
+#include <esp_timer.h>
+
+// Raw ADC readings are taken as millivolts
+enum adc_unit_t { ADC_UNIT_1, ADC_UNIT_2 };
+enum adc_atten_t { ADC_ATTEN_DB_0, ADC_ATTEN_DB_11 = 3 };
+enum adc_bits_width_t { ADC_WIDTH_BIT_12 = 3 };
+struct esp_adc_cal_characteristics_t {};
+
+inline int esp_adc_cal_characterize(adc_unit_t, adc_atten_t, adc_bits_width_t,
+                                    uint32_t,
+                                    esp_adc_cal_characteristics_t *) {
+  return 0;
+}
+inline uint32_t
+esp_adc_cal_raw_to_voltage(uint32_t raw,
+                           const esp_adc_cal_characteristics_t *) {
+  return raw;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <esp_timer.h>
+
+// The host has no idle task, idle hooks are never called
+typedef bool (*esp_freertos_idle_cb_t)();
+inline esp_err_t esp_register_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t,
+                                                         UBaseType_t) {
+  return ESP_OK;
+}
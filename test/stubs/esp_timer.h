@@ -0,0 +1,35 @@
+#pragma once
+#include <Arduino.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_ERROR_CHECK(x) assert((x) == ESP_OK)
+
+// Microseconds since boot from the host clock
+inline int64_t esp_timer_get_time() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Timers are created but never fire, the tests call their callbacks
+typedef void (*esp_timer_cb_t)(void *arg);
+struct esp_timer_create_args_t {
+  esp_timer_cb_t callback;
+  void *arg;
+  const char *name;
+};
+typedef struct esp_timer *esp_timer_handle_t;
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t *,
+                                  esp_timer_handle_t *timer) {
+  *timer = nullptr;
+  return ESP_OK;
+}
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t, uint64_t) {
+  return ESP_OK;
+}
+inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t, uint64_t) {
+  return ESP_OK;
+}
+inline esp_err_t esp_timer_stop(esp_timer_handle_t) { return ESP_OK; }
@@ -0,0 +1,52 @@
+#pragma once
+#include <arpa/inet.h>
+#include <cstdint>
+#include <string>
+
+typedef int8_t err_t;
+#define ERR_OK 0
+#define ERR_INPROGRESS -5
+#define ERR_ARG -16
+
+struct ip_addr_t {
+  uint32_t addr;
+};
+#define IP_IS_V4(address) true
+#define ip_2_ip4(address) (address)
+#define ip4_addr_get_u32(address) ((address)->addr)
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr,
+                                   void *callback_arg);
+
+// Numeric addresses resolve at once like in lwIP, a name stays pending until
+// the test answers it
+struct FakeDns {
+  std::string name;
+  dns_found_callback callback = nullptr;
+  void *arg = nullptr;
+  int lookups = 0;
+
+  // Completes the pending lookup, with nullptr when the name does not exist
+  void answer(const char *address) {
+    ip_addr_t found{};
+    bool valid =
+        address != nullptr && inet_pton(AF_INET, address, &found.addr) == 1;
+    auto pending = callback;
+    callback = nullptr;
+    pending(name.c_str(), valid ? &found : nullptr, arg);
+  }
+};
+
+inline FakeDns fakeDns;
+
+inline err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr,
+                               dns_found_callback found, void *callback_arg) {
+  fakeDns.lookups++;
+  if (inet_pton(AF_INET, hostname, &addr->addr) == 1) {
+    return ERR_OK;
+  }
+  fakeDns.name = hostname;
+  fakeDns.callback = found;
+  fakeDns.arg = callback_arg;
+  return ERR_INPROGRESS;
+}
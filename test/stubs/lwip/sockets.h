@@ -0,0 +1,8 @@
+#pragma once
+// lwIP provides the BSD socket calls on the ESP32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
@@ -0,0 +1,199 @@
+#include "AllocProfiler.h"
+#include "DataModel.h"
+#include "View.h"
+
+#include <new>
+#include <thread>
+#include <unity.h>
+
+// Heap blocks each frame allocates in the "render" scope: the Sprites and the
+// smooth font metrics loaded into them. A change that needs more raises the
+// budget with it, one that needs fewer lowers it.
+#define MAIN_PAGE_ALLOCATIONS 23
+#define GRAPH_PAGE_ALLOCATIONS 8
+#define DIAGNOSTICS_PAGE_ALLOCATIONS 2
+// Added by a frame for new data, which copies the view model with its time
+// series: the deque of a full series and a vector for each of its blocks
+#define VIEW_MODEL_ALLOCATIONS 16
+// Blocks sensorUpdate() allocates per message of a known sensor
+#define MODEL_UPDATE_ALLOCATIONS 1
+
+#define PAGES 4
+#define DIAGNOSTICS_PAGE 3
+
+// The allocations of the standard library reach the wrapped malloc through
+// these
+void *operator new(size_t size) {
+  void *ptr = malloc(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
+// The wall clock of the model and the view, seconds since the epoch. The
+// readings of a day are fed in well under a second.
+time_t fakeNow = 1704067200; // 2024-01-01
+extern "C" time_t __wrap_time(time_t *t) {
+  if (t != nullptr) {
+    *t = fakeNow;
+  }
+  return fakeNow;
+}
+
+namespace {
+DataModel dataModel;
+View view{TFT_WIDTH, TFT_HEIGHT, dataModel};
+const char *topic = "kitchen";
+uint32_t readings = 0;
+
+// The next reading of the sensor, two per datapoint with every value
+// different from the last
+void addReading() {
+  fakeNow += DATAPOINT_SECS / 2;
+  readings++;
+  SensorBatch batch{SensorMessage{
+      .sensorTypeName = "BME280",
+      .temperature = 20.0f + (readings * 37 % 100) / 10.0f,
+      .humidity = 40.0f + (readings * 53 % 200) / 10.0f,
+      .battery = 3600 + readings * 7 % 600}};
+  dataModel.sensorUpdate(TopicLevel{topic, strlen(topic)}, batch);
+}
+
+uint32_t page = 0;
+
+struct Usage {
+  uint32_t frames;
+  uint32_t allocations;
+  int32_t bytes; // Allocated and not freed
+};
+
+Usage renderUsage() {
+  FrameStats frames = view.frameStats();
+  AllocStats render = AllocProfiler::stats("render");
+  return {frames.frames + frames.skipped, render.allocations,
+          static_cast<int32_t>(render.bytes)};
+}
+
+// Runs action and returns the usage of the frames it caused
+template <typename Action> Usage measureFrames(Action action) {
+  Usage before = renderUsage();
+  action();
+  for (int i = 0; i < 2000 && renderUsage().frames == before.frames; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  // Frames invalidated while one was drawn follow it
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  Usage after = renderUsage();
+  return {after.frames - before.frames,
+          after.allocations - before.allocations, after.bytes - before.bytes};
+}
+
+Usage showPage(uint32_t next) {
+  Usage usage{0, 0, 0};
+  while (page != next) {
+    usage = measureFrames([] { view.nextPage(); });
+    page = (page + 1) % PAGES;
+  }
+  return usage;
+}
+
+uint32_t pageBudget(uint32_t index) {
+  return index == 0                  ? MAIN_PAGE_ALLOCATIONS
+         : index == DIAGNOSTICS_PAGE ? DIAGNOSTICS_PAGE_ALLOCATIONS
+                                     : GRAPH_PAGE_ALLOCATIONS;
+}
+
+void assertBudget(const char *what, uint32_t budget, uint32_t calls,
+                  uint32_t allocations) {
+  TEST_ASSERT_GREATER_THAN(0, calls);
+  char message[128];
+  snprintf(message, sizeof(message), "%s: %u blocks in %u calls, budget %u",
+           what, allocations, calls, budget);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(budget * calls, allocations,
+                                           message);
+}
+} // namespace
+
+void setUp() {
+  // The first frame of each page records what later frames reuse
+  for (uint32_t i = 0; i < PAGES; i++) {
+    showPage((page + 1) % PAGES);
+  }
+}
+
+void tearDown() {}
+
+void test_render_frees_what_it_allocates() {
+  for (uint32_t i = 0; i < 2 * PAGES; i++) {
+    Usage usage = showPage((page + 1) % PAGES);
+    TEST_ASSERT_EQUAL_INT32(0, usage.bytes);
+  }
+  Usage usage = measureFrames(addReading);
+  TEST_ASSERT_EQUAL_INT32(0, usage.bytes);
+}
+
+void test_page_frames_within_budget() {
+  for (uint32_t i = 0; i < PAGES; i++) {
+    uint32_t next = (page + 1) % PAGES;
+    Usage usage = showPage(next);
+    char what[32];
+    snprintf(what, sizeof(what), "Page %u", next);
+    assertBudget(what, pageBudget(next), usage.frames, usage.allocations);
+  }
+}
+
+void test_tick_frame_within_budget() {
+  showPage(0);
+  // The clock on the main page is redrawn every second
+  Usage usage = measureFrames(
+      [] { std::this_thread::sleep_for(std::chrono::milliseconds(1100)); });
+  assertBudget("Tick", MAIN_PAGE_ALLOCATIONS, usage.frames,
+               usage.allocations);
+}
+
+void test_data_frame_within_budget() {
+  showPage(0);
+  // New values on every label, and datapoints completed on every other
+  // reading
+  for (int i = 0; i < 4; i++) {
+    Usage usage = measureFrames(addReading);
+    assertBudget("Data", MAIN_PAGE_ALLOCATIONS + VIEW_MODEL_ALLOCATIONS,
+                 usage.frames, usage.allocations);
+  }
+}
+
+void test_model_update_within_budget() {
+  AllocStats before = AllocProfiler::stats("model");
+  for (int i = 0; i < 100; i++) {
+    addReading();
+  }
+  AllocStats after = AllocProfiler::stats("model");
+  assertBudget("Model update", MODEL_UPDATE_ALLOCATIONS, 100,
+               after.allocations - before.allocations);
+  TEST_ASSERT_EQUAL(before.bytes, after.bytes);
+}
+
+int main() {
+  // A full time series, as held after a week in the field
+  while (readings < 2 * MAX_DATAPOINTS + 2) {
+    addReading();
+  }
+  view.init();
+  xTaskCreatePinnedToCore([](void *) { view.updateTask(nullptr); }, "view",
+                          8192, nullptr, 1, nullptr, 1);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_render_frees_what_it_allocates);
+  RUN_TEST(test_page_frames_within_budget);
+  RUN_TEST(test_tick_frame_within_budget);
+  RUN_TEST(test_data_frame_within_budget);
+  RUN_TEST(test_model_update_within_budget);
+  return UNITY_END();
+}
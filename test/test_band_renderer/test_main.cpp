@@ -0,0 +1,151 @@
+#include <TFT_eSPI.h>
+
+#include "NotoSansBold15.h"
+#include <cmath>
+#include <thread>
+#include <unity.h>
+
+#define WIDTH 320
+#define HEIGHT 170
+#define FRAMES 200
+
+namespace {
+TFT_eSPI tft;
+TFT_eDisplayList gapList;
+TFT_eDisplayList gridList;
+TFT_eDisplayList pointList;
+
+// The lists of a graph frame, as recorded by the View
+void recordGraph() {
+  gapList.clear();
+  gapList.fillScreen(TFT_BLACK);
+  for (int x = 40; x < WIDTH; x += 70) {
+    gapList.fillRect(x, 0, 12, HEIGHT - 20, TFT_DARKGREY);
+  }
+
+  gridList.clear();
+  gridList.drawFastVLine(20, 0, HEIGHT - 20, TFT_LIGHTGREY);
+  gridList.setTextColor(TFT_WHITE, TFT_BLACK);
+  gridList.setTextDatum(MR_DATUM);
+  gridList.loadFont(NotoSansBold15);
+  char label[8];
+  for (int y = HEIGHT - 20; y > 0; y -= 25) {
+    gridList.drawFastHLine(20, y, WIDTH, TFT_LIGHTGREY);
+    snprintf(label, sizeof(label), "%d", y / 5);
+    gridList.drawString(label, 18, y);
+  }
+  gridList.setTextDatum(BC_DATUM);
+  for (int x = WIDTH - 20, hour = 23; x > 20; x -= 60, hour -= 2) {
+    gridList.drawFastVLine(x, 0, HEIGHT - 20, TFT_LIGHTGREY);
+    snprintf(label, sizeof(label), "%02d:00", hour);
+    gridList.drawString(label, x, HEIGHT - 1);
+  }
+  gridList.optimise();
+
+  pointList.clear();
+  for (int x = 21; x < WIDTH; x++) {
+    int y = 75 + lroundf(60 * sinf(x / 20.0f));
+    pointList.fillCircle(x, y, 2, TFT_RED);
+  }
+}
+
+void renderDirect(TFT_eSprite &sprite) {
+  gapList.replay(&sprite);
+  gridList.replay(&sprite);
+  pointList.replay(&sprite);
+}
+
+void addLists(TFT_eBandRenderer &bands) {
+  bands.clear();
+  bands.add(&gapList);
+  bands.add(&gridList);
+  bands.add(&pointList);
+}
+
+// Microseconds per frame over FRAMES renders
+uint32_t timeBands(TFT_eBandRenderer &bands, TFT_eSprite &sprite) {
+  bands.render(&sprite);
+  uint32_t start = micros();
+  for (int i = 0; i < FRAMES; i++) {
+    bands.render(&sprite);
+  }
+  return (micros() - start) / FRAMES;
+}
+} // namespace
+
+void setUp() { recordGraph(); }
+
+void tearDown() {}
+
+void test_bands_match_direct_replay() {
+  auto expected = TFT_eSprite(&tft);
+  auto actual = TFT_eSprite(&tft);
+  TEST_ASSERT_NOT_NULL(expected.createSprite(WIDTH, HEIGHT));
+  TEST_ASSERT_NOT_NULL(actual.createSprite(WIDTH, HEIGHT));
+  renderDirect(expected);
+  size_t size = WIDTH * HEIGHT * sizeof(uint16_t);
+
+  for (uint8_t count = 1; count <= BR_MAX_BANDS; count++) {
+    TFT_eBandRenderer bands;
+    TEST_ASSERT_TRUE(bands.begin(count));
+    addLists(bands);
+    // The second frame replays the lists into band Sprites with the font loaded
+    for (int frame = 0; frame < 2; frame++) {
+      actual.fillSprite(TFT_BLUE);
+      bands.render(&actual);
+      TEST_ASSERT_EQUAL_MEMORY(expected.getPointer(), actual.getPointer(),
+                               size);
+    }
+  }
+}
+
+void test_bands_scale_with_cores() {
+  auto sprite = TFT_eSprite(&tft);
+  TEST_ASSERT_NOT_NULL(sprite.createSprite(WIDTH, HEIGHT));
+
+  TFT_eBandRenderer one;
+  TEST_ASSERT_TRUE(one.begin(1));
+  addLists(one);
+  uint32_t one_us = timeBands(one, sprite);
+
+  TFT_eBandRenderer two;
+  TEST_ASSERT_TRUE(two.begin(2));
+  addLists(two);
+  uint32_t two_us = timeBands(two, sprite);
+
+  char message[96];
+  snprintf(message, sizeof(message),
+           "1 band %u us/frame, 2 bands %u us/frame (%u + %u us)", one_us,
+           two_us, two.bandTime(0), two.bandTime(1));
+  TEST_MESSAGE(message);
+
+  // The split only pays off with a core per band
+  if (std::thread::hardware_concurrency() < 2) {
+    TEST_IGNORE_MESSAGE("Needs 2 cores to measure the scaling");
+  }
+  TEST_ASSERT_LESS_THAN(one_us * 8 / 10, two_us);
+}
+
+void test_font_reload_is_skipped() {
+  auto sprite = TFT_eSprite(&tft);
+  sprite.loadFont(NotoSansBold15);
+  uint16_t *metrics = sprite.gUnicode;
+  // A reload would decode the metrics again and restore the line advance
+  sprite.gFont.yAdvance = 0;
+  sprite.loadFont(NotoSansBold15);
+  TEST_ASSERT_TRUE(sprite.fontLoaded);
+  TEST_ASSERT_TRUE(metrics == sprite.gUnicode);
+  TEST_ASSERT_EQUAL(0, sprite.gFont.yAdvance);
+
+  sprite.unloadFont();
+  sprite.loadFont(NotoSansBold15);
+  TEST_ASSERT_NOT_EQUAL(0, sprite.gFont.yAdvance);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_bands_match_direct_replay);
+  RUN_TEST(test_bands_scale_with_cores);
+  RUN_TEST(test_font_reload_is_skipped);
+  return UNITY_END();
+}
@@ -0,0 +1,160 @@
+#include "Button.h"
+
+#include <string>
+#include <unity.h>
+#include <vector>
+
+namespace {
+struct Edge {
+  uint32_t time_ms;
+  bool pressed;
+};
+
+// The clock the button is driven by, and the events seen with their times
+uint32_t clock_ms;
+std::string events;
+
+void record(const char *event) {
+  events += (events.empty() ? "" : " ") + std::string(event) + "@" +
+            std::to_string(clock_ms);
+}
+
+void click() { record("click"); }
+void doubleClick() { record("double"); }
+void longPressStart() { record("longStart"); }
+void longPressStop() { record("longStop"); }
+
+// Waits for the edges as the Controller task does: the button is updated when
+// its next timeout is due or an edge arrives, then sleeps until the last
+// timeout once the edges are replayed
+void replay(Button &button, const std::vector<Edge> &edges) {
+  auto waitUntil = [&](uint32_t time_ms) {
+    for (;;) {
+      uint32_t wait_ms = button.timeUntilUpdate(clock_ms);
+      if (wait_ms == UINT32_MAX || wait_ms > time_ms - clock_ms) {
+        break;
+      }
+      clock_ms += wait_ms;
+      button.update(clock_ms);
+    }
+    clock_ms = time_ms;
+  };
+
+  for (const auto &edge : edges) {
+    waitUntil(edge.time_ms);
+    button.update(edge.time_ms);
+    button.edge(edge.pressed, edge.time_ms);
+  }
+  waitUntil(clock_ms + 10000);
+}
+
+// Level changes at the times given, starting with a press
+std::vector<Edge> toggles(std::initializer_list<uint32_t> times) {
+  std::vector<Edge> edges;
+  bool pressed = true;
+  for (auto time_ms : times) {
+    edges.push_back({time_ms, pressed});
+    pressed = !pressed;
+  }
+  return edges;
+}
+
+Button makeButton(bool withDoubleClick = true) {
+  Button button;
+  button.setHandlers(click, withDoubleClick ? doubleClick : nullptr,
+                     longPressStart, longPressStop);
+  button.begin(false, 0);
+  return button;
+}
+} // namespace
+
+void setUp() {
+  clock_ms = 0;
+  events.clear();
+}
+
+void tearDown() {}
+
+void test_click_waits_for_double_click() {
+  auto button = makeButton();
+  replay(button, toggles({1000, 1100}));
+  // The click is reported once no second press followed within 400 ms
+  TEST_ASSERT_EQUAL_STRING("click@1400", events.c_str());
+}
+
+void test_click_without_double_click_handler() {
+  auto button = makeButton(false);
+  replay(button, toggles({1000, 1100}));
+  TEST_ASSERT_EQUAL_STRING("click@1150", events.c_str());
+}
+
+void test_bounce_is_one_click() {
+  auto button = makeButton();
+  // Contacts bounce for 12 ms on press and 9 ms on release
+  replay(button, toggles({1000, 1003, 1004, 1008, 1012, 1150, 1152, 1155,
+                          1156, 1159}));
+  // The press counts from the last edge of the bounce
+  TEST_ASSERT_EQUAL_STRING("click@1412", events.c_str());
+}
+
+void test_double_click() {
+  auto button = makeButton();
+  replay(button, toggles({1000, 1100, 1250, 1320}));
+  TEST_ASSERT_EQUAL_STRING("double@1370", events.c_str());
+}
+
+void test_double_click_with_bounce() {
+  auto button = makeButton();
+  replay(button, toggles({1000, 1002, 1005, 1100, 1104, 1106, 1250, 1251,
+                          1253, 1320, 1330, 1331}));
+  TEST_ASSERT_EQUAL_STRING("double@1381", events.c_str());
+}
+
+void test_long_press_start_and_stop() {
+  auto button = makeButton();
+  replay(button, toggles({1000, 2500}));
+  TEST_ASSERT_EQUAL_STRING("longStart@1800 longStop@2550", events.c_str());
+  TEST_ASSERT_EQUAL(UINT32_MAX, button.timeUntilUpdate(clock_ms));
+}
+
+void test_release_during_debounce_is_ignored() {
+  auto button = makeButton();
+  // A press shorter than the debounce time is noise
+  replay(button, toggles({1000, 1030}));
+  TEST_ASSERT_EQUAL_STRING("", events.c_str());
+}
+
+void test_release_during_debounce_keeps_long_press() {
+  auto button = makeButton();
+  // The contact opens for 20 ms during a long press
+  replay(button, toggles({1000, 1500, 1520, 2000}));
+  TEST_ASSERT_EQUAL_STRING("longStart@1800 longStop@2050", events.c_str());
+}
+
+void test_second_press_after_click_timeout_is_new_click() {
+  auto button = makeButton();
+  replay(button, toggles({1000, 1100, 1500, 1600}));
+  TEST_ASSERT_EQUAL_STRING("click@1400 click@1900", events.c_str());
+}
+
+void test_time_until_update_wraps() {
+  auto button = makeButton();
+  // Edges around the 32 bit millisecond wrap, 49.7 days after boot
+  replay(button, toggles({UINT32_MAX - 20, 79}));
+  TEST_ASSERT_EQUAL_STRING("click@379", events.c_str());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_click_waits_for_double_click);
+  RUN_TEST(test_click_without_double_click_handler);
+  RUN_TEST(test_bounce_is_one_click);
+  RUN_TEST(test_double_click);
+  RUN_TEST(test_double_click_with_bounce);
+  RUN_TEST(test_long_press_start_and_stop);
+  RUN_TEST(test_release_during_debounce_is_ignored);
+  RUN_TEST(test_release_during_debounce_keeps_long_press);
+  RUN_TEST(test_second_press_after_click_timeout_is_new_click);
+  RUN_TEST(test_time_until_update_wraps);
+  return UNITY_END();
+}
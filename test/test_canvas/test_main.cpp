@@ -0,0 +1,112 @@
+#include <TFT_eSPI.h>
+
+#include <unity.h>
+
+#define WIDTH 320
+#define HEIGHT 170
+#define LOOPS 20000
+#define RUNS 7
+
+namespace {
+TFT_eSPI tft;
+
+enum Primitive { PIXEL, HLINE, VLINE, LINE, CIRCLE, RECT, PRIMITIVES };
+const char *names[PRIMITIVES] = {"pixel", "hline", "vline",
+                                 "line",  "circle", "rect"};
+
+// The calls of the Canvas_Benchmark example, through the base class as the
+// View makes them
+void draw(TFT_eSPI *s, Primitive primitive, int i) {
+  switch (primitive) {
+  case PIXEL:
+    s->drawPixel(i % WIDTH, i % HEIGHT, i);
+    break;
+  case HLINE:
+    s->drawFastHLine(i % WIDTH - 10, i % HEIGHT, 40, i);
+    break;
+  case VLINE:
+    s->drawFastVLine(i % WIDTH, i % HEIGHT - 10, 40, i);
+    break;
+  case LINE:
+    s->drawLine(0, i % HEIGHT, WIDTH - 1, HEIGHT - 1 - i % HEIGHT, i);
+    break;
+  case CIRCLE:
+    s->fillCircle(i % WIDTH, i % HEIGHT, 4, i);
+    break;
+  default:
+    s->fillRect(i % WIDTH - 20, i % HEIGHT - 20, 60, 40, i);
+    break;
+  }
+}
+
+// Nanoseconds per call of primitive, the best of RUNS runs
+uint32_t timePrimitive(TFT_eSPI *s, Primitive primitive) {
+  int loops = primitive == RECT ? LOOPS / 10 : LOOPS;
+  uint32_t best_ns = UINT32_MAX;
+  for (int run = 0; run < RUNS; run++) {
+    uint32_t start = micros();
+    for (int i = 0; i < loops; i++) {
+      draw(s, primitive, i);
+    }
+    best_ns = min(best_ns, (uint32_t)((micros() - start) * 1000 / loops));
+  }
+  return best_ns;
+}
+} // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_canvas_matches_sprite() {
+  auto sprite = TFT_eSprite(&tft);
+  auto canvas = TFT_eCanvas<WIDTH, HEIGHT, TFT_Rgb565>(&tft);
+  TEST_ASSERT_NOT_NULL(sprite.createSprite(WIDTH, HEIGHT));
+  TEST_ASSERT_NOT_NULL(canvas.createSprite());
+  sprite.fillSprite(TFT_BLACK);
+  canvas.fillSprite(TFT_BLACK);
+
+  for (int primitive = 0; primitive < PRIMITIVES; primitive++) {
+    for (int i = 0; i < 500; i++) {
+      draw(&sprite, (Primitive)primitive, i * 7);
+      draw(&canvas, (Primitive)primitive, i * 7);
+    }
+  }
+  // A viewport takes the TFT_eSprite path
+  sprite.setViewport(10, 20, 100, 50);
+  canvas.setViewport(10, 20, 100, 50);
+  for (int i = 0; i < 500; i++) {
+    draw(&sprite, (Primitive)(i % PRIMITIVES), i * 13);
+    draw(&canvas, (Primitive)(i % PRIMITIVES), i * 13);
+  }
+  TEST_ASSERT_EQUAL_MEMORY(sprite.getPointer(), canvas.getPointer(),
+                           WIDTH * HEIGHT * sizeof(uint16_t));
+}
+
+void test_canvas_primitive_speed() {
+  auto sprite = TFT_eSprite(&tft);
+  auto canvas = TFT_eCanvas<WIDTH, HEIGHT, TFT_Rgb565>(&tft);
+  TEST_ASSERT_NOT_NULL(sprite.createSprite(WIDTH, HEIGHT));
+  TEST_ASSERT_NOT_NULL(canvas.createSprite());
+
+  // Reported for comparison with the Canvas_Benchmark example on the target,
+  // host timings depend on how the compiler inlines memcpy
+  for (int primitive = 0; primitive < PRIMITIVES; primitive++) {
+    uint32_t sprite_ns = timePrimitive(&sprite, (Primitive)primitive);
+    uint32_t canvas_ns = timePrimitive(&canvas, (Primitive)primitive);
+
+    char message[80];
+    snprintf(message, sizeof(message), "%-6s Sprite %u ns, Canvas %u ns",
+             names[primitive], sprite_ns, canvas_ns);
+    TEST_MESSAGE(message);
+  }
+  TEST_ASSERT_EQUAL_MEMORY(sprite.getPointer(), canvas.getPointer(),
+                           WIDTH * HEIGHT * sizeof(uint16_t));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_canvas_matches_sprite);
+  RUN_TEST(test_canvas_primitive_speed);
+  return UNITY_END();
+}
@@ -0,0 +1,258 @@
+#include "ConnectionManager.h"
+#include <lwip/dns.h>
+#include <lwip/sockets.h>
+#include <unity.h>
+#include <vector>
+
+namespace {
+// Local TCP server standing in for the broker host
+struct Listener {
+  int fd = -1;
+  uint16_t port = 0;
+
+  void open() {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    TEST_ASSERT_EQUAL(0, bind(fd, reinterpret_cast<sockaddr *>(&address),
+                              sizeof(address)));
+    socklen_t length = sizeof(address);
+    getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length);
+    port = ntohs(address.sin_port);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    TEST_ASSERT_EQUAL(0, listen(fd, 8));
+  }
+
+  // Connects are refused while closed, open() listens on the same port again
+  void close() {
+    ::close(fd);
+    fd = -1;
+  }
+
+  // Accepts and drops the connections of earlier attempts
+  void drain() {
+    int client;
+    while (fd >= 0 && (client = accept(fd, nullptr, nullptr)) >= 0) {
+      ::close(client);
+    }
+  }
+};
+
+Listener listener;
+WiFiClient wifiClient;
+PubSubClient pubSubClient{wifiClient};
+
+long randomMax(long range) { return range - 1; }
+long randomMin(long range) { return 0; }
+
+ConnectionManager makeManager(const char *server = "127.0.0.1") {
+  return ConnectionManager{pubSubClient, wifiClient,    "ssid",
+                           "password",   server,        listener.port,
+                           "/sensors/+"};
+}
+
+// Polls every millisecond until done() or the time limit
+template <typename Done>
+bool pollUntil(ConnectionManager &manager, uint32_t limit_ms, Done done) {
+  uint32_t end = fakeMillis + limit_ms;
+  while (fakeMillis != end) {
+    fakeMillis++;
+    manager.poll();
+    listener.drain();
+    if (done()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Times of the failed broker attempts
+std::vector<uint32_t> failures(ConnectionManager &manager, size_t count) {
+  std::vector<uint32_t> times;
+  uint32_t failed = manager.metrics().failedAttempts;
+  pollUntil(manager, 200000, [&] {
+    if (manager.metrics().failedAttempts != failed) {
+      failed = manager.metrics().failedAttempts;
+      times.push_back(fakeMillis);
+    }
+    return times.size() == count;
+  });
+  return times;
+}
+
+// A retry starts on the poll after the backoff expired and fails within it
+void assertGaps(const std::vector<uint32_t> &times,
+                const std::vector<uint32_t> &delays) {
+  TEST_ASSERT_EQUAL(delays.size() + 1, times.size());
+  for (size_t i = 0; i < delays.size(); i++) {
+    TEST_ASSERT_UINT32_WITHIN(1, delays[i] + 1, times[i + 1] - times[i]);
+  }
+}
+} // namespace
+
+void setUp() {
+  fakeMillis = 1000;
+  fakeRandom = randomMax;
+  fakeBroker = FakeBroker{};
+  fakeDns = FakeDns{};
+  WiFi = FakeWiFi{};
+  pubSubClient.disconnect();
+  pubSubClient.blockingConnects = 0;
+  listener.port = 0;
+  listener.open();
+}
+
+void tearDown() {
+  if (listener.fd >= 0) {
+    listener.close();
+  }
+}
+
+void test_backoff_doubles_up_to_max() {
+  auto backoff = Backoff{500, 30000};
+  for (uint32_t expected : {500, 1000, 2000, 4000, 8000, 16000, 30000, 30000}) {
+    TEST_ASSERT_EQUAL_UINT32(expected, backoff.next());
+  }
+  TEST_ASSERT_EQUAL_UINT32(8, backoff.attempts());
+
+  // Jitter keeps the delay in the upper half
+  fakeRandom = randomMin;
+  backoff.reset();
+  TEST_ASSERT_EQUAL_UINT32(250, backoff.next());
+  TEST_ASSERT_EQUAL_UINT32(500, backoff.next());
+  for (int i = 0; i < 20; i++) {
+    backoff.next();
+  }
+  TEST_ASSERT_EQUAL_UINT32(15000, backoff.next());
+}
+
+void test_refused_connects_follow_backoff() {
+  listener.close();
+  auto manager = makeManager();
+  manager.begin();
+
+  auto times = failures(manager, 9);
+  assertGaps(times, {500, 1000, 2000, 4000, 8000, 16000, 30000, 30000});
+  TEST_ASSERT(manager.mqttState() == ConnectionManager::MqttState::Backoff);
+  TEST_ASSERT_EQUAL_UINT32(1, manager.metrics().wifiConnects);
+  TEST_ASSERT_EQUAL_UINT32(0, manager.metrics().mqttConnects);
+  TEST_ASSERT_EQUAL(0, pubSubClient.blockingConnects);
+}
+
+void test_refused_then_dropped_then_recovers() {
+  fakeBroker.refuse = true;
+  auto manager = makeManager();
+  manager.begin();
+
+  // The broker refuses CONNECT on an open TCP connection
+  auto times = failures(manager, 3);
+  assertGaps(times, {500, 1000});
+  fakeBroker.refuse = false;
+  TEST_ASSERT(pollUntil(manager, 5000, [&] { return manager.connected(); }));
+  TEST_ASSERT_UINT32_WITHIN(1, times.back() + 2000 + 1, fakeMillis);
+  TEST_ASSERT_EQUAL(1, fakeBroker.connects);
+
+  // The session drops and the host stops listening
+  uint32_t dropped = fakeMillis + 1;
+  fakeBroker.up = false;
+  listener.close();
+  TEST_ASSERT(pollUntil(manager, 10, [&] { return !manager.connected(); }));
+
+  // The backoff starts over from the base delay
+  times = failures(manager, 4);
+  TEST_ASSERT_UINT32_WITHIN(1, dropped + 1, times[0]);
+  assertGaps(times, {500, 1000, 2000});
+
+  fakeBroker.up = true;
+  listener.open();
+  TEST_ASSERT(pollUntil(manager, 5000, [&] { return manager.connected(); }));
+  TEST_ASSERT_UINT32_WITHIN(1, times.back() + 4000 + 1, fakeMillis);
+
+  ConnectionMetrics metrics = manager.metrics();
+  TEST_ASSERT_EQUAL_UINT32(2, metrics.mqttConnects);
+  TEST_ASSERT_EQUAL_UINT32(1, metrics.reconnects);
+  TEST_ASSERT_EQUAL_UINT32(7, metrics.failedAttempts);
+  TEST_ASSERT_EQUAL_UINT32(fakeMillis - dropped, metrics.lastOutage_ms);
+  TEST_ASSERT_EQUAL(0, pubSubClient.blockingConnects);
+}
+
+void test_resolves_without_blocking() {
+  auto manager = makeManager("broker.local");
+  manager.begin();
+
+  TEST_ASSERT(pollUntil(manager, 10, [&] {
+    return manager.mqttState() == ConnectionManager::MqttState::Resolving;
+  }));
+  // Polls return while the lookup is pending
+  TEST_ASSERT_FALSE(
+      pollUntil(manager, 100, [&] { return manager.connected(); }));
+  TEST_ASSERT_EQUAL(1, fakeDns.lookups);
+
+  fakeDns.answer("127.0.0.1");
+  TEST_ASSERT(pollUntil(manager, 10, [&] { return manager.connected(); }));
+  TEST_ASSERT_EQUAL(0, pubSubClient.blockingConnects);
+}
+
+void test_lookup_failure_and_timeout_back_off() {
+  auto manager = makeManager("broker.local");
+  manager.begin();
+
+  TEST_ASSERT(pollUntil(manager, 10, [&] { return fakeDns.lookups == 1; }));
+  uint32_t started = fakeMillis;
+  fakeDns.answer(nullptr);
+  TEST_ASSERT(pollUntil(manager, 10, [&] {
+    return manager.mqttState() == ConnectionManager::MqttState::Backoff;
+  }));
+
+  // The second lookup is never answered
+  TEST_ASSERT(pollUntil(manager, 1000, [&] { return fakeDns.lookups == 2; }));
+  TEST_ASSERT_UINT32_WITHIN(1, started + 500 + 1, fakeMillis);
+  started = fakeMillis;
+  TEST_ASSERT(pollUntil(manager, 6000, [&] {
+    return manager.metrics().failedAttempts == 2;
+  }));
+  TEST_ASSERT_UINT32_WITHIN(1, started + 5000 + 1, fakeMillis);
+}
+
+void test_wifi_loss_reconnects_both() {
+  auto manager = makeManager();
+  manager.begin();
+  TEST_ASSERT(pollUntil(manager, 10, [&] { return manager.connected(); }));
+
+  int connects = fakeBroker.connects;
+  WiFi.apUp = false;
+  WiFi.setUp(false);
+  uint32_t dropped = fakeMillis + 1;
+  TEST_ASSERT(pollUntil(manager, 10, [&] {
+    return manager.wifiState() == ConnectionManager::WifiState::Backoff;
+  }));
+  TEST_ASSERT_FALSE(manager.connected());
+
+  // The first association times out after 10 s, the next one succeeds
+  TEST_ASSERT(pollUntil(manager, 2000, [&] { return WiFi.begins == 2; }));
+  WiFi.apUp = true;
+  TEST_ASSERT(pollUntil(manager, 20000, [&] { return manager.connected(); }));
+  TEST_ASSERT_EQUAL(3, WiFi.begins);
+  // The new session was opened with a CONNECT
+  TEST_ASSERT_EQUAL(connects + 1, fakeBroker.connects);
+
+  ConnectionMetrics metrics = manager.metrics();
+  TEST_ASSERT_EQUAL_UINT32(2, metrics.wifiConnects);
+  TEST_ASSERT_EQUAL_UINT32(1, metrics.reconnects);
+  TEST_ASSERT_EQUAL_UINT32(fakeMillis - dropped, metrics.lastOutage_ms);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_backoff_doubles_up_to_max);
+  RUN_TEST(test_refused_connects_follow_backoff);
+  RUN_TEST(test_refused_then_dropped_then_recovers);
+  RUN_TEST(test_resolves_without_blocking);
+  RUN_TEST(test_lookup_failure_and_timeout_back_off);
+  RUN_TEST(test_wifi_loss_reconnects_both);
+  return UNITY_END();
+}
@@ -0,0 +1,136 @@
+#include "DataModel.h"
+
+#include <atomic>
+#include <set>
+#include <string>
+#include <thread>
+#include <unity.h>
+
+#define WRITERS 4
+#define READERS 2
+#define SENSORS 200
+#define ROUNDS 20
+
+namespace {
+class FakeView : public IView {
+public:
+  std::atomic<uint32_t> updates{0};
+  void update(const std::vector<uint16_t> &) override { updates++; }
+};
+
+// A reading whose fields all derive from value, so a record mixing two
+// readings shows
+SensorMessage reading(const String &location, uint32_t value) {
+  return SensorMessage{.sensorLocation = location,
+                       .sensorTypeName = "BME280",
+                       .temperature = static_cast<float>(value),
+                       .humidity = value + 0.5f,
+                       .battery = value};
+}
+
+bool torn(const ViewModel &vm) {
+  return vm.temperature != vm.battery || vm.humidity != vm.battery + 0.5f ||
+         vm.minTemperature > vm.temperature ||
+         vm.maxTemperature < vm.temperature || vm.minHumidity > vm.humidity ||
+         vm.maxHumidity < vm.humidity ||
+         !(vm.sensorTypeName == String{"BME280"}) ||
+         strncmp(vm.sensorLocation.c_str(), "room", 4) != 0;
+}
+} // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_concurrent_updates_and_reads_are_not_torn() {
+  DataModel model;
+  FakeView view;
+  model.setView(&view);
+  const char *topic = "sensors";
+  TopicLevel level{topic, strlen(topic)};
+
+  // Each writer adds readings of every sensor in its own order, so sensors
+  // are added by whichever writer gets there first
+  std::vector<std::thread> writers;
+  for (uint32_t writer = 0; writer < WRITERS; writer++) {
+    writers.emplace_back([&, writer] {
+      for (uint32_t round = 0; round < ROUNDS; round++) {
+        for (uint32_t i = 0; i < SENSORS; i++) {
+          uint32_t sensor = (i * 7 + writer * 53) % SENSORS;
+          String location = String("room") + String(sensor);
+          SensorBatch batch{reading(location, round * 1000 + writer)};
+          model.sensorUpdate(level, batch);
+        }
+      }
+    });
+  }
+
+  std::atomic<bool> writing{true};
+  std::atomic<uint32_t> reads{0};
+  std::atomic<uint32_t> tornReads{0};
+  std::vector<std::thread> readers;
+  for (int reader = 0; reader < READERS; reader++) {
+    readers.emplace_back([&] {
+      while (writing) {
+        for (auto id : model.getSensorIds()) {
+          if (torn(model.getViewModel(id))) {
+            tornReads++;
+          }
+          reads++;
+        }
+      }
+    });
+  }
+
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  writing = false;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  char message[64];
+  snprintf(message, sizeof(message), "%u reads during the updates",
+           reads.load());
+  TEST_MESSAGE(message);
+  TEST_ASSERT_GREATER_THAN(0, reads.load());
+  TEST_ASSERT_EQUAL(0, tornReads.load());
+  TEST_ASSERT_EQUAL(WRITERS * ROUNDS * SENSORS, view.updates.load());
+
+  // Each sensor was added once, with the id of its slot
+  auto ids = model.getSensorIds();
+  TEST_ASSERT_EQUAL(SENSORS, ids.size());
+  std::set<std::string> locations;
+  for (size_t slot = 0; slot < ids.size(); slot++) {
+    TEST_ASSERT_EQUAL(slot + 1, ids[slot]);
+    auto vm = model.getViewModel(ids[slot]);
+    TEST_ASSERT_FALSE(torn(vm));
+    TEST_ASSERT_EQUAL((ROUNDS - 1) * 1000, vm.battery / 1000 * 1000);
+    locations.insert(vm.sensorLocation.c_str());
+  }
+  TEST_ASSERT_EQUAL(SENSORS, locations.size());
+}
+
+void test_full_table_drops_new_sensors() {
+  DataModel model;
+  FakeView view;
+  model.setView(&view);
+  const char *topic = "sensors";
+  TopicLevel level{topic, strlen(topic)};
+
+  SensorBatch batch;
+  for (uint32_t sensor = 0; sensor <= SensorTable::capacity(); sensor++) {
+    batch.push_back(reading(String("room") + String(sensor), sensor));
+  }
+  model.sensorUpdate(level, batch);
+  TEST_ASSERT_EQUAL(SensorTable::capacity(), model.getSensorIds().size());
+  TEST_ASSERT_FALSE(torn(model.getViewModel(SensorTable::capacity())));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_concurrent_updates_and_reads_are_not_torn);
+  RUN_TEST(test_full_table_drops_new_sensors);
+  return UNITY_END();
+}
@@ -0,0 +1,304 @@
+#include "DataModel.h"
+
+#include <chrono>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+#define BENCH_MESSAGES 20000
+
+namespace {
+const char *jsonReading =
+    "{\"sen\":\"BME280\",\"temp\":21.5,\"hum\":48.25,\"battery\":3950}";
+
+// A SENSOR_PAYLOAD_V1 message
+std::vector<uint8_t> binaryReading(int16_t temperature, uint16_t humidity,
+                                   uint16_t battery, const char *typeName) {
+  std::vector<uint8_t> payload{SENSOR_PAYLOAD_V1};
+  for (uint16_t value : {static_cast<uint16_t>(temperature), humidity,
+                         battery}) {
+    payload.push_back(value & 0xff);
+    payload.push_back(value >> 8);
+  }
+  payload.insert(payload.end(), typeName, typeName + strlen(typeName));
+  return payload;
+}
+
+// A SENSOR_PAYLOAD_BATCH_V1 record
+void appendRecord(std::vector<uint8_t> &payload, int16_t temperature,
+                  uint16_t humidity, uint16_t battery, const char *location,
+                  const char *typeName) {
+  for (uint16_t value : {static_cast<uint16_t>(temperature), humidity,
+                         battery}) {
+    payload.push_back(value & 0xff);
+    payload.push_back(value >> 8);
+  }
+  payload.push_back(strlen(location));
+  payload.push_back(strlen(typeName));
+  payload.insert(payload.end(), location, location + strlen(location));
+  payload.insert(payload.end(), typeName, typeName + strlen(typeName));
+}
+
+// Batches of count readings from a gateway, in binary and JSON
+std::vector<uint8_t> binaryBatch(int count) {
+  std::vector<uint8_t> payload{SENSOR_PAYLOAD_BATCH_V1};
+  for (int i = 0; i < count; i++) {
+    std::string location = "room" + std::to_string(i);
+    appendRecord(payload, 2000 + i, 5000 + i, 3900, location.c_str(),
+                 "BME280");
+  }
+  return payload;
+}
+
+std::string jsonBatch(int count) {
+  std::string payload = "[";
+  for (int i = 0; i < count; i++) {
+    char reading[96];
+    snprintf(reading, sizeof(reading),
+             "%s{\"loc\":\"room%d\",\"sen\":\"BME280\",\"temp\":%.2f,"
+             "\"hum\":%.2f,\"battery\":3900}",
+             i > 0 ? "," : "", i, (2000 + i) / 100.0, (5000 + i) / 100.0);
+    payload += reading;
+  }
+  return payload + "]";
+}
+
+bool decode(const std::vector<uint8_t> &payload, SensorBatch &batch) {
+  return DataModel::decode(payload.data(), payload.size(), batch);
+}
+
+bool decode(const std::string &payload, SensorBatch &batch) {
+  return DataModel::decode(reinterpret_cast<const uint8_t *>(payload.data()),
+                           payload.size(), batch);
+}
+
+void assertReading(const SensorMessage &message, const char *location,
+                   const char *typeName, float temperature, float humidity,
+                   uint32_t battery) {
+  TEST_ASSERT_EQUAL_STRING(location, message.sensorLocation.c_str());
+  TEST_ASSERT_EQUAL_STRING(typeName, message.sensorTypeName.c_str());
+  TEST_ASSERT_EQUAL_FLOAT(temperature, message.temperature);
+  TEST_ASSERT_EQUAL_FLOAT(humidity, message.humidity);
+  TEST_ASSERT_EQUAL(battery, message.battery);
+}
+
+// Every shorter prefix of payload is rejected
+template <typename Payload>
+void assertPrefixesRejected(const Payload &payload) {
+  for (size_t length = 0; length < payload.size(); length++) {
+    SensorBatch batch;
+    Payload prefix(payload.begin(), payload.begin() + length);
+    TEST_ASSERT_FALSE_MESSAGE(decode(prefix, batch),
+                              std::to_string(length).c_str());
+  }
+}
+
+// Nanoseconds per decode of payload into a reused batch
+template <typename Payload> uint32_t timeDecode(const Payload &payload) {
+  SensorBatch batch;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_MESSAGES; i++) {
+    batch.clear();
+    TEST_ASSERT_TRUE(decode(payload, batch));
+  }
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         BENCH_MESSAGES;
+}
+} // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_binary_reading() {
+  SensorBatch batch;
+  TEST_ASSERT_TRUE(decode(binaryReading(2150, 4825, 3950, "BME280"), batch));
+  TEST_ASSERT_EQUAL(1, batch.size());
+  assertReading(batch[0], "", "BME280", 21.5f, 48.25f, 3950);
+
+  batch.clear();
+  TEST_ASSERT_TRUE(decode(binaryReading(-1234, 0, 0, "DS18B20"), batch));
+  assertReading(batch[0], "", "DS18B20", -12.34f, 0, 0);
+}
+
+void test_binary_reading_truncated() {
+  // The type name runs to the end, only a cut into the fixed fields shows
+  auto payload = binaryReading(2150, 4825, 3950, "");
+  assertPrefixesRejected(payload);
+  SensorBatch batch;
+  TEST_ASSERT_TRUE(decode(payload, batch));
+}
+
+void test_json_reading() {
+  SensorBatch batch;
+  TEST_ASSERT_TRUE(decode(std::string(jsonReading), batch));
+  TEST_ASSERT_EQUAL(1, batch.size());
+  assertReading(batch[0], "", "BME280", 21.5f, 48.25f, 3950);
+
+  // Leading white space, integers and a missing battery are accepted
+  batch.clear();
+  TEST_ASSERT_TRUE(
+      decode(std::string(" {\"sen\":\"SHT31\",\"temp\":20,\"hum\":50}"),
+             batch));
+  assertReading(batch[0], "", "SHT31", 20, 50, 0);
+}
+
+void test_json_reading_malformed() {
+  const char *malformed[] = {
+      "",
+      "{",
+      "{\"sen\":\"BME280\",\"temp\":21.5,\"hum\":}",
+      "{\"sen\":\"BME280\",\"temp\":21.5}",
+      "{\"sen\":42,\"temp\":21.5,\"hum\":48.25}",
+      "{\"sen\":\"BME280\",\"temp\":\"warm\",\"hum\":48.25}",
+      "42",
+      "null",
+      "\x80\x01\x02",
+  };
+  for (const char *payload : malformed) {
+    SensorBatch batch;
+    TEST_ASSERT_FALSE_MESSAGE(decode(std::string(payload), batch), payload);
+  }
+}
+
+void test_json_reading_truncated() {
+  assertPrefixesRejected(std::string(jsonReading));
+}
+
+void test_binary_batch() {
+  std::vector<uint8_t> payload{SENSOR_PAYLOAD_BATCH_V1};
+  appendRecord(payload, 2150, 4825, 3950, "kitchen", "BME280");
+  appendRecord(payload, -500, 9000, 3000, "", "DS18B20");
+  SensorBatch batch;
+  TEST_ASSERT_TRUE(decode(payload, batch));
+  TEST_ASSERT_EQUAL(2, batch.size());
+  assertReading(batch[0], "kitchen", "BME280", 21.5f, 48.25f, 3950);
+  // Without a location the reading is for the topic
+  assertReading(batch[1], "", "DS18B20", -5, 90, 3000);
+
+  // A batch without records is valid and empty
+  batch.clear();
+  TEST_ASSERT_TRUE(
+      decode(std::vector<uint8_t>{SENSOR_PAYLOAD_BATCH_V1}, batch));
+  TEST_ASSERT_EQUAL(0, batch.size());
+}
+
+void test_binary_batch_truncated() {
+  std::vector<uint8_t> payload{SENSOR_PAYLOAD_BATCH_V1};
+  appendRecord(payload, 2150, 4825, 3950, "kitchen", "BME280");
+  size_t firstEnd = payload.size();
+  appendRecord(payload, 2000, 5000, 3900, "attic", "SHT31");
+
+  // Cuts at a record boundary leave a shorter valid batch
+  for (size_t length = 0; length < payload.size(); length++) {
+    SensorBatch batch;
+    std::vector<uint8_t> prefix(payload.begin(), payload.begin() + length);
+    bool boundary = length == 1 || length == firstEnd;
+    TEST_ASSERT_EQUAL_MESSAGE(boundary, decode(prefix, batch),
+                              std::to_string(length).c_str());
+  }
+}
+
+void test_binary_batch_malformed() {
+  // Name lengths that run past the end of the payload
+  std::vector<uint8_t> payload{SENSOR_PAYLOAD_BATCH_V1};
+  appendRecord(payload, 2150, 4825, 3950, "kitchen", "BME280");
+  payload[7] = 255;
+  SensorBatch batch;
+  TEST_ASSERT_FALSE(decode(payload, batch));
+  payload[7] = 7;
+  payload[8] = 7;
+  TEST_ASSERT_FALSE(decode(payload, batch));
+}
+
+void test_json_batch() {
+  SensorBatch batch;
+  TEST_ASSERT_TRUE(decode(jsonBatch(3), batch));
+  TEST_ASSERT_EQUAL(3, batch.size());
+  assertReading(batch[2], "room2", "BME280", 20.02f, 50.02f, 3900);
+
+  batch.clear();
+  TEST_ASSERT_TRUE(decode(std::string("[{\"sen\":\"SHT31\",\"temp\":20,"
+                                      "\"hum\":50}]"),
+                          batch));
+  assertReading(batch[0], "", "SHT31", 20, 50, 0);
+
+  batch.clear();
+  TEST_ASSERT_TRUE(decode(std::string("[]"), batch));
+  TEST_ASSERT_EQUAL(0, batch.size());
+}
+
+void test_json_batch_of_hundreds() {
+  // A gateway in front of many sensors
+  SensorBatch batch;
+  TEST_ASSERT_TRUE(decode(jsonBatch(400), batch));
+  TEST_ASSERT_EQUAL(400, batch.size());
+  assertReading(batch[399], "room399", "BME280", 23.99f, 53.99f, 3900);
+
+  // Compact readings need the most document memory per payload byte
+  std::string compact = "[";
+  for (int i = 0; i < 400; i++) {
+    compact += i > 0 ? ",{\"sen\":\"S\",\"temp\":1,\"hum\":2}"
+                     : "{\"sen\":\"S\",\"temp\":1,\"hum\":2}";
+  }
+  compact += "]";
+  batch.clear();
+  TEST_ASSERT_TRUE(decode(compact, batch));
+  TEST_ASSERT_EQUAL(400, batch.size());
+  assertReading(batch[399], "", "S", 1, 2, 0);
+}
+
+void test_json_batch_malformed() {
+  const char *malformed[] = {
+      "[",
+      "[{\"sen\":\"BME280\",\"temp\":21.5,\"hum\":48.25},{\"sen\":1}]",
+      "[{\"sen\":\"BME280\",\"temp\":21.5,\"hum\":48.25},42]",
+      "[[]]",
+  };
+  for (const char *payload : malformed) {
+    SensorBatch batch;
+    TEST_ASSERT_FALSE_MESSAGE(decode(std::string(payload), batch), payload);
+  }
+}
+
+void test_json_batch_truncated() { assertPrefixesRejected(jsonBatch(2)); }
+
+void test_binary_decodes_faster_than_json() {
+  uint32_t binary_ns = timeDecode(binaryReading(2150, 4825, 3950, "BME280"));
+  uint32_t json_ns = timeDecode(std::string(jsonReading));
+
+  char message[96];
+  snprintf(message, sizeof(message),
+           "Reading: binary %u ns/message, JSON %u ns/message", binary_ns,
+           json_ns);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_THAN(json_ns, binary_ns);
+
+  binary_ns = timeDecode(binaryBatch(16));
+  json_ns = timeDecode(jsonBatch(16));
+  snprintf(message, sizeof(message),
+           "Batch of 16: binary %u ns/message, JSON %u ns/message", binary_ns,
+           json_ns);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_THAN(json_ns, binary_ns);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_binary_reading);
+  RUN_TEST(test_binary_reading_truncated);
+  RUN_TEST(test_json_reading);
+  RUN_TEST(test_json_reading_malformed);
+  RUN_TEST(test_json_reading_truncated);
+  RUN_TEST(test_binary_batch);
+  RUN_TEST(test_binary_batch_truncated);
+  RUN_TEST(test_binary_batch_malformed);
+  RUN_TEST(test_json_batch);
+  RUN_TEST(test_json_batch_of_hundreds);
+  RUN_TEST(test_json_batch_malformed);
+  RUN_TEST(test_json_batch_truncated);
+  RUN_TEST(test_binary_decodes_faster_than_json);
+  return UNITY_END();
+}
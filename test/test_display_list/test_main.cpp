@@ -0,0 +1,57 @@
+#include <TFT_eSPI.h>
+
+#include <unity.h>
+
+namespace {
+TFT_eSPI tft;
+} // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_text_background_from_parameter() {
+  auto sprite = TFT_eSprite(&tft);
+  TEST_ASSERT_NOT_NULL(sprite.createSprite(40, 10));
+  TFT_eDisplayList list;
+  list.fillRect(0, 0, 10, 10, TFT_DARKGREY);
+  list.setTextColor(TFT_WHITE, list.colorParam(1), true);
+  list.drawString("21.5", 0, 0);
+  // The colour pair is a barrier the fills are not moved or merged across
+  list.fillRect(10, 0, 10, 10, TFT_DARKGREY);
+  list.optimise();
+
+  list.setColorParam(1, TFT_RED);
+  list.replay(&sprite);
+  TEST_ASSERT_EQUAL_HEX32(TFT_WHITE, sprite.textcolor);
+  TEST_ASSERT_EQUAL_HEX32(TFT_RED, sprite.textbgcolor);
+
+  // A cached list picks up the new background without recording it again
+  list.setColorParam(1, TFT_NAVY);
+  list.replay(&sprite);
+  TEST_ASSERT_EQUAL_HEX32(TFT_NAVY, sprite.textbgcolor);
+}
+
+void test_text_background_literal() {
+  auto sprite = TFT_eSprite(&tft);
+  TFT_eDisplayList list;
+  list.setTextColor(list.colorParam(0), TFT_MAGENTA);
+  list.setColorParam(0, TFT_YELLOW);
+  list.replay(&sprite);
+  TEST_ASSERT_EQUAL_HEX32(TFT_YELLOW, sprite.textcolor);
+  TEST_ASSERT_EQUAL_HEX32(TFT_MAGENTA, sprite.textbgcolor);
+
+  // The foreground only form draws text without a background
+  list.clear();
+  list.setTextColor(TFT_GREEN);
+  list.replay(&sprite);
+  TEST_ASSERT_EQUAL_HEX32(TFT_GREEN, sprite.textcolor);
+  TEST_ASSERT_EQUAL_HEX32(TFT_GREEN, sprite.textbgcolor);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_text_background_from_parameter);
+  RUN_TEST(test_text_background_literal);
+  return UNITY_END();
+}
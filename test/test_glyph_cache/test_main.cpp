@@ -0,0 +1,55 @@
+#include <TFT_eSPI.h>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+#define WIDTH 200
+#define HEIGHT 60
+
+namespace {
+TFT_eSPI tft;
+
+// Draws text with two fonts in turns so cached glyphs are replaced, returns
+// the pixels of the last frame
+std::vector<uint16_t> drawFrames(int frames) {
+  auto sprite = TFT_eSprite(&tft);
+  sprite.createSprite(WIDTH, HEIGHT);
+  for (int i = 0; i < frames; i++) {
+    sprite.fillSprite(TFT_BLACK);
+    sprite.setFreeFont(i % 2 == 0 ? &FreeSans12pt7b : &FreeSerifBold9pt7b);
+    sprite.setTextColor(TFT_WHITE);
+    sprite.drawString("Temp 21.5 Hum 48%", 0, 10);
+  }
+  auto *pixels = static_cast<uint16_t *>(sprite.getPointer());
+  return {pixels, pixels + WIDTH * HEIGHT};
+}
+} // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_cached_glyphs_match_unpacked() {
+  // The first frame of each font fills the cache, later frames find some glyphs
+  // cached and unpack those the other font replaced
+  TEST_ASSERT_TRUE(drawFrames(1) == drawFrames(101));
+  TEST_ASSERT_TRUE(drawFrames(2) == drawFrames(100));
+}
+
+void test_instances_draw_on_two_threads() {
+  std::vector<uint16_t> expected = drawFrames(200);
+  std::vector<uint16_t> first, second;
+  std::thread a([&] { first = drawFrames(200); });
+  std::thread b([&] { second = drawFrames(200); });
+  a.join();
+  b.join();
+  TEST_ASSERT_TRUE(first == expected);
+  TEST_ASSERT_TRUE(second == expected);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_cached_glyphs_match_unpacked);
+  RUN_TEST(test_instances_draw_on_two_threads);
+  return UNITY_END();
+}
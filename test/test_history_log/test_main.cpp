@@ -0,0 +1,251 @@
+#include "DataModel.h"
+#include "HistoryLog.h"
+
+#include <LittleFS.h>
+#include <chrono>
+#include <thread>
+#include <unity.h>
+
+#define SENSORS 3
+#define READINGS 96
+// Sizes of the log records, the writer flushes every 16 samples
+#define LOG_HEADER_BYTES 8
+#define RECORD_HEADER_BYTES 4
+#define SAMPLE_RECORD_BYTES 16
+#define SNAPSHOT_SEQUENCE_OFFSET 8
+#define SNAPSHOT_HEADER_BYTES 20
+#define WRITER_TIMEOUT_MS 5000
+
+namespace {
+const char *snapshotPath = "/history.snap";
+const char *snapshotTmpPath = "/history.tmp";
+const char *logPath = "/history.log";
+
+class FakeView : public IView {
+public:
+  void update(const std::vector<uint16_t> &) override {}
+};
+FakeView view;
+
+// A model saving its history. The writer task of the history runs until the
+// end of the tests, so neither is freed.
+struct Session {
+  DataModel *model{new DataModel};
+  HistoryLog *history{new HistoryLog};
+
+  Session() {
+    model->setView(&view);
+    TEST_ASSERT_TRUE(history->begin());
+    model->setHistory(history);
+  }
+};
+
+std::vector<uint8_t> readFile(const char *path) {
+  fs::File file = LittleFS.open(path, "r");
+  if (!file) {
+    return {};
+  }
+  std::vector<uint8_t> data(file.size());
+  data.resize(file.read(data.data(), data.size()));
+  return data;
+}
+
+void writeFile(const char *path, const std::vector<uint8_t> &data) {
+  fs::File file = LittleFS.open(path, "w");
+  TEST_ASSERT_TRUE(file);
+  TEST_ASSERT_EQUAL(data.size(), file.write(data.data(), data.size()));
+}
+
+String location(uint32_t sensor) { return String("room") + String(sensor); }
+
+void addReading(Session &session, uint32_t i) {
+  const char *topic = "sensors";
+  SensorBatch batch{{.sensorLocation = location(i % SENSORS),
+                     .sensorTypeName = "BME280",
+                     .temperature = 18.0f + (i * 37 % 100) / 10.0f,
+                     .humidity = 40.0f + (i * 53 % 200) / 10.0f,
+                     .battery = 3700 + i}};
+  session.model->sensorUpdate({topic, strlen(topic)}, batch);
+}
+
+// Log bytes once the writer has written count samples of SENSORS sensors
+size_t logBytes(size_t count) {
+  size_t bytes = LOG_HEADER_BYTES;
+  for (uint32_t sensor = 0; sensor < SENSORS; sensor++) {
+    // Type name and location separated by a null
+    bytes += RECORD_HEADER_BYTES + strlen("BME280") + 1 +
+             location(sensor).length();
+  }
+  return bytes + count * (RECORD_HEADER_BYTES + SAMPLE_RECORD_BYTES);
+}
+
+// Waits for the writer task to flush the log up to bytes
+void waitForLog(size_t bytes) {
+  auto start = std::chrono::steady_clock::now();
+  while (readFile(logPath).size() < bytes &&
+         std::chrono::steady_clock::now() - start <
+             std::chrono::milliseconds(WRITER_TIMEOUT_MS)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  TEST_ASSERT_EQUAL(bytes, readFile(logPath).size());
+}
+
+std::vector<ViewModel> views(const Session &session) {
+  std::vector<ViewModel> views;
+  for (auto id : session.model->getSensorIds()) {
+    views.push_back(session.model->getViewModel(id));
+  }
+  return views;
+}
+
+void assertSameViews(const std::vector<ViewModel> &expected,
+                     const std::vector<ViewModel> &actual) {
+  TEST_ASSERT_EQUAL(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    const auto &e = expected[i];
+    const auto &a = actual[i];
+    TEST_ASSERT_EQUAL_STRING(e.sensorTypeName.c_str(),
+                             a.sensorTypeName.c_str());
+    TEST_ASSERT_EQUAL_STRING(e.sensorLocation.c_str(),
+                             a.sensorLocation.c_str());
+    TEST_ASSERT_EQUAL(e.battery, a.battery);
+    TEST_ASSERT_TRUE(e.temperature == a.temperature);
+    TEST_ASSERT_TRUE(e.minTemperature == a.minTemperature);
+    TEST_ASSERT_TRUE(e.maxTemperature == a.maxTemperature);
+    TEST_ASSERT_TRUE(e.humidity == a.humidity);
+    TEST_ASSERT_TRUE(e.minHumidity == a.minHumidity);
+    TEST_ASSERT_TRUE(e.maxHumidity == a.maxHumidity);
+
+    TEST_ASSERT_EQUAL(e.datapoints.size(), a.datapoints.size());
+    auto expectedReader = e.datapoints.reader();
+    auto actualReader = a.datapoints.reader();
+    Datapoint ep{0, 0}, ap{0, 0};
+    while (expectedReader.next(ep)) {
+      TEST_ASSERT_TRUE(actualReader.next(ap));
+      TEST_ASSERT_EQUAL(ep.timestamp, ap.timestamp);
+      TEST_ASSERT_TRUE(ep.temperature == ap.temperature);
+      TEST_ASSERT_TRUE(ep.humidity == ap.humidity);
+    }
+  }
+}
+
+// Appends a record header cut short, as a power loss during a write leaves it
+void tearLog() {
+  auto log = readFile(logPath);
+  log.insert(log.end(), {2, 0, SAMPLE_RECORD_BYTES});
+  writeFile(logPath, log);
+}
+
+// The complete state of the sensors restored from the files: the body of the
+// snapshot written when a restore with a torn log compacts it. Unlike the view
+// models it includes the samples of the current datapoint, so samples that
+// are replayed twice show.
+std::vector<uint8_t> restoredState() {
+  Session restore;
+  tearLog();
+  Session compact;
+  auto snapshot = readFile(snapshotPath);
+  TEST_ASSERT_GREATER_THAN(SNAPSHOT_HEADER_BYTES, snapshot.size());
+  // The sequence number differs between snapshots of the same state
+  memset(snapshot.data() + SNAPSHOT_SEQUENCE_OFFSET, 0, sizeof(uint32_t));
+  return snapshot;
+}
+
+void assertSameState(const std::vector<uint8_t> &expected) {
+  auto actual = restoredState();
+  TEST_ASSERT_EQUAL(expected.size(), actual.size());
+  TEST_ASSERT_EQUAL_MEMORY(expected.data(), actual.data(), expected.size());
+}
+} // namespace
+
+void setUp() { TEST_ASSERT_TRUE(LittleFS.format()); }
+
+void tearDown() {}
+
+void test_restore_into_fresh_model() {
+  Session session;
+  TEST_ASSERT_EQUAL(0, session.model->getSensorIds().size());
+  for (uint32_t i = 0; i < READINGS; i++) {
+    addReading(session, i);
+  }
+  waitForLog(logBytes(READINGS));
+
+  Session restored;
+  assertSameViews(views(session), views(restored));
+}
+
+void test_torn_tail_record_is_dropped() {
+  Session session;
+  for (uint32_t i = 0; i < READINGS - 1; i++) {
+    addReading(session, i);
+  }
+  auto beforeLast = views(session);
+  addReading(session, READINGS - 1);
+  waitForLog(logBytes(READINGS));
+
+  // Power is lost while the last sample is written
+  auto log = readFile(logPath);
+  log.resize(log.size() - SAMPLE_RECORD_BYTES / 2);
+  writeFile(logPath, log);
+
+  Session restored;
+  assertSameViews(beforeLast, views(restored));
+
+  // The torn log was folded into a snapshot, so samples logged after the
+  // restore are not hidden behind the torn record
+  for (uint32_t i = 0; i < 16; i++) {
+    addReading(restored, READINGS + i);
+  }
+  waitForLog(LOG_HEADER_BYTES +
+             16 * (RECORD_HEADER_BYTES + SAMPLE_RECORD_BYTES));
+  Session again;
+  assertSameViews(views(restored), views(again));
+}
+
+void test_crash_between_compaction_and_rename() {
+  Session session;
+  for (uint32_t i = 0; i < READINGS; i++) {
+    addReading(session, i);
+  }
+  waitForLog(logBytes(READINGS));
+  auto log = readFile(logPath);
+  auto expected = restoredState();
+
+  // The compaction of the log, written by a restore of the torn log
+  TEST_ASSERT_TRUE(LittleFS.format());
+  writeFile(logPath, log);
+  tearLog();
+  Session compact;
+  assertSameViews(views(session), views(compact));
+  auto snapshot = readFile(snapshotPath);
+  TEST_ASSERT_FALSE(LittleFS.exists(snapshotTmpPath));
+
+  // Reset before the new snapshot was renamed, it is ignored
+  TEST_ASSERT_TRUE(LittleFS.format());
+  writeFile(logPath, log);
+  writeFile(snapshotTmpPath, snapshot);
+  {
+    Session restored;
+    assertSameViews(views(session), views(restored));
+  }
+  assertSameState(expected);
+
+  // Reset after the rename but before the new log was started, the old log
+  // follows an older snapshot and is not replayed again
+  TEST_ASSERT_TRUE(LittleFS.format());
+  writeFile(logPath, log);
+  writeFile(snapshotPath, snapshot);
+  {
+    Session restored;
+    assertSameViews(views(session), views(restored));
+  }
+  assertSameState(expected);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_restore_into_fresh_model);
+  RUN_TEST(test_torn_tail_record_is_dropped);
+  RUN_TEST(test_crash_between_compaction_and_rename);
+  return UNITY_END();
+}
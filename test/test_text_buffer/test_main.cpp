@@ -0,0 +1,152 @@
+#include <TFT_eSPI.h>
+
+#include <chrono>
+#include <cmath>
+#include <unity.h>
+
+#define BENCH_LABELS 100000
+
+namespace {
+// The label in a buffer of capacity N
+template <uint16_t N = 16>
+TFT_eTextBuffer<N> fixed(float value, uint8_t decimals,
+                         const char *unit = nullptr) {
+  TFT_eTextBuffer<N> text;
+  text.addFixed(value, decimals, unit);
+  return text;
+}
+
+// Nanoseconds per label formatted by format
+template <typename Format> uint32_t timeLabels(Format format) {
+  volatile uint32_t length = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_LABELS; i++) {
+    length = length + format(-20.0f + i * 0.013f);
+  }
+  TEST_ASSERT_GREATER_THAN(0, length);
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         BENCH_LABELS;
+}
+} // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_integers() {
+  TFT_eTextBuffer<32> text;
+  text.addInt(INT32_MIN).add(" ").addInt(0).add(" ").addUInt(UINT32_MAX, "s");
+  TEST_ASSERT_EQUAL_STRING("-2147483648 0 4294967295s", text.c_str());
+  TEST_ASSERT_EQUAL(25, text.length());
+  TEST_ASSERT_FALSE(text.truncated());
+}
+
+void test_fixed_rounds_halves_away_from_zero() {
+  TEST_ASSERT_EQUAL_STRING("21.5°C", fixed(21.5f, 1, "°C").c_str());
+  TEST_ASSERT_EQUAL_STRING("2.3", fixed(2.25f, 1).c_str());
+  TEST_ASSERT_EQUAL_STRING("-2.3", fixed(-2.25f, 1).c_str());
+  TEST_ASSERT_EQUAL_STRING("3", fixed(2.5f, 0).c_str());
+  TEST_ASSERT_EQUAL_STRING("48%", fixed(48.4f, 0, "%").c_str());
+  // Rounding follows the decimal value of the float, 1.005f is 1.00499...
+  TEST_ASSERT_EQUAL_STRING("1.00", fixed(1.005f, 2).c_str());
+  TEST_ASSERT_EQUAL_STRING("10.0", fixed(9.96f, 1).c_str());
+  // Leading zeros of the fraction are kept
+  TEST_ASSERT_EQUAL_STRING("3.000042", fixed(3.000042f, 6).c_str());
+  TEST_ASSERT_EQUAL_STRING("0.05", fixed(0.05f, 2).c_str());
+  // More than 6 decimals are shown as 6
+  TEST_ASSERT_EQUAL_STRING("0.500000", fixed(0.5f, 9).c_str());
+}
+
+void test_fixed_zero_has_no_sign() {
+  TEST_ASSERT_EQUAL_STRING("0", fixed(-0.0f, 0).c_str());
+  TEST_ASSERT_EQUAL_STRING("0.0", fixed(-0.04f, 1).c_str());
+  TEST_ASSERT_EQUAL_STRING("-0.1", fixed(-0.05f, 1).c_str());
+}
+
+void test_fixed_nan_and_overflow() {
+  TEST_ASSERT_EQUAL_STRING("nan°C", fixed(NAN, 1, "°C").c_str());
+  TEST_ASSERT_EQUAL_STRING("...", fixed(INFINITY, 1).c_str());
+  TEST_ASSERT_EQUAL_STRING("...", fixed(-INFINITY, 0).c_str());
+  // The scaled value must fit 32 bits
+  TEST_ASSERT_EQUAL_STRING("4294967040", fixed(4294967040.0f, 0).c_str());
+  TEST_ASSERT_EQUAL_STRING("...", fixed(4294967296.0f, 0).c_str());
+  TEST_ASSERT_EQUAL_STRING("-4000.000000", fixed(-4000.0f, 6).c_str());
+  TEST_ASSERT_EQUAL_STRING("...", fixed(-5000.0f, 6).c_str());
+}
+
+void test_truncation_keeps_whole_characters() {
+  // The ° sign is two bytes and only the first fits
+  auto text = fixed<5>(21.5f, 1, "°C");
+  TEST_ASSERT_EQUAL_STRING("21.5", text.c_str());
+  TEST_ASSERT_EQUAL(4, text.length());
+  TEST_ASSERT_TRUE(text.truncated());
+
+  TFT_eTextBuffer<6> full{"21.5°C"};
+  TEST_ASSERT_EQUAL_STRING("21.5°", full.c_str());
+  TEST_ASSERT_TRUE(full.truncated());
+  // Later text is cut too, the flag stays until cleared
+  full.add("x");
+  TEST_ASSERT_EQUAL_STRING("21.5°", full.c_str());
+  full.clear().add("ok");
+  TEST_ASSERT_EQUAL_STRING("ok", full.c_str());
+  TEST_ASSERT_FALSE(full.truncated());
+
+  // A buffer that fits exactly is not truncated
+  auto exact = fixed<7>(21.5f, 1, "°C");
+  TEST_ASSERT_EQUAL_STRING("21.5°C", exact.c_str());
+  TEST_ASSERT_FALSE(exact.truncated());
+}
+
+void test_time_overflow_appends_nothing() {
+  struct tm time = {};
+  time.tm_hour = 7;
+  time.tm_min = 5;
+  TFT_eTextBuffer<8> text{"At "};
+  text.addTime("%H:%M", &time);
+  TEST_ASSERT_EQUAL_STRING("At 07:05", text.c_str());
+  TEST_ASSERT_FALSE(text.truncated());
+
+  text.addTime("%H", &time);
+  TEST_ASSERT_EQUAL_STRING("At 07:05", text.c_str());
+  TEST_ASSERT_EQUAL(8, text.length());
+  TEST_ASSERT_TRUE(text.truncated());
+
+  // An empty format appends nothing and is not a cut
+  TFT_eTextBuffer<8> empty;
+  empty.addTime("", &time);
+  TEST_ASSERT_EQUAL(0, empty.length());
+  TEST_ASSERT_FALSE(empty.truncated());
+}
+
+void test_fixed_beats_snprintf() {
+  uint32_t buffer_ns = timeLabels([](float value) {
+    TFT_eTextBuffer<16> text;
+    text.addFixed(value, 1, "°C");
+    return text.length();
+  });
+  // What String(value, 1) + "°C" does without the heap
+  uint32_t snprintf_ns = timeLabels([](float value) {
+    char text[17];
+    return snprintf(text, sizeof(text), "%.1f°C", value);
+  });
+
+  char message[96];
+  snprintf(message, sizeof(message),
+           "Label: addFixed %u ns, snprintf %u ns", buffer_ns, snprintf_ns);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_THAN(snprintf_ns, buffer_ns);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_integers);
+  RUN_TEST(test_fixed_rounds_halves_away_from_zero);
+  RUN_TEST(test_fixed_zero_has_no_sign);
+  RUN_TEST(test_fixed_nan_and_overflow);
+  RUN_TEST(test_truncation_keeps_whole_characters);
+  RUN_TEST(test_time_overflow_appends_nothing);
+  RUN_TEST(test_fixed_beats_snprintf);
+  return UNITY_END();
+}
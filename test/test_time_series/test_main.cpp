@@ -0,0 +1,185 @@
+#include "TimeSeries.h"
+
+#include <cmath>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+#define BLOCK_POINTS 256
+
+namespace {
+struct Point {
+  uint32_t timestamp;
+  float temperature;
+  float humidity;
+};
+
+// The value as stored, to 1/32
+float stored(float value) { return std::round(value * 32.0f) / 32.0f; }
+
+// Points at a regular interval with jitter, gaps and large jumps in time and
+// value, so every timestamp and value encoding is used
+std::vector<Point> randomSeries(size_t count) {
+  std::vector<Point> points;
+  uint32_t timestamp = 1700000000 + rand() % 1000;
+  float temperature = 21.0f;
+  float humidity = 50.0f;
+  for (size_t i = 0; i < count; i++) {
+    int pick = rand() % 20;
+    if (pick == 0) {
+      timestamp += 240 * (2 + rand() % 50); // A gap
+    } else if (pick == 1) {
+      timestamp += 240 + rand() % 3000 - 1000; // Jitter past the 12 bit range
+    } else if (pick == 2) {
+      timestamp += 100000 + rand(); // A large delta
+    } else if (pick < 8) {
+      timestamp += 240 + rand() % 9 - 4;
+    } else {
+      timestamp += 240;
+    }
+
+    pick = rand() % 10;
+    if (pick == 0) {
+      temperature = (rand() % 8000 - 4000) / 100.0f;
+      humidity = (rand() % 10000) / 100.0f;
+    } else if (pick < 6) {
+      temperature += (rand() % 21 - 10) / 32.0f;
+      humidity += (rand() % 11 - 5) / 16.0f;
+    }
+    points.push_back({timestamp, temperature, humidity});
+  }
+  return points;
+}
+
+void append(TimeSeries &series, const std::vector<Point> &points) {
+  for (const auto &point : points) {
+    series.append(point.timestamp, point.temperature, point.humidity);
+  }
+}
+
+// The series reads back the newest series.size() points
+void assertHolds(const TimeSeries &series, const std::vector<Point> &points) {
+  TEST_ASSERT_LESS_OR_EQUAL(points.size(), series.size());
+  auto reader = series.reader();
+  Datapoint dp{0, 0};
+  for (size_t i = points.size() - series.size(); i < points.size(); i++) {
+    std::string index = std::to_string(i);
+    TEST_ASSERT_TRUE_MESSAGE(reader.next(dp), index.c_str());
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(points[i].timestamp, dp.timestamp,
+                                     index.c_str());
+    TEST_ASSERT_TRUE_MESSAGE(stored(points[i].temperature) == dp.temperature,
+                             index.c_str());
+    TEST_ASSERT_TRUE_MESSAGE(stored(points[i].humidity) == dp.humidity,
+                             index.c_str());
+  }
+  TEST_ASSERT_FALSE(reader.next(dp));
+}
+} // namespace
+
+void setUp() { srand(1); }
+
+void tearDown() {}
+
+void test_round_trip() {
+  for (size_t count : {0, 1, 2, 255, 256, 257, 1000}) {
+    TimeSeries series{100000};
+    auto points = randomSeries(count);
+    append(series, points);
+    TEST_ASSERT_EQUAL(count, series.size());
+    assertHolds(series, points);
+  }
+}
+
+void test_regular_points_compress() {
+  TimeSeries series{100000};
+  std::vector<Point> points;
+  for (uint32_t i = 0; i < 1024; i++) {
+    points.push_back({1700000000 + i * 240, 21.5f, 48.0f});
+  }
+  append(series, points);
+  assertHolds(series, points);
+  // A bit for the timestamp and one for each value after the first point of
+  // each block, the block vectors grow by doubling
+  TEST_ASSERT_LESS_OR_EQUAL(4 * 2 * (12 + 3 * BLOCK_POINTS / 8),
+                            series.bytes());
+}
+
+void test_random_series() {
+  for (int round = 0; round < 50; round++) {
+    TimeSeries series{100000};
+    auto points = randomSeries(rand() % 2000);
+    append(series, points);
+    assertHolds(series, points);
+  }
+}
+
+void test_oldest_blocks_are_dropped() {
+  TimeSeries series{600};
+  auto points = randomSeries(3000);
+  for (size_t i = 0; i < points.size(); i++) {
+    series.append(points[i].timestamp, points[i].temperature,
+                  points[i].humidity);
+    // Whole blocks are dropped, at least maxPoints stay
+    TEST_ASSERT_TRUE(series.size() >= std::min<size_t>(i + 1, 600));
+    TEST_ASSERT_TRUE(series.size() < 600 + BLOCK_POINTS);
+  }
+  assertHolds(series, points);
+}
+
+void test_save_and_restore() {
+  TimeSeries series{600};
+  auto points = randomSeries(1500);
+  append(series, points);
+  std::vector<uint8_t> saved;
+  series.save(saved);
+
+  TimeSeries restored{600};
+  TEST_ASSERT_TRUE(restored.restore(saved.data(), saved.size()));
+  TEST_ASSERT_EQUAL(series.size(), restored.size());
+  assertHolds(restored, points);
+
+  // Appending continues the encoding of the last block
+  auto more = randomSeries(300);
+  for (auto &point : more) {
+    point.timestamp += points.back().timestamp - 1700000000;
+  }
+  append(series, more);
+  append(restored, more);
+  points.insert(points.end(), more.begin(), more.end());
+  assertHolds(restored, points);
+  TEST_ASSERT_EQUAL(series.size(), restored.size());
+}
+
+void test_restore_rejects_truncated_data() {
+  TimeSeries series{100000};
+  auto points = randomSeries(600);
+  append(series, points);
+  std::vector<uint8_t> saved;
+  series.save(saved);
+
+  // A failed restore leaves the series as it was
+  TimeSeries restored{100000};
+  auto kept = randomSeries(10);
+  append(restored, kept);
+  for (size_t length = 0; length < saved.size(); length += 7) {
+    TEST_ASSERT_FALSE(restored.restore(saved.data(), length));
+  }
+  assertHolds(restored, kept);
+
+  TimeSeries empty{100000};
+  saved.clear();
+  empty.save(saved);
+  TEST_ASSERT_TRUE(restored.restore(saved.data(), saved.size()));
+  TEST_ASSERT_EQUAL(0, restored.size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_regular_points_compress);
+  RUN_TEST(test_random_series);
+  RUN_TEST(test_oldest_blocks_are_dropped);
+  RUN_TEST(test_save_and_restore);
+  RUN_TEST(test_restore_rejects_truncated_data);
+  return UNITY_END();
+}
@@ -0,0 +1,214 @@
+#include "TopicRouter.h"
+
+#include <chrono>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+#define BENCH_FILTERS 5000
+#define BENCH_DISPATCHES 2000
+
+namespace {
+const char *names[] = {"home", "sensors", "kitchen", "attic", "$SYS", "a", ""};
+
+std::vector<std::string> splitLevels(const std::string &topic) {
+  std::vector<std::string> levels;
+  size_t start = 0;
+  for (;;) {
+    size_t end = topic.find('/', start);
+    levels.push_back(topic.substr(start, end - start));
+    if (end == std::string::npos) {
+      return levels;
+    }
+    start = end + 1;
+  }
+}
+
+// The matcher the trie replaces: every filter is compared with the topic
+bool linearMatches(const std::string &filter, const std::string &topic) {
+  auto filterLevels = splitLevels(filter);
+  auto topicLevels = splitLevels(topic);
+  bool system = !topicLevels[0].empty() && topicLevels[0][0] == '$';
+  for (size_t i = 0; i < filterLevels.size(); i++) {
+    const auto &level = filterLevels[i];
+    if (level == "#" && i == filterLevels.size() - 1) {
+      return !(system && i == 0);
+    }
+    if (i == topicLevels.size()) {
+      return false;
+    }
+    if (level == "+") {
+      if (system && i == 0) {
+        return false;
+      }
+      continue;
+    }
+    if (level != topicLevels[i]) {
+      return false;
+    }
+  }
+  return filterLevels.size() == topicLevels.size();
+}
+
+std::string randomTopic(bool wildcards) {
+  std::string topic;
+  int count = 1 + rand() % 4;
+  for (int i = 0; i < count; i++) {
+    if (i > 0) {
+      topic += '/';
+    }
+    int pick = rand() % (wildcards ? 9 : 7);
+    if (pick == 7) {
+      topic += '+';
+    } else if (pick == 8 && i == count - 1) {
+      topic += '#';
+    } else {
+      topic += names[pick % 7];
+    }
+  }
+  return topic;
+}
+
+// Filters named like the sensors of a large installation
+std::vector<std::string> benchFilters() {
+  std::vector<std::string> filters;
+  for (int i = 0; i < BENCH_FILTERS; i++) {
+    filters.push_back("/site" + std::to_string(i % 50) + "/room" +
+                      std::to_string(i) + (i % 10 == 0 ? "/+" : "/temp"));
+  }
+  filters.push_back("/home/sensors/+");
+  return filters;
+}
+
+uint32_t elapsed_us(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+struct Readings {
+  std::vector<int> values;
+  void clear() { values.clear(); }
+};
+
+const int *decodedData = nullptr;
+size_t decodedCapacity = 0;
+
+bool decodeReadings(const uint8_t *payload, unsigned int length,
+                    Readings &readings) {
+  // A cleared message is handed to every decode
+  TEST_ASSERT_EQUAL(0, readings.values.size());
+  if (length == 0) {
+    return false;
+  }
+  for (unsigned int i = 0; i < length; i++) {
+    readings.values.push_back(payload[i]);
+  }
+  return true;
+}
+} // namespace
+
+void setUp() { srand(1); }
+
+void tearDown() {}
+
+void test_matches_linear_matcher() {
+  for (int round = 0; round < 200; round++) {
+    TopicRouter router;
+    std::vector<std::string> filters;
+    for (int i = 0; i < 20; i++) {
+      filters.push_back(randomTopic(true));
+      TEST_ASSERT_TRUE(router.subscribe(
+          filters.back().c_str(),
+          [](const TopicMatch &, const uint8_t *, unsigned int) {}));
+    }
+
+    for (int i = 0; i < 50; i++) {
+      auto topic = randomTopic(false);
+      size_t expected = 0;
+      for (const auto &filter : filters) {
+        expected += linearMatches(filter, topic);
+      }
+      TEST_ASSERT_EQUAL_MESSAGE(expected,
+                                router.dispatch(topic.c_str(), nullptr, 0),
+                                topic.c_str());
+    }
+  }
+}
+
+void test_typed_subscribe_reuses_message() {
+  TopicRouter router;
+  size_t handled = 0;
+  TEST_ASSERT_TRUE(router.subscribe<Readings>(
+      "/home/sensors/+", decodeReadings,
+      [&](const TopicMatch &topic, const Readings &readings) {
+        TEST_ASSERT_TRUE(topic.last().equals("kitchen"));
+        if (handled++ == 0) {
+          decodedData = readings.values.data();
+          decodedCapacity = readings.values.capacity();
+        } else {
+          // Smaller messages decode into the storage of the first
+          TEST_ASSERT_TRUE(decodedData == readings.values.data());
+          TEST_ASSERT_EQUAL(decodedCapacity, readings.values.capacity());
+        }
+      }));
+
+  uint8_t payload[64] = {};
+  TEST_ASSERT_EQUAL(1, router.dispatch("/home/sensors/kitchen", payload, 64));
+  TEST_ASSERT_EQUAL(1, router.dispatch("/home/sensors/kitchen", payload, 8));
+  // Dropped, and the next message still decodes into a cleared one
+  TEST_ASSERT_EQUAL(1, router.dispatch("/home/sensors/kitchen", payload, 0));
+  TEST_ASSERT_EQUAL(1, router.dispatch("/home/sensors/kitchen", payload, 32));
+  TEST_ASSERT_EQUAL(3, handled);
+}
+
+void test_dispatch_beats_linear_matcher() {
+  auto filters = benchFilters();
+  TopicRouter router;
+  for (const auto &filter : filters) {
+    TEST_ASSERT_TRUE(router.subscribe(
+        filter.c_str(),
+        [](const TopicMatch &, const uint8_t *, unsigned int) {}));
+  }
+  // Half the messages are sensor readings, half go to one of the rooms
+  std::vector<std::string> topics;
+  for (int i = 0; i < BENCH_DISPATCHES; i++) {
+    topics.push_back(i % 2 ? "/home/sensors/kitchen"
+                           : "/site7/room" + std::to_string(i % 1000 * 50 + 7) +
+                                 "/temp");
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  size_t trieMatches = 0;
+  for (const auto &topic : topics) {
+    trieMatches += router.dispatch(topic.c_str(), nullptr, 0);
+  }
+  uint32_t trie_us = elapsed_us(start);
+
+  // The linear matcher is slow enough that a fifth of the topics will do
+  start = std::chrono::steady_clock::now();
+  size_t linearMatchCount = 0;
+  for (size_t i = 0; i < topics.size(); i += 5) {
+    for (const auto &filter : filters) {
+      linearMatchCount += linearMatches(filter, topics[i]);
+    }
+  }
+  uint32_t linear_us = elapsed_us(start) * 5;
+  TEST_ASSERT_EQUAL(trieMatches, linearMatchCount * 5);
+
+  char message[128];
+  snprintf(message, sizeof(message),
+           "%u filters: trie %u ns/dispatch, linear %u us/dispatch",
+           BENCH_FILTERS + 1, trie_us * 1000 / BENCH_DISPATCHES,
+           linear_us / BENCH_DISPATCHES);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_THAN(linear_us / 10, trie_us);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_matches_linear_matcher);
+  RUN_TEST(test_typed_subscribe_reuses_message);
+  RUN_TEST(test_dispatch_beats_linear_matcher);
+  return UNITY_END();
+}
@@ -0,0 +1,308 @@
+#include <TFT_eSPI.h>
+
+#include <cmath>
+#include <string>
+#include <unity.h>
+
+#define WIDTH 160
+#define HEIGHT 120
+#define LINES 3000
+// Lines start and end up to this far outside the sprite, so they are clipped
+#define OUTSIDE 40
+
+namespace {
+TFT_eSPI tft;
+
+constexpr float PixelAlphaGain = 255.0;
+constexpr float LoAlphaTheshold = 1.0 / 32.0;
+constexpr float HiAlphaTheshold = 1.0 - LoAlphaTheshold;
+
+// Distance of px,py from the closest part of the a to b wedge
+float wedgeLineDistance(float xpax, float ypay, float bax, float bay,
+                        float dr) {
+  float h = fmaxf(
+      fminf((xpax * bax + ypay * bay) / (bax * bax + bay * bay), 1.0f), 0.0f);
+  float dx = xpax - bax * h, dy = ypay - bay * h;
+  return sqrtf(dx * dx + dy * dy) + h * dr;
+}
+
+// TFT_eSPI::drawWedgeLine as it was before the row spans were found in fixed
+// point, evaluating the float distance of every pixel it visits
+void referenceWedgeLine(TFT_eSprite &s, float ax, float ay, float bx, float by,
+                        float ar, float br, uint32_t fg_color,
+                        uint32_t bg_color) {
+  if ((ar < 0.0) || (br < 0.0))
+    return;
+  if ((fabsf(ax - bx) < 0.01f) && (fabsf(ay - by) < 0.01f))
+    bx += 0.01f; // Avoid divide by zero
+
+  // Find line bounding box
+  int32_t x0 = (int32_t)floorf(fminf(ax - ar, bx - br));
+  int32_t x1 = (int32_t)ceilf(fmaxf(ax + ar, bx + br));
+  int32_t y0 = (int32_t)floorf(fminf(ay - ar, by - br));
+  int32_t y1 = (int32_t)ceilf(fmaxf(ay + ar, by + br));
+
+  if (!s.clipWindow(&x0, &y0, &x1, &y1))
+    return;
+
+  // Establish x start and y start
+  int32_t ys = ay;
+  if ((ax - ar) > (bx - br))
+    ys = by;
+
+  float rdt = ar - br; // Radius delta
+  float alpha = 1.0f;
+  ar += 0.5;
+
+  uint16_t bg = bg_color;
+  float xpax, ypay, bax = bx - ax, bay = by - ay;
+
+  int32_t xs = x0;
+  // Scan bounding box from ys down, calculate pixel intensity from distance to
+  // line
+  for (int32_t yp = ys; yp <= y1; yp++) {
+    bool swin = true;  // Flag to start new window area
+    bool endX = false; // Flag to skip pixels
+    ypay = yp - ay;
+    for (int32_t xp = xs; xp <= x1; xp++) {
+      if (endX)
+        if (alpha <= LoAlphaTheshold)
+          break; // Skip right side
+      xpax = xp - ax;
+      alpha = ar - wedgeLineDistance(xpax, ypay, bax, bay, rdt);
+      if (alpha <= LoAlphaTheshold)
+        continue;
+      // Track edge to minimise calculations
+      if (!endX) {
+        endX = true;
+        xs = xp;
+      }
+      if (alpha > HiAlphaTheshold) {
+        if (swin) {
+          s.setWindow(xp, yp, s.width() - 1, yp);
+          swin = false;
+        }
+        s.pushColor(fg_color);
+        continue;
+      }
+      // Blend color with background and plot
+      if (bg_color == 0x00FFFFFF) {
+        bg = s.readPixel(xp, yp);
+        swin = true;
+      }
+      if (swin) {
+        s.setWindow(xp, yp, s.width() - 1, yp);
+        swin = false;
+      }
+      // Without dither, as the inline alphaBlend()
+      s.pushColor(
+          s.alphaBlend((uint8_t)(alpha * PixelAlphaGain), fg_color, bg, 0));
+    }
+  }
+
+  // Reset x start to left side of box
+  xs = x0;
+  // Scan bounding box from ys-1 up, calculate pixel intensity from distance to
+  // line
+  for (int32_t yp = ys - 1; yp >= y0; yp--) {
+    bool swin = true;  // Flag to start new window area
+    bool endX = false; // Flag to skip pixels
+    ypay = yp - ay;
+    for (int32_t xp = xs; xp <= x1; xp++) {
+      if (endX)
+        if (alpha <= LoAlphaTheshold)
+          break; // Skip right side of drawn line
+      xpax = xp - ax;
+      alpha = ar - wedgeLineDistance(xpax, ypay, bax, bay, rdt);
+      if (alpha <= LoAlphaTheshold)
+        continue;
+      // Track edge to minimise calculations
+      if (!endX) {
+        endX = true;
+        xs = xp;
+      }
+      if (alpha > HiAlphaTheshold) {
+        if (swin) {
+          s.setWindow(xp, yp, s.width() - 1, yp);
+          swin = false;
+        }
+        s.pushColor(fg_color);
+        continue;
+      }
+      // Blend color with background and plot
+      if (bg_color == 0x00FFFFFF) {
+        bg = s.readPixel(xp, yp);
+        swin = true;
+      }
+      if (swin) {
+        s.setWindow(xp, yp, s.width() - 1, yp);
+        swin = false;
+      }
+      // Without dither, as the inline alphaBlend()
+      s.pushColor(
+          s.alphaBlend((uint8_t)(alpha * PixelAlphaGain), fg_color, bg, 0));
+    }
+  }
+}
+
+float randomFloat(float low, float high) {
+  return low + (high - low) * (rand() / (float)RAND_MAX);
+}
+
+float randomX() { return randomFloat(-OUTSIDE, WIDTH + OUTSIDE); }
+
+float randomY() { return randomFloat(-OUTSIDE, HEIGHT + OUTSIDE); }
+
+// A radius, mostly small as the View draws them
+float randomRadius() {
+  return rand() % 4 == 0 ? randomFloat(0.0f, 30.0f) : randomFloat(0.0f, 4.0f);
+}
+
+// The background colour, or reading the background from the sprite
+uint32_t randomBackground() {
+  return rand() % 2 ? 0x00FFFFFF : (uint32_t)(rand() & 0xFFFF);
+}
+
+class WideLineTest {
+public:
+  WideLineTest() : sprite_{&tft}, reference_{&tft} {
+    TEST_ASSERT_NOT_NULL(sprite_.createSprite(WIDTH, HEIGHT));
+    TEST_ASSERT_NOT_NULL(reference_.createSprite(WIDTH, HEIGHT));
+    // A pattern to blend with when the background is read
+    for (int32_t y = 0; y < HEIGHT; y++) {
+      for (int32_t x = 0; x < WIDTH; x++) {
+        uint16_t color = x * 0x0841 + y * 0x1003;
+        sprite_.drawPixel(x, y, color);
+        reference_.drawPixel(x, y, color);
+      }
+    }
+  }
+
+  void setViewport(int32_t x, int32_t y, int32_t w, int32_t h) {
+    sprite_.setViewport(x, y, w, h);
+    reference_.setViewport(x, y, w, h);
+  }
+
+  void wedgeLine(int line, float ax, float ay, float bx, float by, float ar,
+                 float br, uint32_t fg_color, uint32_t bg_color) {
+    sprite_.drawWedgeLine(ax, ay, bx, by, ar, br, fg_color, bg_color);
+    referenceWedgeLine(reference_, ax, ay, bx, by, ar, br, fg_color, bg_color);
+    assertSame(line);
+  }
+
+  void wideLine(int line, float ax, float ay, float bx, float by, float wd,
+                uint32_t fg_color, uint32_t bg_color) {
+    sprite_.drawWideLine(ax, ay, bx, by, wd, fg_color, bg_color);
+    referenceWedgeLine(reference_, ax, ay, bx, by, wd / 2.0, wd / 2.0,
+                       fg_color, bg_color);
+    assertSame(line);
+  }
+
+  void spot(int line, float ax, float ay, float r, uint32_t fg_color,
+            uint32_t bg_color) {
+    sprite_.drawSpot(ax, ay, r, fg_color, bg_color);
+    referenceWedgeLine(reference_, ax, ay, ax, ay, r, r, fg_color, bg_color);
+    assertSame(line);
+  }
+
+private:
+  TFT_eSprite sprite_;
+  TFT_eSprite reference_;
+
+  void assertSame(int line) {
+    std::string message = "line " + std::to_string(line);
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(reference_.getPointer(),
+                                     sprite_.getPointer(),
+                                     WIDTH * HEIGHT * sizeof(uint16_t),
+                                     message.c_str());
+  }
+};
+} // namespace
+
+void setUp() { srand(1); }
+
+void tearDown() {}
+
+void test_wedge_lines_match_float() {
+  WideLineTest test;
+  for (int line = 0; line < LINES; line++) {
+    test.wedgeLine(line, randomX(), randomY(), randomX(), randomY(),
+                   randomRadius(), randomRadius(), rand() & 0xFFFF,
+                   randomBackground());
+  }
+}
+
+void test_wide_lines_match_float() {
+  WideLineTest test;
+  for (int line = 0; line < LINES; line++) {
+    float ax = randomX(), ay = randomY();
+    float bx = randomX(), by = randomY();
+    // Lines near vertical and horizontal, and needles from a point
+    switch (rand() % 4) {
+    case 0:
+      bx = ax + randomFloat(-0.05f, 0.05f);
+      break;
+    case 1:
+      by = ay + randomFloat(-0.05f, 0.05f);
+      break;
+    case 2:
+      bx = ax + randomFloat(-3.0f, 3.0f);
+      by = ay + randomFloat(-3.0f, 3.0f);
+      break;
+    }
+    test.wideLine(line, ax, ay, bx, by, 2 * randomRadius(), rand() & 0xFFFF,
+                  randomBackground());
+  }
+}
+
+void test_spots_match_float() {
+  WideLineTest test;
+  for (int line = 0; line < LINES; line++) {
+    test.spot(line, randomX(), randomY(), randomRadius(), rand() & 0xFFFF,
+              randomBackground());
+  }
+}
+
+void test_clipped_to_viewport() {
+  WideLineTest test;
+  test.setViewport(17, 11, WIDTH - 40, HEIGHT - 30);
+  for (int line = 0; line < LINES; line++) {
+    switch (line % 3) {
+    case 0:
+      test.wedgeLine(line, randomX(), randomY(), randomX(), randomY(),
+                     randomRadius(), randomRadius(), rand() & 0xFFFF,
+                     randomBackground());
+      break;
+    case 1:
+      test.wideLine(line, randomX(), randomY(), randomX(), randomY(),
+                    2 * randomRadius(), rand() & 0xFFFF, randomBackground());
+      break;
+    default:
+      test.spot(line, randomX(), randomY(), randomRadius(), rand() & 0xFFFF,
+                randomBackground());
+      break;
+    }
+  }
+}
+
+void test_far_outside_coordinates() {
+  // Lines beyond the range of the fixed point spans take the per pixel scan
+  WideLineTest test;
+  for (int line = 0; line < 200; line++) {
+    float ax = randomX(), ay = randomY();
+    float bx = randomFloat(-6000.0f, 6000.0f);
+    float by = randomFloat(-6000.0f, 6000.0f);
+    test.wedgeLine(line, ax, ay, bx, by, randomRadius(), randomRadius(),
+                   rand() & 0xFFFF, randomBackground());
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_wedge_lines_match_float);
+  RUN_TEST(test_wide_lines_match_float);
+  RUN_TEST(test_spots_match_float);
+  RUN_TEST(test_clipped_to_viewport);
+  RUN_TEST(test_far_outside_coordinates);
+  return UNITY_END();
+}